@@ -4,10 +4,16 @@ var g_rootPkg = {
         pkg : 0,
         childPkgs : [ ]
 };
+// Package name to package, built once per load
+var g_pkgByName = {};
+// Files of a shard directory by name. Empty for a single JSON file
+var g_shardFiles = {};
 
 //==============================================================================
 ///      \function loadFile 
-///      \brief    Loads the JSON file 
+///      \brief    Loads the JSON file, or the manifest of a shard directory
+//                 (sca --sca-format=shards). The shards are read only when
+//                 their package is opened
 //==============================================================================
 function loadFile() {
   var input, file, fr;
@@ -27,6 +33,13 @@ function loadFile() {
   }
   else {
     file = input.files[0];
+    g_shardFiles = {};
+    for(var i=0; i<input.files.length; i++) {
+      if(input.files[i].name == "manifest.json") {
+        file = input.files[i];
+      }
+      g_shardFiles[input.files[i].name] = input.files[i];
+    }
     fr = new FileReader();
     fr.onload = receivedText;
     fr.readAsText(file);
@@ -34,10 +47,35 @@ function loadFile() {
   function receivedText(e) {
     lines = e.target.result;
     g_scaJSONObject = JSON.parse(lines); 
+    if(g_scaJSONObject.ssca_manifest) {
+      // The manifest entries stand for the packages till they are loaded
+      g_scaJSONObject.pkg = g_scaJSONObject.ssca_manifest;
+    }
     main();
   }
 }
 
+//==============================================================================
+///      \function loadShard 
+///      \brief    Reads the shard of a package of the manifest and calls
+//                 "done" once the package has its files
+//==============================================================================
+function loadShard(package_obj, done) {
+  var file = g_shardFiles[package_obj.ssca_shard];
+  if(!file) {
+    alert("Please select " + package_obj.ssca_shard + " along with the manifest");
+    return;
+  }
+  var fr = new FileReader();
+  fr.onload = function(e) {
+    var shard = JSON.parse(e.target.result).pkg[0];
+    package_obj.ssca_sFile = shard.ssca_sFile;
+    package_obj.ssca_hFile = shard.ssca_hFile;
+    done();
+  };
+  fr.readAsText(file);
+}
+
 //==============================================================================
 //      \function baseName 
 //      \brief    Given the absolute path returns the base name
@@ -63,10 +101,8 @@ function dirName(path) {
 //      \brief    Given the package name returns the actual package
 //==============================================================================
 function getPackage(package_name) {
-  for(i=0; i<g_scaJSONObject.pkg.length; i++) {
-    if( g_scaJSONObject.pkg[i].ssca_PkgName == package_name) {
-      return  g_scaJSONObject.pkg[i];
-    }
+  if(package_name in g_pkgByName) {
+    return g_pkgByName[package_name];
   }
   return undefined;
 }
@@ -94,6 +130,10 @@ function buildHierarchyPkgTree() {
   var map = {};
   var max_level = -1;
   var i=0;
+  g_pkgByName = {};
+  for(i=0; i<g_scaJSONObject.pkg.length; i++) {
+    g_pkgByName[g_scaJSONObject.pkg[i].ssca_PkgName] = g_scaJSONObject.pkg[i];
+  }
   // First create a map based on level numbers
   for(i=0; i<g_scaJSONObject.pkg.length; i++) {
     var level_no = numOfDirLevels(g_scaJSONObject.pkg[i].ssca_PkgName);
@@ -254,11 +294,26 @@ function executeQToolTipQuery() {
 }
 
 //==============================================================================
-//      \function 
-//      \brief    
+//      \function getSummaryMetrics
+//      \brief    The totals of the package. Only the manifest of a shard
+//                 directory has them
 //==============================================================================
 function getSummaryMetrics(package_name) {
-  return "";
+  var cur_pkg = getPackage(package_name);
+  if(!cur_pkg || !("ssca_nfn" in cur_pkg)) {
+    return "";
+  }
+  var ret_var = "<table style=\"width:100%\"><tbody>";
+  ret_var += "<tr><td> Source files </td><td>" + cur_pkg.ssca_nsf + "</td></tr>";
+  ret_var += "<tr><td> Header files </td><td>" + cur_pkg.ssca_nhf + "</td></tr>";
+  ret_var += "<tr><td> Functions </td><td>" + cur_pkg.ssca_nfn + "</td></tr>";
+  ret_var += "<tr><td> Classes </td><td>" + cur_pkg.ssca_ncl + "</td></tr>";
+  ret_var += "<tr><td> Methods </td><td>" + cur_pkg.ssca_nmt + "</td></tr>";
+  ret_var += "<tr><td> Total cyclomatic cmplx </td><td>" + cur_pkg.ssca_tcyc + "</td></tr>";
+  ret_var += "<tr><td> Maximum cyclomatic cmplx </td><td>" + cur_pkg.ssca_mcyc + "</td></tr>";
+  ret_var += "<tr><td> Num lines </td><td>" + cur_pkg.ssca_tnl + "</td></tr>";
+  ret_var += "</tbody></table>";
+  return ret_var;
 }
 
 //==============================================================================
@@ -372,6 +427,15 @@ function showPackageTable(package_name)
 
     var ret_var = "";
     var package_obj     = getPackage(package_name); 
+    if(!package_obj) {
+      // A directory without sources of its own
+      return;
+    }
+    if(package_obj.ssca_shard && !package_obj.ssca_sFile) {
+      // Come back once the shard of the package is read
+      loadShard(package_obj, function() { showPackageTable(package_name); });
+      return;
+    }
 
     ret_var += getSummaryMetrics(package_name);
     $("#SummaryTab").html(ret_var);
@@ -0,0 +1,8 @@
+#ifndef GUARDED_H
+#define GUARDED_H
+struct Guarded {
+  int v_;
+  int twice() const { return 2 * v_; }
+};
+inline int guarded(int a) { return a > 0 ? a * 3 : -a; }
+#endif
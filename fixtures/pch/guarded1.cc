@@ -0,0 +1,2 @@
+#include "guarded.h"
+int first(int a) { Guarded g = { a }; return guarded(a) + g.twice(); }
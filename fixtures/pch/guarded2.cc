@@ -0,0 +1,2 @@
+#include "guarded.h"
+int second(int a) { return guarded(a + 1); }
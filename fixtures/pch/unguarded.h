@@ -0,0 +1,4 @@
+struct Unguarded {
+  int v_;
+};
+inline int unguarded(int a) { return a < 0 ? 0 : a; }
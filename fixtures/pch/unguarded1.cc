@@ -0,0 +1,3 @@
+#include "guarded.h"
+#include "unguarded.h"
+int third(int a) { Unguarded u = { a }; return unguarded(u.v_) + guarded(a); }
@@ -0,0 +1,3 @@
+#include "guarded.h"
+#include "unguarded.h"
+int fourth(int a) { return unguarded(a - 1); }
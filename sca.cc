@@ -6,12 +6,22 @@
  *      
  *  ----------------------------------------------------------*/
 #include <assert.h>
+#include <algorithm>
 #include <clang-c/Index.h>
 #include "sca_int.hh"
 #include "sca_globals.hh"
 #include "sca_utils.hh"
 #include "sca_json_reader.hh"
 #include "sca_analyzer.hh"
+#include "sca_visitor.hh"
+#include "sca_driver.hh"
+#include "sca_preamble.hh"
+#include "sca_workqueue.hh"
+#include "sca_cache.hh"
+#include "sca_daemon.hh"
+#include "sca_stream.hh"
+#include "sca_input.hh"
+#include "sca_selfcheck.hh"
 
 CXChildVisitResult FunctionDefinition_visitor(CXCursor cursor,
                                               CXCursor parent,
@@ -46,75 +56,163 @@ bool isStmtABranch(CXCursor cursor) {
 }
 
 //==============================================================================
-///      \brief Visits a statement
+///      \brief Visits the body of the function. The whole body is walked in a
+//              single clang_visitChildren. The ancestors of the cursor live
+//              on an explicit stack in the context, each with the nesting
+//              and loop complexity at that point. The parent handed by
+//              libclang tells how far to unwind the stack.
 //==============================================================================
-CXChildVisitResult Stmt_visitor(CXCursor cursor, 
-                                  CXCursor parent, 
-                                  CXClientData client_data) {
+CXChildVisitResult FunctionBody_visitor(CXCursor cursor, 
+                                        CXCursor parent, 
+                                        CXClientData client_data) {
   SCA::Context *cntxt = static_cast<SCA::Context*>(client_data);
-  if(isStmtABranch(cursor)) {
+  std::vector<SCA::WalkFrame> &stack = cntxt->walk_stack_;
+  cntxt->num_cursors_++;
+  while(stack.size() > 1 && !clang_equalCursors(stack.back().cursor_, parent)) {
+    stack.pop_back();
+  }
+  SCA::WalkFrame frame = stack.back();
+  frame.cursor_ = cursor;
+  if(CXCursor_ParmDecl == clang_getCursorKind(cursor) && frame.nesting_ == 0) {
+    CXType type = clang_getCursorType(cursor);
+    CXString str = clang_getTypeSpelling(type);
+    // TODO:Get the type and arg here 
+    cntxt->cur_func_->addArg(clang_getCString(str), 
+                             getCursorSpelling(cursor).c_str());
+    clang_disposeString(str);
+  } else if(CXCursor_CallExpr == clang_getCursorKind(cursor)) {
+    // Calls through a pointer reference no function and are left out.
+    // A virtual call is an edge to the method named in the call
+    CXCursor callee = clang_getCursorReferenced(cursor);
+    CXCursorKind kind = clang_getCursorKind(callee);
+    if(CXCursor_FunctionDecl == kind || CXCursor_CXXMethod == kind) {
+      ULL usr = getUsrHashFromCursor(callee);
+      if(usr) {
+        cntxt->callees_.push_back(usr);
+      }
+    }
+  } else if(isStmtABranch(cursor)) {
     cntxt->max_cyclomatic_++;
-    int old_nesting_value       = cntxt->cur_nesting_;
-    int old_complexity_value    = cntxt->cur_complexity_;
-    cntxt->cur_nesting_++;
+    frame.nesting_++;
     if(isStmtALoop(cursor)) {
-      cntxt->cur_complexity_++;
+      frame.complexity_++;
     }
-    // Recursively call this function
-    clang_visitChildren(cursor, Stmt_visitor, (void*)cntxt);
-    if(cntxt->cur_nesting_ > cntxt->max_nesting_) {
-      cntxt->max_nesting_ = cntxt->cur_nesting_;
-    }
-    if(cntxt->cur_complexity_ > cntxt->max_complexity_) {
-      cntxt->max_complexity_ = cntxt->cur_complexity_;
+    // Only the branches nested in another branch count towards the max
+    if(frame.nesting_ > 1) {
+      if(frame.nesting_ > cntxt->max_nesting_) {
+        cntxt->max_nesting_ = frame.nesting_;
+      }
+      if(frame.complexity_ > cntxt->max_complexity_) {
+        cntxt->max_complexity_ = frame.complexity_;
+      }
     }
-    cntxt->cur_nesting_         = old_nesting_value;
-    cntxt->cur_complexity_      = old_complexity_value;
-    return CXChildVisit_Continue;
   }
+  stack.push_back(frame);
   return CXChildVisit_Recurse;
 }
 
+/// Order of the tokens on their offset
+static bool lexemeBefore(const SCA::Lexeme &lexeme, U offset) {
+  return lexeme.offset_ < offset;
+}
+
 //==============================================================================
-///      \brief Visits the body of the function 
+///      \brief Number of distinct hashes, which are sorted for it
 //==============================================================================
-CXChildVisitResult FunctionBody_visitor(CXCursor cursor, 
-                                        CXCursor parent, 
-                                        CXClientData client_data) {
-  SCA::Context *cntxt = static_cast<SCA::Context*>(client_data);
-  if(CXCursor_ParmDecl == clang_getCursorKind(cursor)) {
-    CXType type = clang_getCursorType(cursor);
-    CXString str = clang_getTypeSpelling(type);
-    // TODO:Get the type and arg here 
-    cntxt->cur_func_->addArg(clang_getCString(str), 
-                            clang_getCString(clang_getCursorSpelling(cursor)));
-    return CXChildVisit_Recurse;
+static U countUnique(std::vector<ULL> &hashes) {
+  std::sort(hashes.begin(), hashes.end());
+  return std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+}
+
+//==============================================================================
+///      \brief  The file and the offsets of the extent of the function. The
+//               file and the start are the key of its Halstead counts
+//==============================================================================
+static bool getFunctionExtent(CXCursor cursor, CXFile *file, unsigned *start, unsigned *end) {
+  CXSourceRange extent = clang_getCursorExtent(cursor);
+  clang_getFileLocation(clang_getRangeStart(extent), file, NULL, NULL, start);
+  clang_getFileLocation(clang_getRangeEnd(extent), NULL, NULL, NULL, end);
+  return *file && *start < *end;
+}
+
+//==============================================================================
+///      \brief  Halstead counts of the function from the tokens of its file.
+//               The file is tokenized by the first function of the TU in it
+//               and the tokens of a function are the ones in its extent,
+//               from the return type to the closing brace. Runs before the
+//               lock, see sca_lex_translation_unit
+//==============================================================================
+static void countHalsteadTokens(CXCursor cursor, SCA::FileVisit *visit,
+                                SCA::Context *cntxt) {
+  CXFile file;
+  unsigned start, end;
+  if(!getFunctionExtent(cursor, &file, &start, &end)) {
+    return;
   }
-  if(isStmtABranch(cursor)) {
-    cntxt->max_cyclomatic_++;
-    cntxt->cur_nesting_ =  1;
-    if(isStmtALoop(cursor)) {
-      cntxt->cur_complexity_ = 1;
+  if(!visit->lexed_) {
+    cntxt->num_lexemes_ += tokenizeFile(clang_Cursor_getTranslationUnit(cursor), file, visit,
+                                        cntxt->lex_args_);
+  }
+  const std::vector<SCA::Lexeme> &lexemes = visit->lexemes_;
+  cntxt->operators_.clear();
+  cntxt->operands_.clear();
+  std::vector<SCA::Lexeme>::const_iterator it =
+    std::lower_bound(lexemes.begin(), lexemes.end(), start, lexemeBefore);
+  for(; it!=lexemes.end() && it->offset_ < end; it++) {
+    if(SCA::Lexeme::kOperator == it->kind_) {
+      cntxt->operators_.push_back(it->hash_);
     } else {
-      cntxt->cur_complexity_ = 0;
+      cntxt->operands_.push_back(it->hash_);
     }
-    clang_visitChildren(cursor, Stmt_visitor, (void*)cntxt);
-    return CXChildVisit_Continue;
   }
-  return CXChildVisit_Recurse;
+  SCA::HalsteadCounts &counts = cntxt->halstead_[std::make_pair(file, start)];
+  counts.operators_        = cntxt->operators_.size();
+  counts.unique_operators_ = countUnique(cntxt->operators_);
+  counts.operands_         = cntxt->operands_.size();
+  counts.unique_operands_  = countUnique(cntxt->operands_);
 }
 
 //==============================================================================
-///      \brief  Visit the class definition
+///      \brief  Give the function the counts sca_lex_translation_unit made
+//==============================================================================
+static void setHalsteadCounts(CXCursor cursor, SCA::Function *func,
+                              SCA::Context *cntxt) {
+  CXFile file;
+  unsigned start, end;
+  if(!getFunctionExtent(cursor, &file, &start, &end)) {
+    return;
+  }
+  std::map<std::pair<CXFile, U>, SCA::HalsteadCounts>::const_iterator it =
+    cntxt->halstead_.find(std::make_pair(file, start));
+  if(it != cntxt->halstead_.end()) {
+    func->set_operators(it->second.operators_, it->second.unique_operators_);
+    func->set_operands(it->second.operands_, it->second.unique_operands_);
+  }
+}
+
+//==============================================================================
+///      \brief  Record the #include as an edge of the include graph. Files
+//               SCA does not track (i.e <vector>) are left out, on either end
 //==============================================================================
 void InclusionDirective_visitor(CXCursor cursor,
                                 CXCursor parent,
                                 SCA::Context *cntxt) {
-  const char* ifile=  clang_getCString(clang_getFileName(clang_getIncludedFile(cursor)));
-  if(ifile) {
-    char real_path[1024];
-    getAbsolutePathFromRelativePath(ifile, real_path);
-    FileIdMgr::getFileIdMgr()->insertFile(std::string(real_path)); 
+  CXFile included_file = clang_getIncludedFile(cursor);
+  SCA::File *included = getFileFromCXFile(included_file, cntxt);
+  SCA::File *includer = getFileFromCursor(cursor, cntxt);
+  if(NULL == included) {
+    // Not tracked (i.e <vector>), so it is not in the include graph. Only
+    // counted, see sca_visit_translation_unit
+    CXFile includer_file;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &includer_file, NULL, NULL, NULL);
+    SCA::FileVisit *visit = resolveFile(includer_file, cntxt);
+    if(included_file && includer && visit) {
+      visit->external_includes_++;
+    }
+    return;
+  }
+  if(includer && includer != included) {
+    includer->insert_direct_include(included->id());
   }
 }
 
@@ -135,7 +233,7 @@ CXChildVisitResult ClassBody_visitor(CXCursor cursor,
      return CXChildVisit_Continue;
     }
     //assert((CXCursor_ClassDecl == clang_getCursorKind(class_decl)));
-    ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(class_decl));  
+    ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(class_decl, cntxt));  
     // TODO: Add a SCA error here
     SCA::Class *inherited_from = SCA_globals::getGlobals()->class_hash()[class_id];
     if(NULL == inherited_from) {
@@ -153,19 +251,23 @@ CXChildVisitResult ClassDefinition_visitor(CXCursor cursor,
                                            CXCursor parent,
                                            SCA::Context *cntxt) {
   assert((CXCursor_ClassDecl == clang_getCursorKind(cursor)));
-  ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(cursor));
-  SCA::File *file = getFileFromCursor(cursor);
+  ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(cursor, cntxt));
+  SCA::File *file = getFileFromCursor(cursor, cntxt);
   if(SCA_globals::getGlobals()->class_hash()[class_id] || !file) {
     // Already this function is processed. This function is present in a 
     // header file and hence being parsed once again
   } else {
     SCA::Class* cur_class = new SCA::Class(file,
-        clang_getCString(clang_getCursorSpelling(cursor)), 
+        getCursorSpelling(cursor), 
         class_id);
     cntxt->cur_class_ = cur_class;
     SCA_globals::getGlobals()->class_hash().insert(class_id, cur_class);
     // Visit the class body
     clang_visitChildren(cursor, ClassBody_visitor, (void*)cntxt); 
+    if(sca_streaming() && 
+       SCA_globals::getGlobals()->markStreamed(SCA::Obj::kClass, class_id)) {
+      sca_stream_class(cur_class);
+    }
   }
   return CXChildVisit_Continue;
 }
@@ -178,28 +280,39 @@ CXChildVisitResult FunctionDefinition_visitor(CXCursor cursor,
                                               SCA::Context *cntxt) {
   assert((CXCursor_CXXMethod == clang_getCursorKind(cursor)) ||
          (CXCursor_FunctionDecl == clang_getCursorKind(cursor)));
-  FuncId func_id = static_cast<FuncId>(getSourceIdFromCursor(cursor));
-  SCA::File *file = getFileFromCursor(cursor);
-  if(SCA_globals::getGlobals()->function_hash()[func_id] || !file) {
+  FuncId func_id = static_cast<FuncId>(getSourceIdFromCursor(cursor, cntxt));
+  SCA::File *file = getFileFromCursor(cursor, cntxt);
+  // In the streaming mode the function is written out once it is walked
+  // and is not kept in the tree
+  bool streaming = sca_streaming();
+  if(SCA_globals::getGlobals()->function_hash()[func_id] || !file ||
+     (streaming && SCA_globals::getGlobals()->isStreamed(SCA::Obj::kFunction, func_id))) {
     // Already this function is processed. This function is present in a 
     // header file and hence being parsed once again
     return CXChildVisit_Continue;
   }
   SCA::Function* cur_func = NULL;
+  SCA::Class *parent_class = NULL;
   if(CXCursor_FunctionDecl == clang_getCursorKind(cursor)) {
     // C-function
-    cur_func = new SCA::Function(file, // Parent: SCA::File
-                                 clang_getCString(clang_getCursorSpelling(cursor)), // Function name
-                                 func_id); // Function Id
-    SCA_globals::getGlobals()->function_hash().insert(func_id, cur_func);
+    if(streaming) {
+      cur_func = new(cntxt->scratch_) SCA::Function(NULL,
+                                                    getCursorSpelling(cursor),
+                                                    func_id);
+    } else {
+      cur_func = new SCA::Function(file, // Parent: SCA::File
+                                   getCursorSpelling(cursor), // Function name
+                                   func_id); // Function Id
+      SCA_globals::getGlobals()->function_hash().insert(func_id, cur_func);
+    }
   } else {
     // C++ method
     CXCursor class_decl = clang_getCursorSemanticParent(cursor);
     if(CXCursor_ClassDecl != clang_getCursorKind(class_decl)) {
      return CXChildVisit_Continue;
     }
-    ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(class_decl));  
-    SCA::Class *parent_class = SCA_globals::getGlobals()->class_hash()[class_id];
+    ClassId class_id = static_cast<ClassId>(getSourceIdFromCursor(class_decl, cntxt));  
+    parent_class = SCA_globals::getGlobals()->class_hash()[class_id];
 #if 0
     if(NULL == parent_class) {
        // Create the class if not present
@@ -211,9 +324,17 @@ CXChildVisitResult FunctionDefinition_visitor(CXCursor cursor,
       return CXChildVisit_Continue;
     }
     assert(parent_class);
-    SCA::Method *cur_method = new SCA::Method(parent_class, 
-                                              clang_getCString(clang_getCursorSpelling(cursor)),
-                                              func_id);
+    SCA::Method *cur_method = NULL;
+    if(streaming) {
+      cur_method = new(cntxt->scratch_) SCA::Method(NULL,
+                                                    getCursorSpelling(cursor),
+                                                    func_id);
+    } else {
+      cur_method = new SCA::Method(parent_class, 
+                                   getCursorSpelling(cursor),
+                                   func_id);
+      SCA_globals::getGlobals()->function_hash().insert(func_id, cur_method);
+    }
     cur_method->set_isStatic(clang_CXXMethod_isStatic(cursor));
     cur_method->set_isVirtual(clang_CXXMethod_isVirtual(cursor));
     cur_func = cur_method;
@@ -225,15 +346,54 @@ CXChildVisitResult FunctionDefinition_visitor(CXCursor cursor,
   cntxt->max_complexity_     = 0;
   cur_func->set_num_lines(getLineScopeFromCursor(cursor));
   cur_func->set_param_size(clang_Cursor_getNumArguments(cursor));
+  cur_func->set_usr(getUsrHashFromCursor(cursor));
+  cntxt->callees_.clear();
   // Visit the function body
+  double start_time = SCA_globals::getGlobals()->stats_enabled() ? sca_time_now() : 0;
+  SCA::WalkFrame root;
+  root.cursor_ = cursor;
+  cntxt->walk_stack_.clear();
+  cntxt->walk_stack_.push_back(root);
   clang_visitChildren(cursor, FunctionBody_visitor, (void*)cntxt); 
+  if(SCA_globals::getGlobals()->stats_enabled()) {
+    cntxt->walk_time_ += sca_time_now() - start_time;
+  }
   // Use the calculated metrics 
   cur_func->set_max_nesting(cntxt->max_nesting_);
   cur_func->set_cyclomatic(cntxt->max_cyclomatic_);
   cur_func->set_complexity(cntxt->max_complexity_);
+  // The callees are resolved to functions once all the TUs are in
+  std::vector<ULL> &callees = cntxt->callees_;
+  std::sort(callees.begin(), callees.end());
+  callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+  cur_func->set_callees(callees.empty() ? NULL : &callees[0], callees.size(),
+                        streaming ? cntxt->scratch_ : SCA_globals::getGlobals()->obj_arena());
+  setHalsteadCounts(cursor, cur_func, cntxt);
+  if(streaming) {
+    // Marked only now. A method skipped above for want of its class is
+    // written by the TU that has the class
+    SCA_globals::getGlobals()->markStreamed(SCA::Obj::kFunction, func_id);
+    if(parent_class) {
+      sca_stream_method(static_cast<SCA::Method*>(cur_func), parent_class);
+    } else {
+      sca_stream_function(cur_func, file);
+    }
+  }
   return CXChildVisit_Continue;
 }
 
+//==============================================================================
+///      \brief Whether the cursor is in a file that needs no walk. Either
+//              an earlier TU of the session walked it or SCA does not track
+//              it (i.e <vector>) and would drop all its definitions anyway
+//==============================================================================
+bool isCursorInPrunedFile(CXCursor cursor, SCA::Context *cntxt) {
+  CXFile file;
+  clang_getFileLocation(clang_getCursorLocation(cursor), &file, NULL, NULL, NULL);
+  SCA::FileVisit *visit = resolveFile(file, cntxt);
+  return visit && visit->pruned_;
+}
+
 //==============================================================================
 ///      \brief Visits the source file
 //==============================================================================
@@ -241,6 +401,11 @@ CXChildVisitResult SourceFile_visitor(CXCursor cursor,
                                       CXCursor parent, 
                                       CXClientData client_data) {
   SCA::Context *cntxt = static_cast<SCA::Context*>(client_data);
+  // Declarations of headers walked by an earlier TU are not walked again
+  if(clang_isDeclaration(clang_getCursorKind(cursor)) &&
+      isCursorInPrunedFile(cursor, cntxt)) {
+    return CXChildVisit_Continue;
+  }
   // Visit the function/Method definition
   if((CXCursor_FunctionDecl == clang_getCursorKind(cursor) || 
         CXCursor_CXXMethod == clang_getCursorKind(cursor)) &&
@@ -260,6 +425,129 @@ CXChildVisitResult SourceFile_visitor(CXCursor cursor,
   return CXChildVisit_Recurse;
 }
 
+//==============================================================================
+///      \brief Inclusion visitor. Collects the files of the TU
+//==============================================================================
+static void collect_cxfile(CXFile file,
+                           CXSourceLocation *stack,
+                           unsigned stack_len,
+                           CXClientData client_data) {
+  static_cast<std::vector<CXFile>*>(client_data)->push_back(file);
+}
+
+//==============================================================================
+///      \brief Visits the TU for the function definitions the visitors walk
+//==============================================================================
+CXChildVisitResult Lexer_visitor(CXCursor cursor,
+                                 CXCursor parent,
+                                 CXClientData client_data) {
+  SCA::Context *cntxt = static_cast<SCA::Context*>(client_data);
+  CXCursorKind kind = clang_getCursorKind(cursor);
+  if(!clang_isDeclaration(kind)) {
+    return CXChildVisit_Recurse;
+  }
+  // resolveFile() reads the tree. The included files are resolved under
+  // the lock before the walk, the files that came in a PCH are not listed
+  // as inclusions and are resolved here
+  CXFile file;
+  clang_getFileLocation(clang_getCursorLocation(cursor), &file, NULL, NULL, NULL);
+  std::map<CXFile, SCA::FileVisit>::iterator it = cntxt->files_.find(file);
+  if(it == cntxt->files_.end() && file) {
+    SCA_globals::getGlobals()->lock();
+    resolveFile(file, cntxt);
+    SCA_globals::getGlobals()->unlock();
+    it = cntxt->files_.find(file);
+  }
+  if(it == cntxt->files_.end() || it->second.pruned_) {
+    return CXChildVisit_Continue;
+  }
+  if((CXCursor_FunctionDecl == kind || CXCursor_CXXMethod == kind) &&
+     clang_isCursorDefinition(cursor)) {
+    // Same as FunctionDefinition_visitor, the methods of templates are left
+    // out and so are their files if that is all they have
+    if(CXCursor_FunctionDecl == kind ||
+       CXCursor_ClassDecl == clang_getCursorKind(clang_getCursorSemanticParent(cursor))) {
+      countHalsteadTokens(cursor, &it->second, cntxt);
+    }
+    return CXChildVisit_Continue;
+  }
+  return CXChildVisit_Recurse;
+}
+
+//==============================================================================
+///      \brief Tokenize the files of the TU and count the tokens of their
+//              functions, before the lock. The lock is taken only to tell
+//              the files walked by the earlier TUs
+//==============================================================================
+void sca_lex_translation_unit(CXTranslationUnit TU, SCA::Context *cntxt) {
+  std::vector<CXFile> files;
+  clang_getInclusions(TU, collect_cxfile, &files);
+  SCA_globals::getGlobals()->lock();
+  for(size_t i=0; i<files.size(); i++) {
+    resolveFile(files[i], cntxt);
+  }
+  SCA_globals::getGlobals()->unlock();
+  double start_time = SCA_globals::getGlobals()->stats_enabled() ? sca_time_now() : 0;
+  CXCursor cursor = clang_getTranslationUnitCursor(TU);
+  clang_visitChildren(cursor, Lexer_visitor, (void*)cntxt);
+  // Only the counts are needed from here on
+  std::map<CXFile, SCA::FileVisit>::iterator it;
+  for(it=cntxt->files_.begin(); it!=cntxt->files_.end(); it++) {
+    std::vector<SCA::Lexeme>().swap(it->second.lexemes_);
+  }
+  if(SCA_globals::getGlobals()->stats_enabled()) {
+    cntxt->lex_time_ += sca_time_now() - start_time;
+  }
+}
+
+//==============================================================================
+///      \brief Visit the whole translation unit and fill the SCA tree
+//==============================================================================
+void sca_visit_translation_unit(CXTranslationUnit TU, SCA::Context *cntxt) {
+  // Another TU may have walked a file since sca_lex_translation_unit
+  std::map<CXFile, SCA::FileVisit>::iterator it;
+  for(it=cntxt->files_.begin(); it!=cntxt->files_.end(); it++) {
+    FileId id = FileIdMgr::getFileIdMgr()->getFileId(it->second.path_);
+    if(id != INVALID_FILE_ID && SCA_globals::getGlobals()->isFileAnalyzed(id)) {
+      it->second.pruned_ = true;
+    }
+  }
+  CXCursor cursor = clang_getTranslationUnitCursor(TU);
+  clang_visitChildren(cursor, SourceFile_visitor, (void*)cntxt);
+  SCA_globals::getGlobals()->stats().body_cursors_   += cntxt->num_cursors_;
+  SCA_globals::getGlobals()->stats().body_walk_time_ += cntxt->walk_time_;
+  SCA_globals::getGlobals()->stats().file_lookups_   += cntxt->file_lookups_;
+  SCA_globals::getGlobals()->stats().file_misses_    += cntxt->files_.size();
+  SCA_globals::getGlobals()->stats().lexemes_        += cntxt->num_lexemes_;
+  SCA_globals::getGlobals()->stats().lex_time_       += cntxt->lex_time_;
+  for(it=cntxt->files_.begin(); it!=cntxt->files_.end(); it++) {
+    SCA::File *file = it->second.file_;
+    if(file && !file->isMeasured()) {
+      // The contents are in the TU already, the file need not be read
+      size_t size = 0;
+      const char *data = clang_getFileContents(TU, it->first, &size);
+      if(data) {
+        file->set_size(size, countLines(data, size));
+      }
+    }
+    // Everything this TU walked need not be walked by the later TUs
+    if(it->second.pruned_) {
+      continue;
+    }
+    if(file) {
+      file->set_external_includes(it->second.external_includes_);
+    }
+    FileId id = FileIdMgr::getFileIdMgr()->getFileId(it->second.path_);
+    if(id != INVALID_FILE_ID) {
+      SCA_globals::getGlobals()->markFileAnalyzed(id);
+    }
+  }
+  // The records of the TU are visible to the reader as soon as it is done
+  if(sca_streaming()) {
+    SCA_GET_WRITER().flush();
+  }
+}
+
 //==============================================================================
 ///      \brief Cleans up the global vars
 //==============================================================================
@@ -275,51 +563,161 @@ int main(int argc, char* argv[]) {
     fprintf(stdout, "getcwd() error");
     exit(0);
   }
-  bool contains_atleast_one_file = false;
-  for(int i=0; i<argc; i++) {
+  SCA_globals::getGlobals()->set_stats_enabled(getenv("SCA_STATS") != NULL);
+  for(int i=1; i<argc; i++) {
+    if(!strncmp(argv[i], "--sca-daemon=", 13)) {
+      // Keep the TUs resident and serve the clients on the socket
+      SCA::Daemon daemon(std::string(argv[i] + 13));
+      return daemon.run();
+    }
+    if(!strncmp(argv[i], "--sca-bench-hash=", 17)) {
+      // Measure the lookup tables, i.e --sca-bench-hash=1000000
+      sca_bench_hash(strtoul(argv[i] + 17, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-inheritance=", 24)) {
+      // Measure the width/depth pass, i.e --sca-bench-inheritance=200000
+      sca_bench_inheritance(strtoul(argv[i] + 24, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-callgraph=", 22)) {
+      // Measure the call graph, i.e --sca-bench-callgraph=5000000
+      sca_bench_callgraph(strtoul(argv[i] + 22, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-includes=", 21)) {
+      // Measure the include graph, i.e --sca-bench-includes=20000
+      sca_bench_includes(strtoul(argv[i] + 21, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-packages=", 21)) {
+      // Measure the package graph, i.e --sca-bench-packages=10000
+      sca_bench_packages(strtoul(argv[i] + 21, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-walk=", 17)) {
+      // Measure the walk of the function bodies, i.e --sca-bench-walk=100
+      sca_bench_walk(strtoul(argv[i] + 17, NULL, 10));
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-selfcheck=", 16)) {
+      // Check the readers on the fixtures, i.e --sca-selfcheck=fixtures
+      return sca_selfcheck(argv[i] + 16) ? 1 : 0;
+    }
+    if(!strncmp(argv[i], "--sca-bench-json=", 17)) {
+      // Measure the JSON reader, i.e --sca-bench-json=out.json
+      sca_bench_json(argv[i] + 17);
+      return 0;
+    }
+    if(!strncmp(argv[i], "--sca-client=", 13)) {
+      // Let the daemon do the analysis
+      return sca_client(std::string(argv[i] + 13), argc, argv);
+    }
+  }
+  SCA::Driver driver;
+  SCA::PreambleCache *preamble_cache = NULL;
+  SCA::ResultCache *result_cache = NULL;
+  // Results of earlier runs to be merged in
+  SCA::InputMerger merger;
+  int num_jobs = 1;
+  const char *out_file = NULL;
+  // Sources to be parsed and the compiler args they are parsed with
+  std::vector<std::string> sources;
+  std::vector<std::string> args;
+  for(int i=1; i<argc; i++) {
     if(!strcmp(argv[i], "-o")) {
-      // The parsed info will be written to this file
-      FILE *fp = fopen(argv[i+1], "w");
-      if(fp == NULL) {
-        exit(0);
+      // The parsed info will be written to this file, or to this directory
+      // with --sca-format=shards. Opened once the format is known
+      out_file = argv[i+1];
+      i++;
+    } else if(!strncmp(argv[i], "--sca-jobs=", 11)) {
+      // Number of TUs parsed in parallel. 0 means one per CPU
+      num_jobs = atoi(argv[i] + 11);
+      if(num_jobs <= 0) {
+        num_jobs = SCA::WorkQueue::num_cpus();
+      }
+    } else if(!strncmp(argv[i], "--sca-cdb=", 10)) {
+      // Directory holding the compile_commands.json
+      if(!driver.loadCompilationDatabase(std::string(argv[i] + 10))) {
+        fprintf(stderr, "sca: could not load compile_commands.json from %s\n", argv[i] + 10);
+        exit(1);
       }
-      SCA_globals::getGlobals()->set_write_descriptor(fp); 
+    } else if(!strncmp(argv[i], "--sca-pch-dir=", 14)) {
+      // Cache directory for the precompiled include blocks
+      preamble_cache = new SCA::PreambleCache(std::string(argv[i] + 14));
+      driver.set_preamble_cache(preamble_cache);
+    } else if(!strncmp(argv[i], "--sca-cache-dir=", 16)) {
+      // Cache directory for the results of the TUs
+      result_cache = new SCA::ResultCache(std::string(argv[i] + 16));
+      driver.set_result_cache(result_cache);
+    } else if(!strcmp(argv[i], "--sca-compact")) {
+      // No indentation or newlines in the output
+      SCA_GET_WRITER().set_compact(true);
+    } else if(!strncmp(argv[i], "--sca-format=", 13)) {
+      // "json" (default), "bin" or "ndjson"
+      SCA::OutputFormat format;
+      if(!parseOutputFormat(argv[i] + 13, format)) {
+        fprintf(stderr, "sca: unknown output format %s\n", argv[i] + 13);
+        exit(1);
+      }
+      SCA_GET_WRITER().set_format(format);
+    } else if(!strncmp(argv[i], "--sca-sqlite=", 13)) {
+      // Also export the tree to an SQLite database
+      SCA_globals::getGlobals()->set_sqlite_path(std::string(argv[i] + 13));
+    } else if(isOptionWithValue(argv[i]) && (i+1 < argc)) {
+      // The value is not a file to be parsed even if it looks like one
+      args.push_back(argv[i]);
+      args.push_back(argv[i+1]);
       i++;
     } else {
       std::string cur_file = std::string(argv[i]);
-      if(isFileOfInterest(cur_file) && isJsonFile(cur_file)) {
-        fprintf(stdout, "Found a JSON file whiile compiling %s\n", cur_file.c_str());
-        JsonParser parser;
-        parser.parse(cur_file);  
-      } else {
-        if(isFileOfInterest(cur_file)) {
-          contains_atleast_one_file = true;
-        }
+      if(isFileOfInterest(cur_file) && merger.add(cur_file)) {
+        // Output of an earlier run, merged in to the tree below
+      } else if(getType(cur_file) == SCA::File::kSource || 
+                getType(cur_file) == SCA::File::kHeader) {
+        sources.push_back(cur_file);
+      } else if(!isFileOfInterest(cur_file)) {
+        args.push_back(cur_file);
       }
     }
   }
+  if(SCA_GET_WRITER().format() == SCA::kFormatShards) {
+    if(NULL == out_file) {
+      fprintf(stderr, "sca: --sca-format=shards needs the directory of the shards in -o\n");
+      exit(1);
+    }
+    SCA_globals::getGlobals()->set_shard_dir(std::string(out_file));
+  } else if(out_file) {
+    FILE *fp = fopen(out_file, "w");
+    if(fp == NULL) {
+      exit(0);
+    }
+    SCA_globals::getGlobals()->set_write_descriptor(fp); 
+  }
+  merger.run(num_jobs);
+  if(result_cache && sca_streaming()) {
+    // The entries are made from the tree, which the streaming mode does
+    // not keep
+    fprintf(stderr, "sca: --sca-cache-dir is ignored with --sca-format=ndjson\n");
+    driver.set_result_cache(NULL);
+  }
   //  If user has not specified -o then set it to stdout
   if(NULL == SCA_GET_WRITE_PTR()) {
     SCA_globals::getGlobals()->set_write_descriptor(stdout);
   }
+  for(size_t i=0; i<sources.size(); i++) {
+    driver.addSource(sources[i], args);
+  }
   // If user has passed atleast one source file then proceed
-  if(contains_atleast_one_file) {
-    /* Create an index */
-    CXIndex Idx;
-    Idx = clang_createIndex(0, 1);
-    /* Create a translation unit */
-    CXTranslationUnit TU;
-    TU = clang_createTranslationUnitFromSourceFile(Idx, NULL, argc, argv, 0, 0); 
-    /* Get the cursor */
-    CXCursor cursor = clang_getTranslationUnitCursor(TU);
-    // Create a context
-    SCA::Context cntxt;
-    // Parse the file
-    clang_visitChildren(cursor, SourceFile_visitor, (void*)&cntxt);
-    /* Clean up */
-    clang_disposeTranslationUnit(TU);
-    clang_disposeIndex(Idx);
+  if(driver.cJobs()) {
+    driver.set_num_workers(num_jobs);
+    driver.run();
   }
+  delete preamble_cache;
+  delete result_cache;
   sca_analyzer();
+  if(SCA_globals::getGlobals()->stats_enabled()) {
+    sca_dump_stats();
+  }
   clean_up();
 }
@@ -12,24 +12,42 @@
  *      06/09/14 08:48:19 PDT Created By Prakash S
  *
  *  ----------------------------------------------------------*/
+#include <algorithm>
+#include <sys/resource.h>
+#include <clang-c/Index.h>
 #include "sca_int.hh"
 #include "sca_utils.hh"
 #include "sca_globals.hh"
+#include "sca_analyzer.hh"
+#include "sca_json_reader.hh"
+#include "sca_binary.hh"
+#include "sca_stream.hh"
+#include "sca_sqlite.hh"
+#include "sca_shard.hh"
+#include "sca_visitor.hh"
+
+/// Depth of a class whose derived classes are being walked
+#define DEPTH_IN_PROGRESS -2
+
+/// A class on the walk and the next of its derived classes to look at
+struct InheritanceFrame {
+  SCA::Class *cls_;
+  size_t next_;
+};
 
 //==============================================================================
-///      \method recursive_depth_width 
-///      \brief Recursive function to calculate the depth
+///      \method depth_of_derived 
+///      \brief  Depth of a class once all its derived classes are done i.e
+//               the longest chain of derived classes below it
 //==============================================================================
-int recursive_depth_width(SCA::Class *obj, int depth) {
+static int depth_of_derived(SCA::Class *obj) {
+  int max_depth = 0;
   SCA::ClassList &inherited_to = obj->inherited_to();
-  /// Set the width first
-  obj->set_width(inherited_to.size());
-  /// Now recursively find the depth
-  int max_depth = depth;
   for(SCA::ClassList::iterator it=inherited_to.begin(); it!=inherited_to.end(); it++) {
-    int cur_depth = recursive_depth_width((*it), (depth+1)); 
-    if(cur_depth > max_depth) {
-      max_depth = cur_depth;
+    // A class still in progress closes a cycle, which C++ does not allow
+    // but a broken input might have. It adds nothing
+    if((*it)->depth() >= 0 && (*it)->depth() + 1 > max_depth) {
+      max_depth = (*it)->depth() + 1;
     }
   }
   return max_depth;
@@ -37,47 +55,788 @@ int recursive_depth_width(SCA::Class *obj, int depth) {
 
 //==============================================================================
 ///      \method calculate_width_depth 
-///      \brief  Calculate the inheritance depth of all the class
-//               TODO: Highly inefficient code. Will revisit it later
+///      \brief  Calculate the inheritance width/depth of all the classes.
+//               The depth of a class is the longest chain of classes derived
+//               from it and its width the number of classes derived from it
+//               directly. Depth-first walk of the derived classes with an
+//               explicit stack, in post order, so every class is done once
+//               its derived classes are. A class derived along several
+//               paths (i.e a diamond) is done once and the other paths use
+//               its depth. O(classes + inheritance edges)
+//
+//               Classes merged from the inputs come with their width/depth
+//               and are left alone
 //==============================================================================
 void 
 calculate_width_depth(void) {
-  std::map<SourceId, SCA::Class*> &all_classes = SCA_globals::getGlobals()->class_hash().container();  
-  std::map<SourceId, SCA::Class*>::iterator it;
-  for(it=all_classes.begin(); it!= all_classes.end(); it++) {
-    SCA::Class *cur_obj = it->second;;
-    if(cur_obj->depth() == -1) {
-      int depth = recursive_depth_width(cur_obj, 0);
-      cur_obj->set_depth(depth);
+  std::vector<SCA::Class*> all_classes;
+  SCA_globals::getGlobals()->class_hash().values(all_classes);
+  std::vector<InheritanceFrame> stack;
+  for(size_t i=0; i<all_classes.size(); i++) {
+    if(all_classes[i]->depth() != -1) {
+      continue;
+    }
+    InheritanceFrame root = { all_classes[i], 0 };
+    root.cls_->set_width(root.cls_->inherited_to().size());
+    root.cls_->set_depth(DEPTH_IN_PROGRESS);
+    stack.push_back(root);
+    while(!stack.empty()) {
+      InheritanceFrame &top = stack.back();
+      SCA::ClassList &inherited_to = top.cls_->inherited_to();
+      if(top.next_ < inherited_to.size()) {
+        InheritanceFrame child = { inherited_to[top.next_++], 0 };
+        if(child.cls_->depth() == -1) {
+          child.cls_->set_width(child.cls_->inherited_to().size());
+          child.cls_->set_depth(DEPTH_IN_PROGRESS);
+          stack.push_back(child);
+        }
+        continue;
+      }
+      top.cls_->set_depth(depth_of_derived(top.cls_));
+      stack.pop_back();
+    }
+  }
+}
+
+//==============================================================================
+///      \method calculate_call_graph 
+///      \brief  Resolve the calls of all the functions in the tree, which
+//               sets their fan-in/fan-out and recursion cycle. Done for the
+//               merged inputs too, their calls may reach each other
+//==============================================================================
+void 
+calculate_call_graph(void) {
+  double start_time = sca_time_now();
+  std::vector<SCA::Function*> all_functions;
+  SCA_globals::getGlobals()->function_hash().values(all_functions);
+  SCA::CallGraph &graph = SCA_globals::getGlobals()->call_graph();
+  graph.build(all_functions);
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  stats.callgraph_nodes_      = graph.num_nodes();
+  stats.callgraph_edges_      = graph.num_edges();
+  stats.callgraph_unresolved_ = graph.num_unresolved();
+  stats.callgraph_cycles_     = graph.num_cycles();
+  stats.callgraph_bytes_      = graph.num_bytes();
+  stats.callgraph_time_       = sca_time_now() - start_time;
+}
+
+//==============================================================================
+///      \method calculate_include_graph 
+///      \brief  Close the include graph of all the files in the tree, which
+//               sets how many TUs every file is part of and its size along
+//               with all it includes. Done for the merged inputs too, as
+//               their TUs count for the headers they share
+//==============================================================================
+void 
+calculate_include_graph(void) {
+  double start_time = sca_time_now();
+  std::vector<SCA::File*> all_files;
+  for(FileId id=0; id<FileIdMgr::getFileIdMgr()->cFiles(); id++) {
+    all_files.push_back(SCA_FILE(id));
+  }
+  SCA::IncludeGraph &graph = SCA_globals::getGlobals()->include_graph();
+  graph.build(all_files);
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  stats.include_files_   = graph.num_nodes();
+  stats.include_edges_   = graph.num_edges();
+  stats.include_headers_ = graph.num_headers();
+  stats.include_cycles_  = graph.num_cycles();
+  stats.include_bytes_   = graph.num_bytes();
+  stats.include_time_    = sca_time_now() - start_time;
+}
+
+//==============================================================================
+///      \method package_of 
+///      \brief  Package of a function or method, through its file and class
+//==============================================================================
+static PkgId package_of(const SCA::Obj *obj) {
+  while(obj && obj->type() != SCA::Obj::kPackage) {
+    obj = obj->parent();
+  }
+  return obj ? static_cast<const SCA::Package*>(obj)->id() : INVALID_PKG_ID;
+}
+
+//==============================================================================
+///      \brief  Order of the packages by name. The PkgIds depend on the order
+//               the TUs and the inputs were added in
+//==============================================================================
+static bool packageNameBefore(PkgId a, PkgId b) {
+  return strcmp(SCA_PKG(a)->name(), SCA_PKG(b)->name()) < 0;
+}
+
+//==============================================================================
+///      \method calculate_package_graph 
+///      \brief  Derive the dependencies between the packages from the
+//               includes and the calls that cross them, so it runs after the
+//               include and call graphs. Sets the direct dependencies,
+//               sorted by name, layer, cycle and transitive counts of every
+//               package
+//==============================================================================
+void 
+calculate_package_graph(void) {
+  double start_time = sca_time_now();
+  PkgId num_pkgs = PkgIdMgr::getPkgIdMgr()->cPkgs();
+  SCA::PackageGraph &graph = SCA_globals::getGlobals()->package_graph();
+  graph.reset(num_pkgs);
+  for(FileId id=0; id<FileIdMgr::getFileIdMgr()->cFiles(); id++) {
+    SCA::File *file = SCA_FILE(id);
+    const SCA::ArenaVector<FileId> &includes = file->direct_includes();
+    for(size_t k=0; k<includes.size(); k++) {
+      graph.add_dependency(file->pkgId(), SCA_FILE(includes[k])->pkgId());
+    }
+  }
+  SCA::CallGraph &calls = SCA_globals::getGlobals()->call_graph();
+  std::vector<PkgId> pkg_of(calls.num_nodes());
+  for(U n=0; n<calls.num_nodes(); n++) {
+    pkg_of[n] = package_of(calls.node(n));
+  }
+  for(U n=0; n<calls.num_nodes(); n++) {
+    const U *callees = calls.callees(n);
+    for(U k=0; k<calls.num_callees(n); k++) {
+      graph.add_dependency(pkg_of[n], pkg_of[callees[k]]);
+    }
+  }
+  graph.build();
+  std::vector<PkgId> dep_ids;
+  for(PkgId id=0; id<num_pkgs; id++) {
+    SCA::Package *pkg = SCA_PKG(id);
+    pkg->clear_dependent_packages();
+    dep_ids.clear();
+    const ULL *deps = graph.dependencies(id);
+    for(U w=0; w<graph.num_words(); w++) {
+      for(ULL bits=deps[w]; bits; bits &= bits - 1) {
+        dep_ids.push_back((w << 6) + lowest_bit(bits));
+      }
+    }
+    // By name, so that a direct, a cached and a merged run list them alike
+    std::sort(dep_ids.begin(), dep_ids.end(), packageNameBefore);
+    for(size_t k=0; k<dep_ids.size(); k++) {
+      pkg->insert_dependent_package(dep_ids[k]);
     }
+    pkg->set_layer(graph.layer(id));
+    pkg->set_cycle(graph.cycle(id));
+    pkg->set_reach(graph.num_reach(id), graph.num_dependents(id));
   }
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  stats.package_nodes_  = graph.num_nodes();
+  stats.package_edges_  = graph.num_edges();
+  stats.package_cycles_ = graph.num_cycles();
+  stats.package_layers_ = graph.num_layers();
+  stats.package_bytes_  = graph.num_bytes();
+  stats.package_time_   = sca_time_now() - start_time;
+}
+
+//==============================================================================
+///      \method isPackageOfInterest 
+///      \brief  Whether the package is under SCA_CLIENT_ROOT
+//==============================================================================
+bool isPackageOfInterest(const char *pkg_name) {
+  const char* client_root = getenv("SCA_CLIENT_ROOT");
+  return (NULL == client_root) || (NULL != strstr(pkg_name, client_root));
 }
 
 //==============================================================================
 ///      \method sca_analyzer 
 ///      \brief  Do all the globals analysis after parsing 
 //               1. Caculate the depth/width of inheritance tree
+//               2. Build the call graph
+//               3. Close the include graph
+//               4. Build the package graph
 //==============================================================================
 void sca_analyzer(void) {
   /// Calculate the width/depth of the inheritance tree
   calculate_width_depth();
-  const char* client_root = getenv("SCA_CLIENT_ROOT");
+  /// Resolve the calls
+  calculate_call_graph();
+  /// Count the TUs of the headers
+  calculate_include_graph();
+  /// Layer the packages
+  calculate_package_graph();
   std::vector<SCA::Package*> interested_packages;
   for(PkgId id=0; id < PkgIdMgr::getPkgIdMgr()->cPkgs(); id++) {
-     std::string pkg_name = SCA_PKG(id)->name();
-     if(client_root) {
-       if(std::string::npos == pkg_name.find(client_root, 0)) {
-         continue;
-       }
+     if(isPackageOfInterest(SCA_PKG(id)->name())) {
+       interested_packages.push_back(SCA_PKG(id));
      }
-     interested_packages.push_back(SCA_PKG(id));
+  }
+  const std::string &sqlite_path = SCA_globals::getGlobals()->sqlite_path();
+  if(!sqlite_path.empty() && sca_streaming()) {
+    // The functions were written out and dropped as they came
+    fprintf(stderr, "sca: --sca-sqlite is ignored with --sca-format=ndjson\n");
+  } else if(!sqlite_path.empty() && !sca_export_sqlite(interested_packages, sqlite_path)) {
+    fprintf(stderr, "sca: could not export to %s\n", sqlite_path.c_str());
   }
   /// Dump the output
-  fprintf(SCA_GET_WRITE_PTR(), "{\n");
-  fprintf(SCA_GET_WRITE_PTR(), "  \"pkg\" : [\n");
-  for(int i=0; i<interested_packages.size(); i++) {
-    interested_packages[i]->dump(i == (interested_packages.size()-1));
+  SCA::Writer &w = SCA_GET_WRITER();
+  if(w.format() == SCA::kFormatNdjson) {
+    // The TUs are already written, only the trailing records are left
+    sca_stream_tree(interested_packages);
+    w.flush();
+    return;
+  }
+  if(w.format() == SCA::kFormatBinary) {
+    SCA::BinaryWriter bin;
+    for(size_t i=0; i<interested_packages.size(); i++) {
+      bin.add(interested_packages[i]);
+    }
+    bin.write(w);
+    w.flush();
+    return;
+  }
+  if(w.format() == SCA::kFormatShards) {
+    sca_write_shards(interested_packages, SCA_globals::getGlobals()->shard_dir());
+    return;
+  }
+  sca_dump_json(interested_packages);
+  w.flush();
+}
+
+//==============================================================================
+///      \method sca_dump_json 
+///      \brief  Write the JSON document of the packages
+//==============================================================================
+void sca_dump_json(const std::vector<SCA::Package*> &pkgs) {
+  SCA::Writer &w = SCA_GET_WRITER();
+  w.line("", "{");
+  w.key("  ", "pkg", " : ");
+  w.end("[");
+  for(int i=0; i<pkgs.size(); i++) {
+    pkgs[i]->dump(i == (pkgs.size()-1));
+  }
+  w.line("            ", "]");
+  w.line("", "}");
+  if(w.compact()) {
+    // Still a text file
+    w.put('\n');
+  }
+}
+
+//==============================================================================
+///      \method sca_bench_hash 
+///      \brief  Time the insert and lookup of "count" SourceIds in a
+//               DoubleHash. 1000 functions per file, like a big code base
+//==============================================================================
+void sca_bench_hash(U count) {
+  std::vector<SourceId> ids;
+  ids.reserve(count);
+  char file_name[64];
+  FileId file_id = INVALID_FILE_ID;
+  for(U i=0; i<count; i++) {
+    if(i % 1000 == 0) {
+      snprintf(file_name, sizeof(file_name), "/src/pkg%u/file%u.cc", i / 100000, i / 1000);
+      file_id = FileIdMgr::getFileIdMgr()->insertFile(file_name);
+    }
+    ids.push_back(SourceId(file_id, 1 + (i % 1000) * 7));
+  }
+  int obj = 0;
+  DoubleHash<int> hash;
+  double start = sca_time_now();
+  for(U i=0; i<count; i++) {
+    hash.insert(ids[i], &obj);
+  }
+  double insert_time = sca_time_now() - start;
+  U found = 0;
+  start = sca_time_now();
+  for(U i=0; i<count; i++) {
+    found += (hash[ids[i]] != NULL);
+  }
+  double hit_time = sca_time_now() - start;
+  start = sca_time_now();
+  for(U i=0; i<count; i++) {
+    // Same files, lines that are never inserted
+    found += (hash[SourceId(ids[i].file_id(), ids[i].line_no() + 1)] != NULL);
+  }
+  double miss_time = sca_time_now() - start;
+  fprintf(stderr, "sca: %u ids, %u found\n", count, found);
+  fprintf(stderr, "sca: insert      : %.3f sec (%.1f M/sec)\n", insert_time, count / insert_time / 1e6);
+  fprintf(stderr, "sca: lookup hit  : %.3f sec (%.1f M/sec)\n", hit_time, count / hit_time / 1e6);
+  fprintf(stderr, "sca: lookup miss : %.3f sec (%.1f M/sec, includes building the id)\n", 
+          miss_time, count / miss_time / 1e6);
+}
+
+//==============================================================================
+///      \method sca_bench_json 
+///      \brief  Time the JSON reader on a file. The file is first read with
+//               the tree left alone (tokens and key lookup), then made in to
+//               objects of its own, still off the tree, and last spliced in
+//               to the tree. Only the splice is serial in a merge
+//==============================================================================
+void sca_bench_json(const char *file_name) {
+  std::string path(file_name);
+  JsonPartial partial;
+  JsonParser parser;
+  double start = sca_time_now();
+  int ret = parser.record(path, partial);
+  double read_time = sca_time_now() - start;
+  if(ret != JsonParser::kSuccess) {
+    fprintf(stderr, "sca: %s is not a valid SCA JSON file\n", file_name);
+    return;
+  }
+  JsonParser builder;
+  JsonStage objects;
+  start = sca_time_now();
+  builder.stage(partial, objects);
+  double stage_time = sca_time_now() - start;
+  start = sca_time_now();
+  objects.splice();
+  double splice_time = sca_time_now() - start;
+  double total_time = read_time + stage_time + splice_time;
+  ULL tokens = parser.num_tokens();
+  double mbytes = partial.size_ / 1048576.0;
+  fprintf(stderr, "sca: %llu tokens, %.0f MB, %lu objects\n", tokens, mbytes,
+          (unsigned long)objects.objects_.size());
+  fprintf(stderr, "sca: tokenize : %.3f sec (%.1f M tokens/sec, %.0f MB/sec)\n",
+          read_time, tokens / read_time / 1e6, mbytes / read_time);
+  fprintf(stderr, "sca: stage    : %.3f sec (%.1f M tokens/sec)\n",
+          stage_time, tokens / stage_time / 1e6);
+  fprintf(stderr, "sca: splice   : %.3f sec (%.1f M tokens/sec, %.1f%% of the total)\n",
+          splice_time, tokens / splice_time / 1e6, 100.0 * splice_time / total_time);
+  fprintf(stderr, "sca: total    : %.3f sec (%.1f M tokens/sec, %.0f MB/sec)\n",
+          total_time, tokens / total_time / 1e6, mbytes / total_time);
+}
+
+//==============================================================================
+///      \method sca_bench_walk_source
+///      \brief  A source of "num_funcs" functions whose bodies nest "depth"
+//               statements deep. The levels take turns at if, for, while,
+//               do and switch, each with a statement of its own
+//==============================================================================
+static std::string sca_bench_walk_source(U num_funcs, U depth) {
+  std::string src;
+  char line[128];
+  for(U f=0; f<num_funcs; f++) {
+    snprintf(line, sizeof(line), "int walk%u(int a, int b) {\n  int s = 0;\n", f);
+    src += line;
+    for(U i=0; i<depth; i++) {
+      snprintf(line, sizeof(line), "  s += a * %u - b;\n", i);
+      src += line;
+      switch(i % 5) {
+        case 0: snprintf(line, sizeof(line), "  if (a > %u) {\n", i); break;
+        case 1: snprintf(line, sizeof(line), "  for (int i%u = 0; i%u < b; ++i%u) {\n", i, i, i); break;
+        case 2: snprintf(line, sizeof(line), "  while (s < b + %u) {\n", i); break;
+        case 3: snprintf(line, sizeof(line), "  do {\n"); break;
+        default: snprintf(line, sizeof(line), "  switch (a) { case %u: {\n", i); break;
+      }
+      src += line;
+    }
+    src += "  s ^= a;\n";
+    for(U i=depth; i>0; i--) {
+      switch((i - 1) % 5) {
+        case 3: snprintf(line, sizeof(line), "  } while (s < %u);\n", i - 1); break;
+        case 4: snprintf(line, sizeof(line), "  } }\n"); break;
+        default: snprintf(line, sizeof(line), "  }\n"); break;
+      }
+      src += line;
+    }
+    src += "  return s;\n}\n";
+  }
+  return src;
+}
+
+//==============================================================================
+///      \method sca_bench_walk
+///      \brief  Time the walk of the function bodies on generated code that
+//               nests "depth" statements deep. The TU is parsed once and
+//               walked in to a new tree a few times, the best run counts
+//==============================================================================
+void sca_bench_walk(U depth) {
+  const U num_funcs = 256;
+  std::string src = sca_bench_walk_source(num_funcs, depth);
+  // The visitors need a real path for the file
+  char path[] = "/tmp/sca-bench-walk-XXXXXX.cc";
+  int fd = mkstemps(path, 3);
+  if(fd < 0 || write(fd, src.c_str(), src.size()) != (ssize_t)src.size()) {
+    fprintf(stderr, "sca: could not write %s\n", path);
+    if(fd >= 0) {
+      close(fd);
+      unlink(path);
+    }
+    return;
+  }
+  close(fd);
+  CXIndex idx = clang_createIndex(0, 0);
+  CXTranslationUnit TU = clang_parseTranslationUnit(idx, path, NULL, 0, NULL, 0,
+                                                    CXTranslationUnit_None);
+  unlink(path);
+  if(NULL == TU) {
+    fprintf(stderr, "sca: could not parse the generated source\n");
+    clang_disposeIndex(idx);
+    return;
+  }
+  bool stats_enabled = SCA_globals::getGlobals()->stats_enabled();
+  SCA_globals::getGlobals()->set_stats_enabled(true);
+  ULL cursors = 0;
+  double best = 0;
+  U max_nesting = 0;
+  for(int run=0; run<5; run++) {
+    SCA::Context cntxt;
+    sca_visit_translation_unit(TU, &cntxt);
+    if(0 == run || cntxt.walk_time_ < best) {
+      best = cntxt.walk_time_;
+    }
+    cursors = cntxt.num_cursors_;
+    std::vector<SCA::Function*> funcs;
+    SCA_globals::getGlobals()->function_hash().values(funcs);
+    max_nesting = funcs.empty() ? 0 : funcs[0]->max_nesting();
+    clean_up();
+  }
+  SCA_globals::getGlobals()->set_stats_enabled(stats_enabled);
+  clang_disposeTranslationUnit(TU);
+  clang_disposeIndex(idx);
+  fprintf(stderr, "sca: %u functions nested %u deep (max nesting %u), %llu cursors\n",
+          num_funcs, depth, max_nesting, cursors);
+  fprintf(stderr, "sca: walk : %.4f sec (%.0f cursors/sec)\n",
+          best, (best > 0) ? cursors / best : 0.0);
+}
+
+//==============================================================================
+///      \method sca_bench_inheritance 
+///      \brief  Time the width/depth pass on "count" classes. Every class
+//               derives from one of the 16 classes before it, which makes
+//               long chains, and one in four also derives from any earlier
+//               class, which makes diamonds
+//==============================================================================
+void sca_bench_inheritance(U count) {
+  FileId file_id = FileIdMgr::getFileIdMgr()->insertFile("/bench/classes.hh");
+  SCA::File *file = SCA_FILE(file_id);
+  std::vector<SCA::Class*> classes;
+  classes.reserve(count);
+  char name[32];
+  ULL num_edges = 0;
+  U seed = 12345;
+  for(U i=0; i<count; i++) {
+    snprintf(name, sizeof(name), "Class%u", i);
+    ClassId id = SourceId(file_id, i + 1);
+    SCA::Class *cls = new SCA::Class(file, name, id);
+    SCA_globals::getGlobals()->class_hash().insert(id, cls);
+    if(i) {
+      seed = seed * 1103515245 + 12345;
+      U base = (i > 16) ? i - 1 - ((seed >> 16) % 16) : i - 1;
+      classes[base]->addInheritedTo(cls);
+      num_edges++;
+      seed = seed * 1103515245 + 12345;
+      if(((seed >> 16) % 4) == 0) {
+        U other = (seed >> 8) % i;
+        if(other != base) {
+          classes[other]->addInheritedTo(cls);
+          num_edges++;
+        }
+      }
+    }
+    classes.push_back(cls);
+  }
+  double start = sca_time_now();
+  calculate_width_depth();
+  double time = sca_time_now() - start;
+  int max_depth = 0;
+  int max_width = 0;
+  for(U i=0; i<count; i++) {
+    max_depth = std::max(max_depth, classes[i]->depth());
+    max_width = std::max(max_width, classes[i]->width());
+  }
+  fprintf(stderr, "sca: %u classes, %llu inheritance edges, max depth %d, max width %d\n",
+          count, num_edges, max_depth, max_width);
+  fprintf(stderr, "sca: width/depth : %.3f sec (%.1f M classes+edges/sec)\n",
+          time, (count + num_edges) / time / 1e6);
+}
+
+//==============================================================================
+///      \method sca_bench_callgraph 
+///      \brief  Time the call graph on about "count" calls, 10 per function.
+//               Most calls go to one of the next 1000 functions, one in 16
+//               to one of the first 100, which are leaves (hubs), one in 10
+//               to a function that is not in the tree (i.e libc) and one in
+//               256 back to one of the 4 functions before, which makes small
+//               recursion cycles
+//==============================================================================
+void sca_bench_callgraph(U count) {
+  U num_funcs = (count / 10) ? count / 10 : 1;
+  FileId file_id = FileIdMgr::getFileIdMgr()->insertFile("/bench/calls.cc");
+  SCA::File *file = SCA_FILE(file_id);
+  SCA::Arena &arena = SCA_globals::getGlobals()->obj_arena();
+  std::vector<SCA::Function*> funcs;
+  funcs.reserve(num_funcs);
+  char name[32];
+  for(U i=0; i<num_funcs; i++) {
+    snprintf(name, sizeof(name), "function%u", i);
+    FuncId id = SourceId(file_id, i + 1);
+    SCA::Function *func = new SCA::Function(file, name, id);
+    func->set_usr(hash_bytes(name, strlen(name)));
+    SCA_globals::getGlobals()->function_hash().insert(id, func);
+    funcs.push_back(func);
+  }
+  ULL arena_bytes = arena.num_bytes();
+  std::vector<ULL> callees;
+  U seed = 12345;
+  for(U i=100; i<num_funcs; i++) {
+    callees.clear();
+    for(U c=0; c<10; c++) {
+      seed = seed * 1103515245 + 12345;
+      U r = seed >> 8;
+      U callee = i + 1 + (r >> 12) % 1000;
+      if((r % 256) == 7) {
+        callee = i - 1 - (r >> 12) % 4;
+      } else if((r % 16) == 3) {
+        callee = (r >> 12) % 100;
+      }
+      if((r % 10) == 0 || callee >= num_funcs) {
+        snprintf(name, sizeof(name), "extern%u", r % 5000);
+        callees.push_back(hash_bytes(name, strlen(name)));
+      } else {
+        callees.push_back(funcs[callee]->usr());
+      }
+    }
+  std::sort(callees.begin(), callees.end());
+    callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+    funcs[i]->set_callees(&callees[0], callees.size(), arena);
+  }
+  arena_bytes = arena.num_bytes() - arena_bytes;
+  calculate_call_graph();
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  U max_fan_in = 0;
+  U in_cycles = 0;
+  for(U i=0; i<num_funcs; i++) {
+    max_fan_in = std::max(max_fan_in, funcs[i]->fan_in());
+    in_cycles += (funcs[i]->scc() != 0);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(stderr, "sca: %llu functions, %llu calls, %llu unresolved, max fan-in %u\n",
+          stats.callgraph_nodes_, stats.callgraph_edges_, stats.callgraph_unresolved_,
+          max_fan_in);
+  fprintf(stderr, "sca: %llu cycles, %u functions in a cycle\n", stats.callgraph_cycles_, in_cycles);
+  fprintf(stderr, "sca: call graph : %.3f sec (%.1f M calls/sec)\n", stats.callgraph_time_,
+          stats.callgraph_edges_ / stats.callgraph_time_ / 1e6);
+  fprintf(stderr, "sca: memory     : graph %llu MB, callees %llu MB, tree %llu MB, max RSS %ld MB\n",
+          stats.callgraph_bytes_ >> 20, (ULL)arena_bytes >> 20,
+          arena.num_bytes() >> 20, usage.ru_maxrss / 1024);
+}
+
+/// Order of the files on what they add to the build, largest first
+static bool more_build_bytes(const SCA::File *a, const SCA::File *b) {
+  return a->build_bytes() > b->build_bytes();
+}
+
+//==============================================================================
+///      \method sca_bench_includes 
+///      \brief  Time the include graph on "count" files, a quarter of them
+//               sources. The headers are in modules of 64. A header includes
+//               3 headers of its module that come before it and one in 4 one
+//               of the first module too (i.e config.h, the base). A source
+//               includes 8 headers of a module, 2 of the base and 2 of any
+//               module. One header in 1024 also includes the one after it,
+//               which makes small include cycles
+//==============================================================================
+void sca_bench_includes(U count) {
+  U num_headers = (count * 3 / 4) ? count * 3 / 4 : 1;
+  U num_sources = (count > num_headers) ? count - num_headers : 1;
+  std::vector<SCA::File*> headers;
+  std::vector<SCA::File*> sources;
+  char name[64];
+  U seed = 12345;
+  for(U i=0; i<num_headers + num_sources; i++) {
+    bool isHeader = i < num_headers;
+    snprintf(name, sizeof(name), "/bench/inc%u/file%u.%s", i % 100, i, isHeader ? "h" : "cc");
+    SCA::File *file = SCA_FILE(FileIdMgr::getFileIdMgr()->insertFile(name));
+    seed = seed * 1103515245 + 12345;
+    U bytes = 1000 + (seed >> 8) % 30000;
+    file->set_size(bytes, bytes / 32);
+    (isHeader ? headers : sources).push_back(file);
+  }
+  U num_base = std::min(num_headers, 64U);
+  for(U i=1; i<num_headers; i++) {
+    U module = i - i % 64;
+    for(U k=0; k<3 && i > module; k++) {
+      seed = seed * 1103515245 + 12345;
+      headers[i]->insert_direct_include(headers[module + (seed >> 8) % (i - module)]->id());
+    }
+    seed = seed * 1103515245 + 12345;
+    U r = seed >> 8;
+    if((r % 4) == 1 && module) {
+      headers[i]->insert_direct_include(headers[(r >> 4) % num_base]->id());
+    }
+    if((r % 1024) == 5 && i + 1 < num_headers) {
+      headers[i]->insert_direct_include(headers[i + 1]->id());
+    }
+  }
+  for(U i=0; i<num_sources; i++) {
+    seed = seed * 1103515245 + 12345;
+    U module = ((seed >> 8) % num_headers) & ~63U;
+    U module_size = std::min(64U, num_headers - module);
+    for(U k=0; k<12; k++) {
+      seed = seed * 1103515245 + 12345;
+      U r = seed >> 8;
+      U header = (k < 8) ? module + r % module_size :
+                 (k < 10) ? r % num_base : r % num_headers;
+      sources[i]->insert_direct_include(headers[header]->id());
+    }
+  }
+  calculate_include_graph();
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  ULL tu_bytes = 0;
+  for(U i=0; i<num_sources; i++) {
+    tu_bytes += sources[i]->closure_bytes();
+  }
+  std::sort(headers.begin(), headers.end(), more_build_bytes);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(stderr, "sca: %llu files, %llu includes, %llu headers included, %llu cycles\n",
+          stats.include_files_, stats.include_edges_, stats.include_headers_,
+          stats.include_cycles_);
+  fprintf(stderr, "sca: %u TUs, %llu MB preprocessed, %llu MB per TU\n",
+          num_sources, tu_bytes >> 20, (tu_bytes / num_sources) >> 20);
+  for(U i=0; i<5 && i<headers.size(); i++) {
+    fprintf(stderr, "sca:   %s : %u TUs, %llu MB\n", headers[i]->name(),
+            headers[i]->num_tus(), headers[i]->build_bytes() >> 20);
+  }
+  fprintf(stderr, "sca: include graph : %.3f sec (%.1f M includes/sec)\n", stats.include_time_,
+          stats.include_edges_ / stats.include_time_ / 1e6);
+  fprintf(stderr, "sca: memory        : graph %llu MB, max RSS %ld MB\n",
+          stats.include_bytes_ >> 20, usage.ru_maxrss / 1024);
+}
+
+/// Order of the packages on the number of packages that depend on them,
+/// most first
+static bool more_dependents(const SCA::Package *a, const SCA::Package *b) {
+  return a->num_dependents() > b->num_dependents();
+}
+
+//==============================================================================
+///      \method sca_bench_packages 
+///      \brief  Time the package graph on "count" packages of 4 files. The
+//               packages are in tiers of 100, like the libraries of a big
+//               tree, and a file includes 2 headers of packages of the tiers
+//               below it. One package in 128 and the package after it also
+//               include a header of each other, a dependency cycle
+//==============================================================================
+void sca_bench_packages(U count) {
+  count = count ? count : 1;
+  std::vector<SCA::File*> files;
+  char name[64];
+  U seed = 12345;
+  for(U i=0; i<count * 4; i++) {
+    snprintf(name, sizeof(name), "/bench/pkg%u/file%u.h", i / 4, i % 4);
+    files.push_back(SCA_FILE(FileIdMgr::getFileIdMgr()->insertFile(name)));
+  }
+  for(U i=0; i<files.size(); i++) {
+    U pkg = i / 4;
+    U tier = pkg - pkg % 100;
+    for(U k=0; k<2 && tier; k++) {
+      seed = seed * 1103515245 + 12345;
+      files[i]->insert_direct_include(files[((seed >> 8) % tier) * 4 + k]->id());
+    }
+    seed = seed * 1103515245 + 12345;
+    if(((seed >> 8) % 512) == 3 && pkg + 1 < count) {
+      files[i]->insert_direct_include(files[(pkg + 1) * 4]->id());
+      files[(pkg + 1) * 4 + 3]->insert_direct_include(files[i]->id());
+    }
+  }
+  calculate_package_graph();
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  std::vector<SCA::Package*> pkgs;
+  for(PkgId id=0; id<PkgIdMgr::getPkgIdMgr()->cPkgs(); id++) {
+    pkgs.push_back(SCA_PKG(id));
+  }
+  std::sort(pkgs.begin(), pkgs.end(), more_dependents);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(stderr, "sca: %llu packages, %llu dependencies, %llu cycles, %llu layers\n",
+          stats.package_nodes_, stats.package_edges_, stats.package_cycles_,
+          stats.package_layers_);
+  for(U i=0; i<5 && i<pkgs.size(); i++) {
+    fprintf(stderr, "sca:   %s : layer %u, %u dependents, depends on %u\n", pkgs[i]->name(),
+            pkgs[i]->layer(), pkgs[i]->num_dependents(), pkgs[i]->num_reach());
+  }
+  fprintf(stderr, "sca: package graph : %.3f sec\n", stats.package_time_);
+  fprintf(stderr, "sca: memory        : graph %llu MB, max RSS %ld MB\n",
+          stats.package_bytes_ >> 20, usage.ru_maxrss / 1024);
+}
+
+//==============================================================================
+///      \method sca_dump_stats 
+///      \brief  Dump the SCA_STATS counters on stderr
+//==============================================================================
+void sca_dump_stats(void) {
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  fprintf(stderr, "sca: function bodies : %llu cursors in %.3f sec (%.0f cursors/sec)\n",
+          stats.body_cursors_, stats.body_walk_time_,
+          (stats.body_walk_time_ > 0) ? stats.body_cursors_ / stats.body_walk_time_ : 0.0);
+  if(stats.tus_) {
+    // Amdahl: the walks are serial, so no number of workers gets the TUs
+    // done faster than (parallel + locked) / locked
+    double total = stats.tu_parallel_time_ + stats.tu_locked_time_;
+    fprintf(stderr, "sca: TU workers      : %llu TUs, %.3f sec without the lock, %.3f sec holding it "
+            "(%.1f%% serial, at most %.1fx faster), %.3f sec waiting for their turn\n",
+            stats.tus_, stats.tu_parallel_time_, stats.tu_locked_time_,
+            (total > 0) ? 100.0 * stats.tu_locked_time_ / total : 0.0,
+            (stats.tu_locked_time_ > 0) ? total / stats.tu_locked_time_ : 0.0,
+            stats.tu_wait_time_);
+  }
+  if(stats.lexemes_) {
+    fprintf(stderr, "sca: halstead tokens : %llu tokens in %.3f sec (%.0f tokens/sec)\n",
+            stats.lexemes_, stats.lex_time_,
+            (stats.lex_time_ > 0) ? stats.lexemes_ / stats.lex_time_ : 0.0);
+  }
+  SCA::Arena &arena = SCA_globals::getGlobals()->obj_arena();
+  size_t num_funcs = SCA_globals::getGlobals()->function_hash().size();
+  if(num_funcs) {
+    fprintf(stderr, "sca: object arena    : %llu allocs, %llu KB in %lu blocks, %.3f mallocs per function\n",
+            arena.num_allocs(), arena.num_bytes() / 1024, (unsigned long)arena.num_blocks(),
+            (double)arena.num_blocks() / num_funcs);
+  }
+  if(stats.file_lookups_) {
+    fprintf(stderr, "sca: file resolver   : %llu lookups, %.1f%% hits per TU\n",
+            stats.file_lookups_, 
+            100.0 * (stats.file_lookups_ - stats.file_misses_) / stats.file_lookups_);
+  }
+  if(stats.path_lookups_) {
+    fprintf(stderr, "sca: realpath cache  : %llu lookups, %.1f%% hits\n",
+            stats.path_lookups_,
+            100.0 * (stats.path_lookups_ - stats.path_misses_) / stats.path_lookups_);
+  }
+  if(stats.merged_inputs_) {
+    fprintf(stderr, "sca: merged inputs   : %llu files, %llu MB in %.3f sec (%.0f MB/sec)\n",
+            stats.merged_inputs_, stats.merged_bytes_ >> 20, stats.merge_time_,
+            (stats.merge_time_ > 0) ? (stats.merged_bytes_ / 1048576.0) / stats.merge_time_ : 0.0);
+    if(stats.merged_tokens_) {
+      fprintf(stderr, "sca: JSON reader     : %llu tokens (%.1f M tokens/sec)\n",
+              stats.merged_tokens_,
+              (stats.merge_time_ > 0) ? stats.merged_tokens_ / stats.merge_time_ / 1e6 : 0.0);
+    }
+    // Amdahl: the splices are serial, so no number of workers merges
+    // faster than (read + splice) / splice
+    double total = stats.merge_read_time_ + stats.merge_splice_time_;
+    fprintf(stderr, "sca: merge workers   : %.3f sec reading and staging, %.3f sec splicing "
+            "(%.1f%% serial, at most %.1fx faster)\n",
+            stats.merge_read_time_, stats.merge_splice_time_,
+            (total > 0) ? 100.0 * stats.merge_splice_time_ / total : 0.0,
+            (stats.merge_splice_time_ > 0) ? total / stats.merge_splice_time_ : 0.0);
+  }
+  if(stats.sqlite_rows_) {
+    fprintf(stderr, "sca: sqlite export   : %llu rows in %.3f sec (%.0f rows/sec), indices in %.3f sec\n",
+            stats.sqlite_rows_, stats.sqlite_insert_time_,
+            (stats.sqlite_insert_time_ > 0) ? stats.sqlite_rows_ / stats.sqlite_insert_time_ : 0.0,
+            stats.sqlite_index_time_);
+  }
+  if(stats.callgraph_nodes_) {
+    fprintf(stderr, "sca: call graph      : %llu functions, %llu calls (%llu unresolved), "
+            "%llu cycles, %llu KB in %.3f sec\n",
+            stats.callgraph_nodes_, stats.callgraph_edges_, stats.callgraph_unresolved_,
+            stats.callgraph_cycles_, stats.callgraph_bytes_ / 1024, stats.callgraph_time_);
+  }
+  if(stats.include_files_) {
+    fprintf(stderr, "sca: include graph   : %llu files, %llu includes, %llu headers, "
+            "%llu cycles, %llu KB in %.3f sec\n",
+            stats.include_files_, stats.include_edges_, stats.include_headers_,
+            stats.include_cycles_, stats.include_bytes_ / 1024, stats.include_time_);
+  }
+  if(stats.package_nodes_) {
+    fprintf(stderr, "sca: package graph   : %llu packages, %llu dependencies, %llu cycles, "
+            "%llu layers, %llu KB in %.3f sec\n",
+            stats.package_nodes_, stats.package_edges_, stats.package_cycles_,
+            stats.package_layers_, stats.package_bytes_ / 1024, stats.package_time_);
+  }
+  if(stats.cache_hits_ || stats.cache_misses_) {
+    fprintf(stderr, "sca: result cache    : %llu hits, %llu misses\n",
+            stats.cache_hits_, stats.cache_misses_);
   }
-  fprintf(SCA_GET_WRITE_PTR(), "            ]\n");
-  fprintf(SCA_GET_WRITE_PTR(), "}\n");
 }
@@ -16,8 +16,43 @@
 #ifndef SCA_ANALYZER_H
 #define SCA_ANALYZER_H
 
+#include <vector>
+
+namespace SCA {
+class Package;
+}
+
 void sca_analyzer(void);
 
+/// Write the JSON document of "pkgs" i.e {"pkg" : [...]}
+void sca_dump_json(const std::vector<SCA::Package*> &pkgs);
+
+/// Whether the package is dumped i.e it is under SCA_CLIENT_ROOT if set
+bool isPackageOfInterest(const char *pkg_name);
+
+void sca_dump_stats(void);
+
+/// Time the SourceId hash with "count" ids
+void sca_bench_hash(U count);
+
+/// Time the inheritance width/depth pass on "count" classes
+void sca_bench_inheritance(U count);
+
+/// Time the call graph on "count" calls
+void sca_bench_callgraph(U count);
+
+/// Time the include graph on "count" files
+void sca_bench_includes(U count);
+
+/// Time the package graph on "count" packages
+void sca_bench_packages(U count);
+
+/// Time the JSON reader on a result file
+void sca_bench_json(const char *file_name);
+
+/// Time the walk of the function bodies on code nested "depth" deep
+void sca_bench_walk(U depth);
+
 #endif    /* SCA_ANALYZER_H */
 
 
@@ -0,0 +1,174 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_archive.cc
+ *
+ *  \brief
+ *      Implementation of the archive reader
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 15:55:37 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sca_archive.hh"
+
+using namespace SCA;
+
+/// Start of every archive
+static const char kArMagic[8] = { '!', '<', 'a', 'r', 'c', 'h', '>', '\n' };
+/// Size of a member header and the offsets of its fields
+#define AR_HDR_SIZE   60
+#define AR_NAME_SIZE  16
+#define AR_SIZE_POS   48
+#define AR_SIZE_SIZE  10
+#define AR_FMAG_POS   58
+
+//==============================================================================
+///      \brief Decimal field of a header, padded with blanks
+//==============================================================================
+static bool parse_decimal(const char *field, size_t len, size_t &val) {
+  val = 0;
+  size_t i = 0;
+  for(; i < len && field[i] >= '0' && field[i] <= '9'; i++) {
+    val = val * 10 + (field[i] - '0');
+  }
+  if(i == 0) {
+    return false;
+  }
+  for(; i < len; i++) {
+    if(field[i] != ' ') {
+      return false;
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   ArchiveReader
+///      \method
+///      \brief   Constructor
+//==============================================================================
+ArchiveReader::ArchiveReader(void) {
+  base_            = NULL;
+  size_            = 0;
+  pos_             = 0;
+  long_names_      = NULL;
+  long_names_size_ = 0;
+}
+
+//==============================================================================
+///      \class   ArchiveReader
+///      \method
+///      \brief   Destructor
+//==============================================================================
+ArchiveReader::~ArchiveReader() {
+  if(base_) {
+    munmap(const_cast<char*>(base_), size_);
+  }
+}
+
+//==============================================================================
+///      \class   ArchiveReader
+///      \method  open
+///      \brief   Only the member headers are touched until a member is read
+//==============================================================================
+bool ArchiveReader::open(const std::string &file) {
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(kArMagic)) {
+    close(fd);
+    return false;
+  }
+  void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) {
+    return false;
+  }
+  base_ = static_cast<const char*>(addr);
+  size_ = st.st_size;
+  pos_  = sizeof(kArMagic);
+  return isArchiveHeader(base_, size_);
+}
+
+//==============================================================================
+///      \class   ArchiveReader
+///      \method  next
+///      \brief   Members start at an even offset. The special members are
+//                consumed on the way
+//==============================================================================
+bool ArchiveReader::next(ArchiveMember &member) {
+  while(pos_ + AR_HDR_SIZE <= size_) {
+    const char *hdr = base_ + pos_;
+    size_t size = 0;
+    if(hdr[AR_FMAG_POS] != '`' || hdr[AR_FMAG_POS + 1] != '\n' ||
+       !parse_decimal(hdr + AR_SIZE_POS, AR_SIZE_SIZE, size) ||
+       size > size_ - pos_ - AR_HDR_SIZE) {
+      return false;
+    }
+    const char *data = hdr + AR_HDR_SIZE;
+    pos_ += AR_HDR_SIZE + size + (size & 1);
+    // The name field, without the padding
+    size_t name_len = AR_NAME_SIZE;
+    while(name_len && hdr[name_len - 1] == ' ') {
+      name_len--;
+    }
+    std::string name(hdr, name_len);
+    if(name == "/" || name == "/SYM64/" || !name.compare(0, 9, "__.SYMDEF")) {
+      // Symbol table
+      continue;
+    }
+    if(name == "//") {
+      // GNU long name table, the names end with "/\n"
+      long_names_      = data;
+      long_names_size_ = size;
+      continue;
+    }
+    if(name.size() > 1 && name[0] == '/') {
+      // GNU long name i.e "/<offset in the table>"
+      size_t offset = 0;
+      if(!parse_decimal(name.c_str() + 1, name.size() - 1, offset) ||
+         offset >= long_names_size_) {
+        return false;
+      }
+      size_t end = offset;
+      while(end < long_names_size_ && long_names_[end] != '\n') {
+        end++;
+      }
+      name.assign(long_names_ + offset, end - offset);
+    } else if(!name.compare(0, 3, "#1/")) {
+      // BSD long name, it leads the data
+      size_t len = 0;
+      if(!parse_decimal(name.c_str() + 3, name.size() - 3, len) || len > size) {
+        return false;
+      }
+      name.assign(data, strnlen(data, len));
+      data += len;
+      size -= len;
+    }
+    if(name.size() && name[name.size() - 1] == '/') {
+      // GNU terminates the names with a '/'
+      name.erase(name.size() - 1);
+    }
+    member.name_ = name;
+    member.data_ = data;
+    member.size_ = size;
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================
+///      \brief Only the magic is looked at
+//==============================================================================
+bool isArchiveHeader(const char *data, size_t len) {
+  return (len >= sizeof(kArMagic) && !memcmp(data, kArMagic, sizeof(kArMagic)));
+}
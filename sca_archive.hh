@@ -0,0 +1,75 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_archive.hh
+ *
+ *  \brief
+ *      Reader of ar(1) archives
+ *
+ *  \details
+ *      A static library built with SCA as the compiler is an archive of
+ *      result files. The archive is mmap()ed and its members are handed out
+ *      in place, nothing is extracted. Both the GNU (long names in "//")
+ *      and the BSD ("#1/len" names) variants are understood. The symbol
+ *      tables ("/", "/SYM64/", "__.SYMDEF") are skipped.
+ *
+ *  \history
+ *      10/18/26 15:48:09 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_ARCHIVE_H
+#define SCA_ARCHIVE_H
+
+#include <string>
+#include "sca_int.hh"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  ArchiveMember
+///        \brief  A member of an archive, in the mapping of the archive
+// ============================================================================
+class ArchiveMember {
+  public:
+    std::string name_;
+    const char *data_;
+    size_t size_;
+};
+
+// ============================================================================
+///        \class  ArchiveReader
+///        \brief  Walks the members of an archive
+// ============================================================================
+class ArchiveReader {
+  public:
+    /// Ctor
+    ArchiveReader(void);
+    /// Dtor. Unmaps the archive
+    ~ArchiveReader();
+    /// Map the archive. Returns false if it is not an archive
+    bool open(const std::string &file);
+    /// The next member. Returns false at the end of the archive or on a
+    ///  malformed member
+    bool next(ArchiveMember &member);
+
+  private:
+    ArchiveReader(const ArchiveReader&);
+    ArchiveReader& operator=(const ArchiveReader&);
+    /// The mapping
+    const char *base_;
+    size_t size_;
+    /// Offset of the next member header
+    size_t pos_;
+    /// GNU long name table i.e the "//" member
+    const char *long_names_;
+    size_t long_names_size_;
+};
+
+} // END SCA namespace
+
+//--------------------------------------------------------------------------------------
+///      \brief Tells if the first "len" bytes of a file are the magic of an
+///             archive
+//--------------------------------------------------------------------------------------
+bool isArchiveHeader(const char *data, size_t len);
+
+#endif    /* SCA_ARCHIVE_H */
@@ -0,0 +1,665 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_binary.cc
+ *
+ *  \brief
+ *      Implementation of the binary columnar format
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 13:20:44 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sca_binary.hh"
+#include "sca_globals.hh"
+
+using namespace SCA;
+
+/// First bytes of the file
+static const char kBinMagic[8] = "\177SCABIN";
+/// Tells the byte order of the writer
+static const U kBinByteOrder = 0x01020304;
+
+// ============================================================================
+///        \class  BinColumnInfo
+///        \brief  Width of the values of a column and the table it belongs to.
+//                 All the columns of a table have as many values
+// ============================================================================
+struct BinColumnInfo {
+  U width_;
+  BinColumnId table_;
+};
+
+static const BinColumnInfo kColumnInfo[kBinNumColumns] = {
+  { sizeof(U),             kBinStrOffsets },
+  { sizeof(char),          kBinStrData },
+  { sizeof(U),             kBinPkgName },
+  { sizeof(U),             kBinPkgName },
+  { sizeof(U),             kBinPkgName },
+  { sizeof(U),             kBinPkgName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinFileName },
+  { sizeof(U),             kBinClassName },
+  { sizeof(U),             kBinClassName },
+  { sizeof(U),             kBinClassName },
+  { sizeof(int),           kBinClassName },
+  { sizeof(int),           kBinClassName },
+  { sizeof(unsigned char), kBinClassName },
+  { sizeof(U),             kBinClassName },
+  { sizeof(U),             kBinClassName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(ULL),           kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinFuncName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(unsigned char), kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(ULL),           kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(U),             kBinMethodName },
+  { sizeof(ULL),           kBinCalls },
+  { sizeof(U),             kBinIncludes }
+};
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method
+///      \brief   Constructor
+//==============================================================================
+BinaryWriter::BinaryWriter(void) {
+  num_files_    = 0;
+  num_funcs_    = 0;
+  num_classes_  = 0;
+  num_methods_  = 0;
+  num_calls_    = 0;
+  num_includes_ = 0;
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  add
+///      \brief   The files of the package are numbered one after the other,
+//                sources first
+//==============================================================================
+void BinaryWriter::add(Package *pkg) {
+  append<U>(kBinPkgName, string_id(pkg->name()));
+  append<U>(kBinPkgFirstFile, num_files_);
+  U num_files[2] = {0, 0};
+  Obj::ObjType types[2] = {Obj::kSourceFile, Obj::kHeaderFile};
+  const ObjList &childs = pkg->getChilds();
+  for(int k=0; k<2; k++) {
+    for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+      if((*it)->type() == types[k]) {
+        add_file(static_cast<File*>(*it));
+        num_files[k]++;
+      }
+    }
+  }
+  append<U>(kBinPkgNumSources, num_files[0]);
+  append<U>(kBinPkgNumHeaders, num_files[1]);
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  add_file
+///      \brief   A file row followed by the rows of its functions and classes
+//==============================================================================
+void BinaryWriter::add_file(File *file) {
+  num_files_++;
+  append<U>(kBinFileName, string_id(file->name()));
+  append<U>(kBinFileFirstFunc, num_funcs_);
+  append<U>(kBinFileFirstClass, num_classes_);
+  U num_funcs = 0;
+  U num_classes = 0;
+  const ObjList &childs = file->getChilds();
+  for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+    if((*it)->type() == Obj::kFunction) {
+      Function *func = static_cast<Function*>(*it);
+      append<U>(kBinFuncName, string_id(func->name()));
+      append<U>(kBinFuncIdFile, string_id(func->id().file_name()));
+      append<U>(kBinFuncIdLine, func->id().line_no());
+      append<U>(kBinFuncCyclomatic, func->cyclomatic());
+      append<U>(kBinFuncComplexity, func->complexity());
+      append<U>(kBinFuncMaxNesting, func->max_nesting());
+      append<U>(kBinFuncNumLines, func->num_lines());
+      append<U>(kBinFuncParamSize, func->param_size());
+      append<ULL>(kBinFuncUsr, func->usr());
+      append<U>(kBinFuncFirstCall, add_calls(func));
+      append<U>(kBinFuncNumCalls, func->num_callees());
+      append<U>(kBinFuncOperators, func->num_operators());
+      append<U>(kBinFuncOperands, func->num_operands());
+      append<U>(kBinFuncUniqueOperators, func->unique_operators());
+      append<U>(kBinFuncUniqueOperands, func->unique_operands());
+      num_funcs_++;
+      num_funcs++;
+    }
+  }
+  for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+    if((*it)->type() == Obj::kClass) {
+      add_class(static_cast<Class*>(*it));
+      num_classes++;
+    }
+  }
+  append<U>(kBinFileNumFuncs, num_funcs);
+  append<U>(kBinFileNumClasses, num_classes);
+  append<U>(kBinFileBytes, file->num_bytes());
+  append<U>(kBinFileLines, file->num_lines());
+  append<U>(kBinFileFirstInclude, add_includes(file));
+  append<U>(kBinFileNumIncludes, file->direct_includes().size());
+  append<U>(kBinFileExternalIncludes, file->external_includes());
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  add_class
+///      \brief   A class row along with the rows of its methods
+//==============================================================================
+void BinaryWriter::add_class(Class *cls) {
+  num_classes_++;
+  append<U>(kBinClassName, string_id(cls->name()));
+  append<U>(kBinClassIdFile, string_id(cls->id().file_name()));
+  append<U>(kBinClassIdLine, cls->id().line_no());
+  append<int>(kBinClassWidth, cls->width());
+  append<int>(kBinClassDepth, cls->depth());
+  unsigned char flags = 0;
+  flags |= cls->isAggregate()   ? kBinClassIsAggregate   : 0;
+  flags |= cls->isCLike()       ? kBinClassIsCLike       : 0;
+  flags |= cls->isEmpty()       ? kBinClassIsEmpty       : 0;
+  flags |= cls->isPolymorphic() ? kBinClassIsPolymorphic : 0;
+  flags |= cls->isAbstract()    ? kBinClassIsAbstract    : 0;
+  flags |= cls->isTrivial()     ? kBinClassIsTrivial     : 0;
+  flags |= cls->isLiteral()     ? kBinClassIsLiteral     : 0;
+  append<unsigned char>(kBinClassFlags, flags);
+  append<U>(kBinClassFirstMethod, num_methods_);
+  U num_methods = 0;
+  const ObjList &childs = cls->getChilds();
+  for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+    if((*it)->type() != Obj::kMethod) {
+      continue;
+    }
+    Method *method = static_cast<Method*>(*it);
+    append<U>(kBinMethodName, string_id(method->name()));
+    append<U>(kBinMethodIdFile, string_id(method->id().file_name()));
+    append<U>(kBinMethodIdLine, method->id().line_no());
+    flags = 0;
+    flags |= method->isConst()   ? kBinMethodIsConst   : 0;
+    flags |= method->isStatic()  ? kBinMethodIsStatic  : 0;
+    flags |= method->isVirtual() ? kBinMethodIsVirtual : 0;
+    append<unsigned char>(kBinMethodFlags, flags);
+    append<U>(kBinMethodCyclomatic, method->cyclomatic());
+    append<U>(kBinMethodComplexity, method->complexity());
+    append<U>(kBinMethodMaxNesting, method->max_nesting());
+    append<U>(kBinMethodNumLines, method->num_lines());
+    append<U>(kBinMethodParamSize, method->param_size());
+    append<ULL>(kBinMethodUsr, method->usr());
+    append<U>(kBinMethodFirstCall, add_calls(method));
+    append<U>(kBinMethodNumCalls, method->num_callees());
+    append<U>(kBinMethodOperators, method->num_operators());
+    append<U>(kBinMethodOperands, method->num_operands());
+    append<U>(kBinMethodUniqueOperators, method->unique_operators());
+    append<U>(kBinMethodUniqueOperands, method->unique_operands());
+    num_methods_++;
+    num_methods++;
+  }
+  append<U>(kBinClassNumMethods, num_methods);
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  add_calls
+///      \brief   The callees of all the functions and methods share a column
+//==============================================================================
+U BinaryWriter::add_calls(const Function *func) {
+  U first = num_calls_;
+  columns_[kBinCalls].append(reinterpret_cast<const char*>(func->callees()),
+                             func->num_callees() * sizeof(ULL));
+  num_calls_ += func->num_callees();
+  return first;
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  add_includes
+///      \brief   The full paths, as the included file may be in another
+//                package
+//==============================================================================
+U BinaryWriter::add_includes(File *file) {
+  U first = num_includes_;
+  const ArenaVector<FileId> &includes = file->direct_includes();
+  for(size_t i=0; i<includes.size(); i++) {
+    std::string path = SCA_FILE(includes[i])->get_full_name();
+    append<U>(kBinIncludes, strings_.intern(path));
+  }
+  num_includes_ += includes.size();
+  return first;
+}
+
+//==============================================================================
+///      \class   BinaryWriter
+///      \method  write
+///      \brief   The header, then every column at an 8 byte boundary
+//==============================================================================
+void BinaryWriter::write(Writer &w) {
+  for(U id=0; id<strings_.size(); id++) {
+    append<U>(kBinStrOffsets, columns_[kBinStrData].size());
+    columns_[kBinStrData].append(strings_.name(id), strings_.length(id) + 1);
+  }
+  append<U>(kBinStrOffsets, columns_[kBinStrData].size());
+  BinHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic_, kBinMagic, sizeof(header.magic_));
+  header.version_     = SCA_BINARY_VERSION;
+  header.byte_order_  = kBinByteOrder;
+  header.num_columns_ = kBinNumColumns;
+  ULL offset = sizeof(header);
+  for(int c=0; c<kBinNumColumns; c++) {
+    offset = (offset + 7) & ~7ULL;
+    header.columns_[c].offset_ = offset;
+    header.columns_[c].count_  = columns_[c].size() / kColumnInfo[c].width_;
+    offset += columns_[c].size();
+  }
+  w.put(reinterpret_cast<const char*>(&header), sizeof(header));
+  static const char padding[8] = {0};
+  offset = sizeof(header);
+  for(int c=0; c<kBinNumColumns; c++) {
+    w.put(padding, header.columns_[c].offset_ - offset);
+    w.put(columns_[c].data(), columns_[c].size());
+    offset = header.columns_[c].offset_ + columns_[c].size();
+  }
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method
+///      \brief   Constructor
+//==============================================================================
+BinaryReader::BinaryReader(void) {
+  base_        = NULL;
+  size_        = 0;
+  header_      = NULL;
+  str_offsets_ = NULL;
+  str_data_    = NULL;
+  num_strings_ = 0;
+  mapped_      = false;
+  copy_        = NULL;
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method
+///      \brief   Destructor
+//==============================================================================
+BinaryReader::~BinaryReader() {
+  if(mapped_) {
+    munmap(const_cast<char*>(base_), size_);
+  }
+  free(copy_);
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  open
+///      \brief   Map the file. It is only read, the pages come straight from
+//                the page cache
+//==============================================================================
+bool BinaryReader::open(const std::string &file) {
+  file_ = file;
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BinHeader)) {
+    close(fd);
+    return false;
+  }
+  void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) {
+    return false;
+  }
+  base_   = static_cast<const char*>(addr);
+  size_   = st.st_size;
+  mapped_ = true;
+  return attach();
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  open
+///      \brief   The columns are read in place. They must be 8 byte aligned
+//                like in a file of their own, else they are copied once
+//==============================================================================
+bool BinaryReader::open(const char *data, size_t size, const std::string &name) {
+  file_ = name;
+  if(size < sizeof(BinHeader)) {
+    return false;
+  }
+  if(reinterpret_cast<size_t>(data) % 8) {
+    copy_ = static_cast<char*>(malloc(size));
+    if(NULL == copy_) {
+      return false;
+    }
+    memcpy(copy_, data, size);
+    data = copy_;
+  }
+  base_ = data;
+  size_ = size;
+  return attach();
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  attach
+///      \brief   Check the data at base_
+//==============================================================================
+bool BinaryReader::attach(void) {
+  header_ = reinterpret_cast<const BinHeader*>(base_);
+  if(!validate()) {
+    fprintf(stderr, "sca: %s is not a valid SCA binary file of version %d\n",
+            file_.c_str(), SCA_BINARY_VERSION);
+    return false;
+  }
+  return true;
+}
+
+//==============================================================================
+///      \brief Whether every value of the U column is below "limit"
+//==============================================================================
+static bool all_below(const U *vals, ULL count, ULL limit) {
+  for(ULL i=0; i<count; i++) {
+    if(vals[i] >= limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \brief Whether every first/count pair is a range in [0, limit)
+//==============================================================================
+static bool all_in_range(const U *first, const U *num, ULL count, ULL limit) {
+  for(ULL i=0; i<count; i++) {
+    if((ULL)first[i] + num[i] > limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  validate
+///      \brief   Everything load() relies on, so that a truncated or a
+//                corrupt file can not make it read out of the mapping
+//==============================================================================
+bool BinaryReader::validate(void) {
+  if(memcmp(header_->magic_, kBinMagic, sizeof(kBinMagic)) ||
+     header_->version_ != SCA_BINARY_VERSION ||
+     header_->byte_order_ != kBinByteOrder ||
+     header_->num_columns_ != kBinNumColumns) {
+    return false;
+  }
+  for(int c=0; c<kBinNumColumns; c++) {
+    const BinColumn &col = header_->columns_[c];
+    if(col.offset_ % 8 || col.offset_ > size_ ||
+       col.count_ > (size_ - col.offset_) / kColumnInfo[c].width_) {
+      return false;
+    }
+    if(c > kBinStrData && col.count_ != count(kColumnInfo[c].table_)) {
+      return false;
+    }
+  }
+  // Every string ends before the end of the blob
+  ULL data_size = count(kBinStrData);
+  if(count(kBinStrOffsets) == 0 ||
+     (data_size && base_[header_->columns_[kBinStrData].offset_ + data_size - 1] != '\0')) {
+    return false;
+  }
+  str_offsets_ = column<U>(kBinStrOffsets);
+  str_data_    = column<char>(kBinStrData);
+  num_strings_ = count(kBinStrOffsets) - 1;
+  if(!all_below(str_offsets_, num_strings_, data_size)) {
+    return false;
+  }
+  static const BinColumnId string_columns[] = {
+    kBinPkgName, kBinFileName,
+    kBinClassName, kBinClassIdFile,
+    kBinFuncName, kBinFuncIdFile,
+    kBinMethodName, kBinMethodIdFile,
+    kBinIncludes
+  };
+  for(size_t i=0; i<sizeof(string_columns)/sizeof(string_columns[0]); i++) {
+    if(!all_below(column<U>(string_columns[i]), count(string_columns[i]), num_strings_)) {
+      return false;
+    }
+  }
+  // The rows a row refers to are in the file
+  ULL num_pkgs = count(kBinPkgName);
+  std::vector<U> pkg_num_files(num_pkgs);
+  for(ULL i=0; i<num_pkgs; i++) {
+    ULL num = (ULL)column<U>(kBinPkgNumSources)[i] + column<U>(kBinPkgNumHeaders)[i];
+    if(num > count(kBinFileName)) {
+      return false;
+    }
+    pkg_num_files[i] = (U)num;
+  }
+  ULL num_files = count(kBinFileName);
+  ULL num_classes = count(kBinClassName);
+  return (all_in_range(column<U>(kBinPkgFirstFile), num_pkgs ? &pkg_num_files[0] : NULL,
+                       num_pkgs, num_files) &&
+          all_in_range(column<U>(kBinFileFirstFunc), column<U>(kBinFileNumFuncs),
+                       num_files, count(kBinFuncName)) &&
+          all_in_range(column<U>(kBinFileFirstClass), column<U>(kBinFileNumClasses),
+                       num_files, num_classes) &&
+          all_in_range(column<U>(kBinFileFirstInclude), column<U>(kBinFileNumIncludes),
+                       num_files, count(kBinIncludes)) &&
+          all_in_range(column<U>(kBinClassFirstMethod), column<U>(kBinClassNumMethods),
+                       num_classes, count(kBinMethodName)) &&
+          all_in_range(column<U>(kBinFuncFirstCall), column<U>(kBinFuncNumCalls),
+                       count(kBinFuncName), count(kBinCalls)) &&
+          all_in_range(column<U>(kBinMethodFirstCall), column<U>(kBinMethodNumCalls),
+                       count(kBinMethodName), count(kBinCalls)));
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  source_id
+///      \brief   Every path of the file is looked up at most once
+//==============================================================================
+SourceId BinaryReader::source_id(U file, LineId line) {
+  if(file_ids_.empty()) {
+    file_ids_.resize(num_strings_, INVALID_FILE_ID);
+  }
+  if(file_ids_[file] == INVALID_FILE_ID) {
+    file_ids_[file] = FileIdMgr::getFileIdMgr()->insertFile(std::string(string(file)));
+  }
+  return SourceId(file_ids_[file], line);
+}
+
+//==============================================================================
+///      \class   BinaryReader
+///      \method  load
+///      \brief   Same as the JsonParser, an object that is already in the
+//                tree (i.e a header seen by many TUs) is updated
+//==============================================================================
+void BinaryReader::load(void) {
+  const U *pkg_name        = column<U>(kBinPkgName);
+  const U *pkg_first_file  = column<U>(kBinPkgFirstFile);
+  const U *pkg_num_sources = column<U>(kBinPkgNumSources);
+  const U *pkg_num_headers = column<U>(kBinPkgNumHeaders);
+  const U *file_name        = column<U>(kBinFileName);
+  const U *file_first_func  = column<U>(kBinFileFirstFunc);
+  const U *file_num_funcs   = column<U>(kBinFileNumFuncs);
+  const U *file_first_class = column<U>(kBinFileFirstClass);
+  const U *file_num_classes = column<U>(kBinFileNumClasses);
+  const U *file_bytes         = column<U>(kBinFileBytes);
+  const U *file_lines         = column<U>(kBinFileLines);
+  const U *file_first_include = column<U>(kBinFileFirstInclude);
+  const U *file_num_includes  = column<U>(kBinFileNumIncludes);
+  const U *file_external_includes = column<U>(kBinFileExternalIncludes);
+  const U *class_name         = column<U>(kBinClassName);
+  const U *class_id_file      = column<U>(kBinClassIdFile);
+  const U *class_id_line      = column<U>(kBinClassIdLine);
+  const int *class_width      = column<int>(kBinClassWidth);
+  const int *class_depth      = column<int>(kBinClassDepth);
+  const unsigned char *class_flags = column<unsigned char>(kBinClassFlags);
+  const U *class_first_method = column<U>(kBinClassFirstMethod);
+  const U *class_num_methods  = column<U>(kBinClassNumMethods);
+  const U *func_name        = column<U>(kBinFuncName);
+  const U *func_id_file     = column<U>(kBinFuncIdFile);
+  const U *func_id_line     = column<U>(kBinFuncIdLine);
+  const U *func_cyclomatic  = column<U>(kBinFuncCyclomatic);
+  const U *func_complexity  = column<U>(kBinFuncComplexity);
+  const U *func_max_nesting = column<U>(kBinFuncMaxNesting);
+  const U *func_num_lines   = column<U>(kBinFuncNumLines);
+  const U *func_param_size  = column<U>(kBinFuncParamSize);
+  const ULL *func_usr       = column<ULL>(kBinFuncUsr);
+  const U *func_first_call  = column<U>(kBinFuncFirstCall);
+  const U *func_num_calls   = column<U>(kBinFuncNumCalls);
+  const U *func_operators   = column<U>(kBinFuncOperators);
+  const U *func_operands    = column<U>(kBinFuncOperands);
+  const U *func_unique_operators = column<U>(kBinFuncUniqueOperators);
+  const U *func_unique_operands  = column<U>(kBinFuncUniqueOperands);
+  const U *method_name        = column<U>(kBinMethodName);
+  const U *method_id_file     = column<U>(kBinMethodIdFile);
+  const U *method_id_line     = column<U>(kBinMethodIdLine);
+  const unsigned char *method_flags = column<unsigned char>(kBinMethodFlags);
+  const U *method_cyclomatic  = column<U>(kBinMethodCyclomatic);
+  const U *method_complexity  = column<U>(kBinMethodComplexity);
+  const U *method_max_nesting = column<U>(kBinMethodMaxNesting);
+  const U *method_num_lines   = column<U>(kBinMethodNumLines);
+  const U *method_param_size  = column<U>(kBinMethodParamSize);
+  const ULL *method_usr       = column<ULL>(kBinMethodUsr);
+  const U *method_first_call  = column<U>(kBinMethodFirstCall);
+  const U *method_num_calls   = column<U>(kBinMethodNumCalls);
+  const U *method_operators   = column<U>(kBinMethodOperators);
+  const U *method_operands    = column<U>(kBinMethodOperands);
+  const U *method_unique_operators = column<U>(kBinMethodUniqueOperators);
+  const U *method_unique_operands  = column<U>(kBinMethodUniqueOperands);
+  const ULL *calls            = column<ULL>(kBinCalls);
+  const U *includes           = column<U>(kBinIncludes);
+  SCA_globals *globals = SCA_globals::getGlobals();
+  for(ULL p=0; p<count(kBinPkgName); p++) {
+    std::string pkg_path = string(pkg_name[p]);
+    PkgIdMgr::getPkgIdMgr()->insertPkg(pkg_path);
+    U last_file = pkg_first_file[p] + pkg_num_sources[p] + pkg_num_headers[p];
+    for(U f=pkg_first_file[p]; f<last_file; f++) {
+      FileId file_id = FileIdMgr::getFileIdMgr()->insertFile(pkg_path + "/" + string(file_name[f]));
+      File *file = SCA_FILE(file_id);
+      file->set_size(file_bytes[f], file_lines[f]);
+      file->set_external_includes(file_external_includes[f]);
+      for(U i=file_first_include[f]; i<file_first_include[f] + file_num_includes[f]; i++) {
+        FileId included = FileIdMgr::getFileIdMgr()->insertFile(string(includes[i]));
+        if(included != INVALID_FILE_ID && included != file_id) {
+          file->insert_direct_include(included);
+        }
+      }
+      for(U i=file_first_func[f]; i<file_first_func[f] + file_num_funcs[f]; i++) {
+        FuncId id = source_id(func_id_file[i], func_id_line[i]);
+        Function *found = globals->function_hash()[id];
+        // A method on the same line is a different object
+        Function *func = (found && found->type() == Obj::kFunction) ? found : NULL;
+        if(NULL == func) {
+          func = new Function(file, string(func_name[i]), id);
+          if(NULL == found) {
+            globals->function_hash().insert(id, func);
+          }
+        }
+        func->set_cyclomatic(func_cyclomatic[i]);
+        func->set_complexity(func_complexity[i]);
+        func->set_max_nesting(func_max_nesting[i]);
+        func->set_num_lines(func_num_lines[i]);
+        func->set_param_size(func_param_size[i]);
+        func->set_usr(func_usr[i]);
+        func->set_callees(calls + func_first_call[i], func_num_calls[i], globals->obj_arena());
+        func->set_operators(func_operators[i], func_unique_operators[i]);
+        func->set_operands(func_operands[i], func_unique_operands[i]);
+      }
+      for(U c=file_first_class[f]; c<file_first_class[f] + file_num_classes[f]; c++) {
+        ClassId cid = source_id(class_id_file[c], class_id_line[c]);
+        Class *cls = globals->class_hash()[cid];
+        if(NULL == cls) {
+          cls = new Class(file, string(class_name[c]), cid);
+          globals->class_hash().insert(cid, cls);
+        }
+        cls->set_width(class_width[c]);
+        cls->set_depth(class_depth[c]);
+        cls->set_isAggregate((class_flags[c] & kBinClassIsAggregate) != 0);
+        cls->set_isCLike((class_flags[c] & kBinClassIsCLike) != 0);
+        cls->set_isEmpty((class_flags[c] & kBinClassIsEmpty) != 0);
+        cls->set_isPolymorphic((class_flags[c] & kBinClassIsPolymorphic) != 0);
+        cls->set_isAbstract((class_flags[c] & kBinClassIsAbstract) != 0);
+        cls->set_isTrivial((class_flags[c] & kBinClassIsTrivial) != 0);
+        cls->set_isLiteral((class_flags[c] & kBinClassIsLiteral) != 0);
+        for(U m=class_first_method[c]; m<class_first_method[c] + class_num_methods[c]; m++) {
+          FuncId mid = source_id(method_id_file[m], method_id_line[m]);
+          Function *found = globals->function_hash()[mid];
+          // A free function on the same line is not a method
+          Method *method = (found && found->type() == Obj::kMethod) ?
+                           static_cast<Method*>(found) : NULL;
+          if(NULL == method) {
+            method = new Method(cls, string(method_name[m]), mid);
+            if(NULL == found) {
+              globals->function_hash().insert(mid, method);
+            }
+          }
+          method->set_isConst((method_flags[m] & kBinMethodIsConst) != 0);
+          method->set_isStatic((method_flags[m] & kBinMethodIsStatic) != 0);
+          method->set_isVirtual((method_flags[m] & kBinMethodIsVirtual) != 0);
+          method->set_cyclomatic(method_cyclomatic[m]);
+          method->set_complexity(method_complexity[m]);
+          method->set_max_nesting(method_max_nesting[m]);
+          method->set_num_lines(method_num_lines[m]);
+          method->set_param_size(method_param_size[m]);
+          method->set_usr(method_usr[m]);
+          method->set_callees(calls + method_first_call[m], method_num_calls[m],
+                              globals->obj_arena());
+          method->set_operators(method_operators[m], method_unique_operators[m]);
+          method->set_operands(method_operands[m], method_unique_operands[m]);
+        }
+      }
+    }
+  }
+}
+
+//==============================================================================
+///      \brief Only the magic is looked at
+//==============================================================================
+bool isBinaryHeader(const char *data, size_t len) {
+  return (len >= sizeof(kBinMagic) && !memcmp(data, kBinMagic, sizeof(kBinMagic)));
+}
@@ -0,0 +1,251 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_binary.hh
+ *
+ *  \brief
+ *      Binary columnar format of the analysis results
+ *
+ *  \details
+ *      An alternative to the JSON output for the files SCA reads back
+ *      itself, i.e the per TU outputs merged at the link step. The file is
+ *      mmap()ed and used in place, nothing is parsed.
+ *
+ *      Header   : Magic, version, byte order and the offset and count of
+ *                 every column
+ *      Strings  : Offsets in to a blob of NUL terminated names and paths.
+ *                 Every other column refers to a string by its index
+ *      Columns  : One fixed width array per field of the packages, files,
+ *                 classes, functions and methods. Packages index their files
+ *                 (sources first, then headers), files their functions and
+ *                 classes and classes their methods with a first/count pair.
+ *                 Functions and methods index the USR hashes of their callees
+ *                 the same way, and files the
+ *                 full paths of the files they include
+ *
+ *      All the columns start at an 8 byte boundary. The values are in the
+ *      byte order of the writer, a reader of the other order rejects the
+ *      file.
+ *
+ *  \history
+ *      10/18/26 13:02:17 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_BINARY_H
+#define SCA_BINARY_H
+
+#include "sca_int.hh"
+#include "sca_utils.hh"
+#include "sca_writer.hh"
+
+/// Bump when a column is added or changes its meaning
+#define SCA_BINARY_VERSION 6
+
+namespace SCA {
+
+/// Every column of the format. The order is the order in the file
+enum BinColumnId {
+  kBinStrOffsets,       // U[num strings + 1]
+  kBinStrData,          // char
+  kBinPkgName,          // U, string
+  kBinPkgFirstFile,     // U
+  kBinPkgNumSources,    // U
+  kBinPkgNumHeaders,    // U
+  kBinFileName,         // U, string
+  kBinFileFirstFunc,    // U
+  kBinFileNumFuncs,     // U
+  kBinFileFirstClass,   // U
+  kBinFileNumClasses,   // U
+  kBinFileBytes,        // U
+  kBinFileLines,        // U
+  kBinFileFirstInclude, // U
+  kBinFileNumIncludes,  // U
+  kBinFileExternalIncludes, // U
+  kBinClassName,        // U, string
+  kBinClassIdFile,      // U, string, full path
+  kBinClassIdLine,      // U
+  kBinClassWidth,       // int
+  kBinClassDepth,       // int
+  kBinClassFlags,       // unsigned char, kBinClassIs*
+  kBinClassFirstMethod, // U
+  kBinClassNumMethods,  // U
+  kBinFuncName,         // U, string
+  kBinFuncIdFile,       // U, string, full path
+  kBinFuncIdLine,       // U
+  kBinFuncCyclomatic,   // U
+  kBinFuncComplexity,   // U
+  kBinFuncMaxNesting,   // U
+  kBinFuncNumLines,     // U
+  kBinFuncParamSize,    // U
+  kBinFuncUsr,          // ULL
+  kBinFuncFirstCall,    // U
+  kBinFuncNumCalls,     // U
+  kBinFuncOperators,    // U, Halstead N1
+  kBinFuncOperands,     // U, Halstead N2
+  kBinFuncUniqueOperators, // U, Halstead n1
+  kBinFuncUniqueOperands,  // U, Halstead n2
+  kBinMethodName,       // U, string
+  kBinMethodIdFile,     // U, string, full path
+  kBinMethodIdLine,     // U
+  kBinMethodFlags,      // unsigned char, kBinMethodIs*
+  kBinMethodCyclomatic, // U
+  kBinMethodComplexity, // U
+  kBinMethodMaxNesting, // U
+  kBinMethodNumLines,   // U
+  kBinMethodParamSize,  // U
+  kBinMethodUsr,        // ULL
+  kBinMethodFirstCall,  // U
+  kBinMethodNumCalls,   // U
+  kBinMethodOperators,  // U
+  kBinMethodOperands,   // U
+  kBinMethodUniqueOperators, // U
+  kBinMethodUniqueOperands,  // U
+  kBinCalls,            // ULL, USR hash of a callee
+  kBinIncludes,         // U, string, full path of an included file
+  kBinNumColumns
+};
+
+/// Bits of kBinClassFlags
+enum {
+  kBinClassIsAggregate   = 1 << 0,
+  kBinClassIsCLike       = 1 << 1,
+  kBinClassIsEmpty       = 1 << 2,
+  kBinClassIsPolymorphic = 1 << 3,
+  kBinClassIsAbstract    = 1 << 4,
+  kBinClassIsTrivial     = 1 << 5,
+  kBinClassIsLiteral     = 1 << 6
+};
+
+/// Bits of kBinMethodFlags
+enum {
+  kBinMethodIsConst   = 1 << 0,
+  kBinMethodIsStatic  = 1 << 1,
+  kBinMethodIsVirtual = 1 << 2
+};
+
+// ============================================================================
+///        \class  BinColumn
+///        \brief  Where a column is in the file
+// ============================================================================
+struct BinColumn {
+  /// Offset from the start of the file
+  ULL offset_;
+  /// Number of values
+  ULL count_;
+};
+
+// ============================================================================
+///        \class  BinHeader
+///        \brief  Start of the file
+// ============================================================================
+struct BinHeader {
+  char magic_[8];
+  U version_;
+  /// kBinByteOrder as written by the writer
+  U byte_order_;
+  U num_columns_;
+  U reserved_;
+  BinColumn columns_[kBinNumColumns];
+};
+
+// ============================================================================
+///        \class  BinaryWriter
+///        \brief  Lays out the packages as columns and writes them
+// ============================================================================
+class BinaryWriter {
+  public:
+    /// Ctor
+    BinaryWriter(void);
+    /// Add a package along with all its files
+    void add(Package *pkg);
+    /// Write the file
+    void write(Writer &w);
+
+  private:
+    /// Append a value to a column
+    template<class T> void append(BinColumnId id, T val) {
+      columns_[id].append(reinterpret_cast<const char*>(&val), sizeof(val));
+    }
+    /// Index of the string, added if needed
+    U string_id(const char *str) {
+      return strings_.intern(str, strlen(str));
+    }
+    void add_file(File *file);
+    void add_class(Class *cls);
+    /// The callees of the function, returns the first
+    U add_calls(const Function *func);
+    /// The direct includes of the file, returns the first
+    U add_includes(File *file);
+    /// The bytes of every column
+    std::string columns_[kBinNumColumns];
+    /// All the names and paths
+    StringTable strings_;
+    /// Number of rows so far
+    U num_files_;
+    U num_funcs_;
+    U num_classes_;
+    U num_methods_;
+    U num_calls_;
+    U num_includes_;
+};
+
+// ============================================================================
+///        \class  BinaryReader
+///        \brief  Maps a file of the binary format and merges it in the tree
+// ============================================================================
+class BinaryReader {
+  public:
+    /// Ctor
+    BinaryReader(void);
+    /// Dtor. Unmaps the file
+    ~BinaryReader();
+    /// Map the file and check its header and columns
+    bool open(const std::string &file);
+    /// Same as above for a file that is in memory already (i.e a member of
+    ///  an archive). "data" must outlive the reader
+    bool open(const char *data, size_t size, const std::string &name);
+    /// Add the content of the file to the tree
+    void load(void);
+
+  private:
+    /// Start of a column
+    template<class T> const T* column(BinColumnId id) const {
+      return reinterpret_cast<const T*>(base_ + header_->columns_[id].offset_);
+    }
+    /// Number of values of a column
+    ULL count(BinColumnId id) const {
+      return header_->columns_[id].count_;
+    }
+    /// A string of the file
+    const char* string(U id) const {
+      return str_data_ + str_offsets_[id];
+    }
+    /// The SourceId for an id file and line of the file
+    SourceId source_id(U file, LineId line);
+    /// Check the header and the columns of the data at base_
+    bool attach(void);
+    /// Checks the bounds of every column and string reference
+    bool validate(void);
+    /// The data, mapped by open() or the copy of unaligned data
+    const char *base_;
+    size_t size_;
+    bool mapped_;
+    char *copy_;
+    const BinHeader *header_;
+    const U *str_offsets_;
+    const char *str_data_;
+    U num_strings_;
+    /// FileId of the strings used as id files
+    std::vector<FileId> file_ids_;
+    /// Name of the file, for the errors
+    std::string file_;
+};
+
+} // END SCA namespace
+
+//--------------------------------------------------------------------------------------
+///      \brief Tells if the first "len" bytes of a file are the magic of the
+///             binary format
+//--------------------------------------------------------------------------------------
+bool isBinaryHeader(const char *data, size_t len);
+
+#endif    /* SCA_BINARY_H */
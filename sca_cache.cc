@@ -0,0 +1,351 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_cache.cc
+ *
+ *  \brief
+ *      Implementation of the per translation unit result cache
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 11:19:02 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <sys/stat.h>
+#include <algorithm>
+#include "sca_cache.hh"
+#include "sca_analyzer.hh"
+#include "sca_globals.hh"
+#include "sca_json_reader.hh"
+#include "sca_utils.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \class   ResultCache
+///      \method
+///      \brief   Constructor
+//==============================================================================
+ResultCache::ResultCache(const std::string &dir) : dir_(dir) {
+  tmp_count_ = 0;
+  mkdir(dir_.c_str(), 0777);
+  pthread_mutex_init(&lock_, NULL);
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method
+///      \brief   Destructor
+//==============================================================================
+ResultCache::~ResultCache() {
+  pthread_mutex_destroy(&lock_);
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  path
+///      \brief   Path of the cache file for the key
+//==============================================================================
+std::string ResultCache::path(ULL key, const char *ext) {
+  char name[64];
+  snprintf(name, sizeof(name), "/%016llx%s", key, ext);
+  return dir_ + name;
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  file_hash
+///      \brief   Content hash of the file. Every file is read once per run
+//==============================================================================
+bool ResultCache::file_hash(const std::string &file, ULL &hash) {
+  pthread_mutex_lock(&lock_);
+  std::map<std::string, ULL>::iterator it = hashes_.find(file);
+  bool found = (it != hashes_.end());
+  if(found) {
+    hash = it->second;
+  }
+  pthread_mutex_unlock(&lock_);
+  if(found) {
+    return true;
+  }
+  FILE *fp = fopen(file.c_str(), "rb");
+  if(NULL == fp) {
+    return false;
+  }
+  char buf[65536];
+  size_t len;
+  hash = SCA_HASH_SEED;
+  while((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    hash = hash_bytes(buf, len, hash);
+  }
+  fclose(fp);
+  pthread_mutex_lock(&lock_);
+  hashes_[file] = hash;
+  pthread_mutex_unlock(&lock_);
+  return true;
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  write_file
+///      \brief   Write "data" to "file". rename() is atomic, so concurrent
+//                processes never see a partial file
+//==============================================================================
+bool ResultCache::write_file(const std::string &file, const std::string &data) {
+  pthread_mutex_lock(&lock_);
+  U tmp_id = tmp_count_++;
+  pthread_mutex_unlock(&lock_);
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".tmp.%d.%u", (int)getpid(), tmp_id);
+  std::string tmp_file = file + suffix;
+  FILE *fp = fopen(tmp_file.c_str(), "w");
+  if(NULL == fp) {
+    return false;
+  }
+  bool ok = (fwrite(data.c_str(), 1, data.size(), fp) == data.size());
+  ok = (0 == fclose(fp)) && ok;
+  ok = ok && (0 == rename(tmp_file.c_str(), file.c_str()));
+  if(!ok) {
+    unlink(tmp_file.c_str());
+  }
+  return ok;
+}
+
+//==============================================================================
+///      \brief Split a "path:line" id
+//==============================================================================
+static SourceId parse_source_id(const std::string &str) {
+  size_t pos = str.find_last_of(':');
+  std::string path = str.substr(0, pos);
+  LineId line_id = (pos == std::string::npos) ? INVALID_LINE_ID :
+                                                atoi(str.c_str() + pos + 1);
+  return SourceId(FileIdMgr::getFileIdMgr()->insertFile(path), line_id);
+}
+
+//==============================================================================
+///      \brief Format a SourceId as "path:line"
+//==============================================================================
+static std::string format_source_id(const SourceId &id) {
+  char line[32];
+  snprintf(line, sizeof(line), ":%u", id.line_no());
+  return std::string(id.file_name()) + line;
+}
+
+//==============================================================================
+///      \brief Split a manifest line on tabs
+//==============================================================================
+static void split_fields(const std::string &line, std::vector<std::string> &fields) {
+  size_t start = 0;
+  size_t end;
+  while((end = line.find('\t', start)) != std::string::npos) {
+    fields.push_back(line.substr(start, end - start));
+    start = end + 1;
+  }
+  fields.push_back(line.substr(start));
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  lookup
+///      \brief   Read the entry of the job if the source, the flags and all
+//                the included files are the same as when it was stored
+//==============================================================================
+bool ResultCache::lookup(const TUJob &job, ULL &key, CacheHit &hit) {
+  ULL source_hash;
+  key = 0;
+  if(!file_hash(job.source_, source_hash)) {
+    return false;
+  }
+  key = hash_bytes(SCA_CACHE_VERSION, sizeof(SCA_CACHE_VERSION));
+  key = hash_bytes(job.source_.c_str(), job.source_.size() + 1, key);
+  key = hash_bytes(&source_hash, sizeof(source_hash), key);
+  for(size_t i=0; i<job.args_.size(); i++) {
+    key = hash_bytes(job.args_[i].c_str(), job.args_[i].size() + 1, key);
+  }
+  std::ifstream in(path(key, ".man").c_str());
+  std::string line;
+  if(!std::getline(in, line) || line != SCA_CACHE_VERSION) {
+    return false;
+  }
+  std::string json;
+  while(std::getline(in, line)) {
+    std::vector<std::string> fields;
+    split_fields(line, fields);
+    if(fields[0] == "json" && fields.size() == 2) {
+      json = dir_ + "/" + fields[1];
+    } else if(fields[0] == "dep" && fields.size() == 3) {
+      ULL hash;
+      if(!file_hash(fields[2], hash) ||
+         hash != strtoull(fields[1].c_str(), NULL, 16)) {
+        // An included file changed
+        return false;
+      }
+      hit.deps_.push_back(fields[2]);
+    } else if(fields[0] == "inherit" && fields.size() == 3) {
+      hit.edges_.push_back(std::make_pair(fields[1], fields[2]));
+    } else {
+      return false;
+    }
+  }
+  if(json.empty()) {
+    return false;
+  }
+  JsonParser parser;
+  if(JsonParser::kSuccess != parser.record(json, hit.partial_)) {
+    return false;
+  }
+  parser.stage(hit.partial_, hit.stage_);
+  return true;
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  load
+///      \brief   The subtree goes in first, the edges are between its
+//                classes
+//==============================================================================
+void ResultCache::load(const CacheHit &hit) {
+  SCA_globals::getGlobals()->lock();
+  hit.stage_.splice();
+  // The JSON does not carry the inheritance
+  for(size_t i=0; i<hit.edges_.size(); i++) {
+    SCA::Class *base = SCA_globals::getGlobals()->class_hash()[parse_source_id(hit.edges_[i].first)];
+    SCA::Class *derived = SCA_globals::getGlobals()->class_hash()[parse_source_id(hit.edges_[i].second)];
+    if(NULL == base || NULL == derived) {
+      continue;
+    }
+    ClassList &inherited_to = base->inherited_to();
+    if(std::find(inherited_to.begin(), inherited_to.end(), derived) == inherited_to.end()) {
+      base->addInheritedTo(derived);
+    }
+  }
+  // Later TUs need not walk these files
+  for(size_t i=0; i<hit.deps_.size(); i++) {
+    FileId id = FileIdMgr::getFileIdMgr()->getFileId(hit.deps_[i]);
+    if(id != INVALID_FILE_ID) {
+      SCA_globals::getGlobals()->markFileAnalyzed(id);
+    }
+  }
+  SCA_globals::getGlobals()->stats().cache_hits_++;
+  SCA_globals::getGlobals()->unlock();
+}
+
+//==============================================================================
+///      \brief Inclusion visitor. Collects every file of interest of the TU
+//==============================================================================
+static void collect_file(CXFile file,
+                         CXSourceLocation *stack,
+                         unsigned stack_len,
+                         CXClientData client_data) {
+  std::vector<std::string> *files = static_cast<std::vector<std::string>*>(client_data);
+  std::string path = SCA_globals::getGlobals()->realPath(file);
+  if(isFileOfInterest(path) &&
+     getType(path) != SCA::File::kObject &&
+     getType(path) != SCA::File::kArchive) {
+    files->push_back(path);
+  }
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  prepare
+///      \brief   Collect the files of the TU and hash them. Reading the files
+//                is done before the caller takes the SCA_globals lock
+//==============================================================================
+void ResultCache::prepare(ULL key, CXTranslationUnit TU, CacheEntry &entry) {
+  entry.key_ = 0;
+  if(key == 0) {
+    return;
+  }
+  clang_getInclusions(TU, collect_file, &entry.deps_);
+  entry.deps_hash_ = SCA_HASH_SEED;
+  for(size_t i=0; i<entry.deps_.size(); i++) {
+    ULL hash;
+    if(!file_hash(entry.deps_[i], hash)) {
+      return;
+    }
+    entry.dep_hashes_.push_back(hash);
+    entry.deps_hash_ = hash_bytes(&hash, sizeof(hash), entry.deps_hash_);
+  }
+  entry.key_ = key;
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  render
+///      \brief   Render the JSON and the manifest of the files of the TU
+//==============================================================================
+void ResultCache::render(CacheEntry &entry) {
+  SCA_globals::getGlobals()->stats().cache_misses_++;
+  if(entry.key_ == 0) {
+    return;
+  }
+  std::string &manifest = entry.manifest_;
+  manifest = SCA_CACHE_VERSION "\n";
+  // The files of the TU. a/util.h and b/util.h are two files
+  std::set<FileId> ids;
+  std::set<PkgId> pkg_ids;
+  for(size_t i=0; i<entry.deps_.size(); i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%016llx", entry.dep_hashes_[i]);
+    manifest += std::string("dep\t") + buf + "\t" + entry.deps_[i] + "\n";
+    FileId id = FileIdMgr::getFileIdMgr()->getFileId(entry.deps_[i]);
+    if(id != INVALID_FILE_ID && ids.insert(id).second) {
+      pkg_ids.insert(SCA_FILE(id)->pkgId());
+    }
+  }
+  // The entry is the output of the same dump routines, restricted to the
+  // files of the TU. Methods defined out of the TU come from the entries
+  // of their own TUs
+  std::vector<SCA::Package*> pkgs;
+  for(std::set<PkgId>::iterator it=pkg_ids.begin(); it!=pkg_ids.end(); it++) {
+    pkgs.push_back(SCA_PKG(*it));
+  }
+  SCA::Writer &w = SCA_GET_WRITER();
+  FILE *out = w.file();
+  SCA_globals::getGlobals()->set_dump_filter(&ids);
+  w.set_string(&entry.json_);
+  sca_dump_json(pkgs);
+  w.set_file(out);
+  SCA_globals::getGlobals()->set_dump_filter(NULL);
+  // Inheritance of the classes of the TU. The base is always visible to
+  // the TU, so only the derived class needs to be in the TU
+  for(std::set<FileId>::iterator f=ids.begin(); f!=ids.end(); f++) {
+    const ObjList &childs = SCA_FILE(*f)->getChilds();
+    for(ObjList::const_iterator c=childs.begin(); c!=childs.end(); c++) {
+      if((*c)->type() != Obj::kClass) {
+        continue;
+      }
+      SCA::Class *base = static_cast<SCA::Class*>(*c);
+      ClassList &inherited_to = base->inherited_to();
+      for(ClassList::iterator d=inherited_to.begin(); d!=inherited_to.end(); d++) {
+        if(ids.count(static_cast<SCA::File*>((*d)->parent())->id())) {
+          manifest += "inherit\t" + format_source_id(base->id()) + "\t" +
+                      format_source_id((*d)->id()) + "\n";
+        }
+      }
+    }
+  }
+}
+
+//==============================================================================
+///      \class   ResultCache
+///      \method  store
+///      \brief   Write the entry. The JSON is written first, the manifest
+//                that points to it commits the entry
+//==============================================================================
+void ResultCache::store(const CacheEntry &entry) {
+  if(entry.key_ == 0) {
+    return;
+  }
+  // The JSON name carries the hash of the included files. An existing one
+  // is never rewritten with different content
+  char json_name[64];
+  snprintf(json_name, sizeof(json_name), "%016llx-%016llx.json",
+           entry.key_, entry.deps_hash_);
+  std::string manifest = entry.manifest_ + "json\t" + json_name + "\n";
+  if(write_file(dir_ + "/" + json_name, entry.json_)) {
+    write_file(path(entry.key_, ".man"), manifest);
+  }
+}
@@ -0,0 +1,121 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_cache.hh
+ *
+ *  \brief
+ *      On-disk cache of the analysis result of every translation unit
+ *
+ *  \details
+ *      An entry is keyed by the content of the source and its compile flags.
+ *      Its manifest lists the content hash of every file the TU included,
+ *      so a change in any header misses the entry. The entry itself is the
+ *      part of the SCA tree the TU contributes (files, functions, classes,
+ *      methods), written by the dump routines of the JSON output and loaded
+ *      with the JsonParser on a hit. libclang is not involved at all on a
+ *      hit.
+ *
+ *      <key>.man              : Manifest. Written last, it commits the entry
+ *      <key>-<deps hash>.json : The subtree
+ *
+ *      All files are written to a temporary and rename()d in to place, so
+ *      the directory can be shared by concurrent sca processes.
+ *
+ *  \history
+ *      10/18/26 11:05:48 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_CACHE_H
+#define SCA_CACHE_H
+
+#include <pthread.h>
+#include <clang-c/Index.h>
+#include "sca_int.hh"
+#include "sca_driver.hh"
+#include "sca_json_reader.hh"
+
+/// Bump when the content of the entries changes i.e a new field is dumped
+#define SCA_CACHE_VERSION "sca-cache 4"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  CacheEntry
+///        \brief  An entry being stored. Only render() needs the tree
+// ============================================================================
+class CacheEntry {
+  public:
+    CacheEntry(void) : key_(0), deps_hash_(0) {}
+    /// Key of the entry, 0 if it is not stored
+    ULL key_;
+    /// Files included by the TU and their content hash
+    std::vector<std::string> deps_;
+    std::vector<ULL> dep_hashes_;
+    ULL deps_hash_;
+    /// The subtree and the manifest
+    std::string json_;
+    std::string manifest_;
+};
+
+// ============================================================================
+///        \class  CacheHit
+///        \brief  An entry found up to date. It is read and staged off the
+///                tree, load() only splices it
+// ============================================================================
+class CacheHit {
+  public:
+    CacheHit(void) {}
+    /// The subtree
+    JsonPartial partial_;
+    JsonStage stage_;
+    /// Files included by the TU, and the inheritance the JSON does not carry
+    std::vector<std::string> deps_;
+    std::vector<std::pair<std::string, std::string> > edges_;
+  private:
+    CacheHit(const CacheHit&);
+    CacheHit& operator=(const CacheHit&);
+};
+
+// ============================================================================
+///        \class  ResultCache
+///        \brief  Stores and loads the SCA subtree of a translation unit
+// ============================================================================
+class ResultCache {
+  public:
+    /// Ctor. "dir" is the cache directory
+    ResultCache(const std::string &dir);
+    /// Dtor
+    ~ResultCache();
+    /// Read the entry of the job in to "hit" if it is up to date. "key" is
+    ///  set for store() either way. Needs no lock
+    bool lookup(const TUJob &job, ULL &key, CacheHit &hit);
+    /// Add an entry found by lookup() to the tree. Takes the SCA_globals
+    ///  lock
+    void load(const CacheHit &hit);
+    /// Collect and hash the files included by the TU. Needs no lock
+    void prepare(ULL key, CXTranslationUnit TU, CacheEntry &entry);
+    /// Render what the TU contributed to the tree. The caller must hold
+    ///  the SCA_globals lock
+    void render(CacheEntry &entry);
+    /// Write the entry out. Needs no lock
+    void store(const CacheEntry &entry);
+
+  private:
+    /// Content hash of the file, computed once per run
+    bool file_hash(const std::string &file, ULL &hash);
+    /// Path of the file for the key
+    std::string path(ULL key, const char *ext);
+    /// Write "data" to "file" through a temporary
+    bool write_file(const std::string &file, const std::string &data);
+    /// The cache directory
+    std::string dir_;
+    /// Content hash of the files read so far
+    std::map<std::string, ULL> hashes_;
+    /// Used to name the temporary files
+    U tmp_count_;
+    /// Protects the members above
+    pthread_mutex_t lock_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_CACHE_H */
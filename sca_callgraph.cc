@@ -0,0 +1,233 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_callgraph.cc
+ *
+ *  \brief
+ *      Implementation of the call graph
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 18:11:40 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <algorithm>
+#include "sca_callgraph.hh"
+
+using namespace SCA;
+
+/// Low link of a function whose component is done, i.e it is off the stack
+#define SCC_DONE ((U)-1)
+
+/// A function on the walk and the position of the next of its callees to
+/// look at in the targets
+struct CallFrame {
+  U node_;
+  U next_;
+};
+
+/// A function and its sort key
+struct CallNode {
+  ULL usr_;
+  ULL id_;
+  Function *func_;
+};
+
+//==============================================================================
+///      \brief Order of the nodes. The id breaks the tie of two functions
+//              with the same USR (i.e two programs with a main()), so the
+//              graph and its cycle numbers do not depend on the hash order
+//==============================================================================
+static bool usr_less(const CallNode &a, const CallNode &b) {
+  if(a.usr_ != b.usr_) {
+    return a.usr_ < b.usr_;
+  }
+  return a.id_ < b.id_;
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method
+///      \brief   Constructor
+//==============================================================================
+CallGraph::CallGraph(void) {
+  num_unresolved_ = 0;
+  num_cycles_     = 0;
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method  clear
+///      \brief   Gives the memory back
+//==============================================================================
+void CallGraph::clear(void) {
+  std::vector<Function*>().swap(nodes_);
+  std::vector<ULL>().swap(usrs_);
+  std::vector<U>().swap(slots_);
+  std::vector<U>().swap(offsets_);
+  std::vector<U>().swap(targets_);
+  num_unresolved_ = 0;
+  num_cycles_     = 0;
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method  num_bytes
+///      \brief   What the vectors hold, the functions are not counted
+//==============================================================================
+size_t CallGraph::num_bytes(void) const {
+  return nodes_.capacity() * sizeof(Function*) + usrs_.capacity() * sizeof(ULL) +
+         slots_.capacity() * sizeof(U) + offsets_.capacity() * sizeof(U) +
+         targets_.capacity() * sizeof(U);
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method  find
+///      \brief   The USR hash is a hash already, its low bits are the slot.
+//                Of two functions with the same USR the first node is found
+//==============================================================================
+U CallGraph::find(ULL usr) const {
+  if(slots_.empty()) {
+    return (U)-1;
+  }
+  size_t mask = slots_.size() - 1;
+  for(size_t i=(size_t)usr & mask; slots_[i]; i=(i + 1) & mask) {
+    if(usrs_[slots_[i] - 1] == usr) {
+      return slots_[i] - 1;
+    }
+  }
+  return (U)-1;
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method  build
+///      \brief   The nodes are sorted on their USR, so the graph is the same
+//                whatever the order the functions come in. A call is one
+//                probe of the slots. The callees of a node come out in the
+//                order of the callees of the function i.e sorted
+//==============================================================================
+void CallGraph::build(const std::vector<Function*> &funcs) {
+  clear();
+  U num_nodes = funcs.size();
+  std::vector<CallNode> sorted(num_nodes);
+  ULL num_calls = 0;
+  for(U i=0; i<num_nodes; i++) {
+    sorted[i].usr_  = funcs[i]->usr();
+    sorted[i].id_   = funcs[i]->id().key();
+    sorted[i].func_ = funcs[i];
+    num_calls += funcs[i]->num_callees();
+  }
+  std::sort(sorted.begin(), sorted.end(), usr_less);
+  nodes_.resize(num_nodes);
+  usrs_.resize(num_nodes);
+  size_t num_slots = 16;
+  while(num_slots < 2 * (size_t)num_nodes) {
+    num_slots *= 2;
+  }
+  slots_.resize(num_slots, 0);
+  for(U i=0; i<num_nodes; i++) {
+    nodes_[i] = sorted[i].func_;
+    usrs_[i]  = sorted[i].usr_;
+    // A function without a USR can not be called
+    if(usrs_[i] && find(usrs_[i]) == (U)-1) {
+      size_t slot = (size_t)usrs_[i] & (num_slots - 1);
+      while(slots_[slot]) {
+        slot = (slot + 1) & (num_slots - 1);
+      }
+      slots_[slot] = i + 1;
+    }
+  }
+  std::vector<CallNode>().swap(sorted);
+  std::vector<U> fan_in(num_nodes, 0);
+  offsets_.resize(num_nodes + 1);
+  targets_.reserve(num_calls);
+  for(U i=0; i<num_nodes; i++) {
+    offsets_[i] = targets_.size();
+    const ULL *callees = nodes_[i]->callees();
+    for(U c=0; c<nodes_[i]->num_callees(); c++) {
+      U callee = find(callees[c]);
+      if(callee != (U)-1) {
+        targets_.push_back(callee);
+        fan_in[callee]++;
+      } else {
+        num_unresolved_++;
+      }
+    }
+    nodes_[i]->set_fan_out(targets_.size() - offsets_[i]);
+  }
+  offsets_[num_nodes] = targets_.size();
+  for(U i=0; i<num_nodes; i++) {
+    nodes_[i]->set_fan_in(fan_in[i]);
+  }
+  find_cycles();
+}
+
+//==============================================================================
+///      \class   CallGraph
+///      \method  find_cycles
+///      \brief   Tarjan's algorithm with the recursion on an explicit stack,
+//                so a deep call chain can not overflow the C stack. A node
+//                gets its index when it is first reached and its low link is
+//                the smallest index it can get back to. A node whose low link
+//                is its own index is the root of a component, which is then
+//                on top of the member stack. O(functions + calls)
+//==============================================================================
+void CallGraph::find_cycles(void) {
+  U num_nodes = nodes_.size();
+  std::vector<U> index(num_nodes, 0);
+  std::vector<U> low(num_nodes, 0);
+  std::vector<U> members;
+  std::vector<CallFrame> stack;
+  U counter = 0;
+  num_cycles_ = 0;
+  for(U root=0; root<num_nodes; root++) {
+    if(index[root]) {
+      continue;
+    }
+    index[root] = low[root] = ++counter;
+    members.push_back(root);
+    CallFrame first = { root, offsets_[root] };
+    stack.push_back(first);
+    while(!stack.empty()) {
+      CallFrame &top = stack.back();
+      U node = top.node_;
+      if(top.next_ < offsets_[node + 1]) {
+        U callee = targets_[top.next_++];
+        if(0 == index[callee]) {
+          index[callee] = low[callee] = ++counter;
+          members.push_back(callee);
+          CallFrame frame = { callee, offsets_[callee] };
+          stack.push_back(frame);
+        } else if(low[callee] != SCC_DONE && index[callee] < low[node]) {
+          // Still on the member stack, i.e in the component being built
+          low[node] = index[callee];
+        }
+        continue;
+      }
+      stack.pop_back();
+      if(low[node] != index[node]) {
+        U caller = stack.back().node_;
+        if(low[node] < low[caller]) {
+          low[caller] = low[node];
+        }
+        continue;
+      }
+      size_t start = members.size() - 1;
+      while(members[start] != node) {
+        start--;
+      }
+      const U *callees = this->callees(node);
+      bool isCycle = (members.size() - start > 1) ||
+                     std::binary_search(callees, callees + num_callees(node), node);
+      U scc = isCycle ? ++num_cycles_ : 0;
+      for(size_t i=start; i<members.size(); i++) {
+        low[members[i]] = SCC_DONE;
+        nodes_[members[i]]->set_scc(scc);
+      }
+      members.resize(start);
+    }
+  }
+}
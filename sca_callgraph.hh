@@ -0,0 +1,87 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_callgraph.hh
+ *
+ *  \brief
+ *      Whole program call graph
+ *
+ *  \details
+ *      The body walk records the USR hash of every function a function
+ *      calls. A USR is the same in every TU, so once all the TUs and the
+ *      merged inputs are in the tree the calls are resolved to the
+ *      functions defined anywhere in it. Calls to functions SCA has not
+ *      seen (i.e libc) are dropped.
+ *
+ *      The graph is kept in compressed sparse row form: the nodes are the
+ *      functions sorted on their USR hash and the callees of node n are
+ *      targets_[offsets_[n] .. offsets_[n + 1]). That is 4 bytes per call
+ *      and 4 per function on top of the node table and the open addressing
+ *      table the calls are resolved with.
+ *
+ *      From the graph every function gets its fan-in (distinct callers),
+ *      fan-out (distinct callees) and the recursion cycle it is part of.
+ *      The cycles are the strongly connected components of more than one
+ *      function, or of one that calls itself, found with Tarjan's
+ *      algorithm run on an explicit stack.
+ *
+ *  \history
+ *      10/18/26 18:05:12 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_CALLGRAPH_H
+#define SCA_CALLGRAPH_H
+
+#include <vector>
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  CallGraph
+///        \brief  The resolved calls of all the functions of the tree
+// ============================================================================
+class CallGraph {
+  public:
+    /// Ctor
+    CallGraph(void);
+    /// Build the graph of "funcs" and set their fan-in, fan-out and cycle
+    void build(const std::vector<Function*> &funcs);
+    /// Drop the graph
+    void clear(void);
+    /// Number of functions
+    U num_nodes(void) const { return nodes_.size(); }
+    /// Number of resolved calls
+    ULL num_edges(void) const { return targets_.size(); }
+    /// The function of node "n"
+    Function* node(U n) const { return nodes_[n]; }
+    /// Node of the function with the USR hash, (U)-1 if there is none
+    U find(ULL usr) const;
+    /// The callees of node "n", as nodes
+    const U* callees(U n) const { return targets_.empty() ? NULL : &targets_[0] + offsets_[n]; }
+    U num_callees(U n) const { return offsets_[n + 1] - offsets_[n]; }
+    /// Calls to functions that are not in the graph
+    ULL num_unresolved(void) const { return num_unresolved_; }
+    /// Number of recursion cycles
+    U num_cycles(void) const { return num_cycles_; }
+    /// Bytes held by the graph
+    size_t num_bytes(void) const;
+
+  private:
+    /// Tarjan's strongly connected components. Numbers the cycles
+    void find_cycles(void);
+    /// The functions and their USR hash, sorted on the hash
+    std::vector<Function*> nodes_;
+    std::vector<ULL> usrs_;
+    /// Open addressing table of node+1 on the USR hash, 0 is an empty slot
+    std::vector<U> slots_;
+    /// Compressed sparse row of the callees
+    std::vector<U> offsets_;
+    std::vector<U> targets_;
+    ULL num_unresolved_;
+    U num_cycles_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_CALLGRAPH_H */
@@ -0,0 +1,405 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_daemon.cc
+ *
+ *  \brief
+ *      Implementation of the resident analysis daemon and its client
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 10:14:36 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "sca_daemon.hh"
+#include "sca_analyzer.hh"
+#include "sca_driver.hh"
+#include "sca_globals.hh"
+#include "sca_input.hh"
+#include "sca_visitor.hh"
+#include "sca_workqueue.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \brief Fill the socket address. Returns false if the path is too long
+//==============================================================================
+static bool make_address(const std::string &path, struct sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(path.size() >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "sca: socket path too long %s\n", path.c_str());
+    return false;
+  }
+  strcpy(addr.sun_path, path.c_str());
+  return true;
+}
+
+//==============================================================================
+///      \brief Write the whole buffer, retrying on short writes
+//==============================================================================
+static bool write_all(int fd, const char *buf, size_t len) {
+  while(len) {
+    ssize_t n = write(fd, buf, len);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+//==============================================================================
+///      \brief Read one request i.e strings separated by \0 and ended by an
+//              empty string
+//==============================================================================
+static bool read_request(int fd, std::vector<std::string> &strs) {
+  std::string buf;
+  char chunk[4096];
+  while(buf.size() < 2 || buf[buf.size()-1] != '\0' || buf[buf.size()-2] != '\0') {
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      return false;
+    }
+    buf.append(chunk, n);
+  }
+  size_t start = 0;
+  while(start < buf.size() && buf[start] != '\0') {
+    size_t end = buf.find('\0', start);
+    strs.push_back(buf.substr(start, end - start));
+    start = end + 1;
+  }
+  return !strs.empty();
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method
+///      \brief   Constructor
+//==============================================================================
+Daemon::Daemon(const std::string &socket_path) : socket_path_(socket_path) {
+  idx_ = clang_createIndex(0, 1);
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method
+///      \brief   Destructor
+//==============================================================================
+Daemon::~Daemon() {
+  std::map<std::string, ResidentTU>::iterator it;
+  for(it=tus_.begin(); it!=tus_.end(); it++) {
+    clang_disposeTranslationUnit(it->second.tu_);
+  }
+  clang_disposeIndex(idx_);
+}
+
+//==============================================================================
+///      \brief Inclusion visitor. Records the mtime clang saw for every file
+//==============================================================================
+static void record_dep(CXFile file,
+                       CXSourceLocation *stack,
+                       unsigned stack_len,
+                       CXClientData client_data) {
+  std::map<std::string, time_t> *deps =
+    static_cast<std::map<std::string, time_t>*>(client_data);
+  CXString name = clang_getFileName(file);
+  (*deps)[clang_getCString(name)] = clang_getFileTime(file);
+  clang_disposeString(name);
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  record_deps
+///      \brief   Record the files the TU depends on along with their mtime
+//==============================================================================
+void Daemon::record_deps(ResidentTU &rtu) {
+  rtu.deps_.clear();
+  clang_getInclusions(rtu.tu_, record_dep, &rtu.deps_);
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  is_stale
+///      \brief   Whether any of the files the TU depends on changed on disk
+//==============================================================================
+bool Daemon::is_stale(const ResidentTU &rtu) {
+  std::map<std::string, time_t>::const_iterator it;
+  for(it=rtu.deps_.begin(); it!=rtu.deps_.end(); it++) {
+    struct stat st;
+    if(stat(it->first.c_str(), &st) != 0 || st.st_mtime != it->second) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  update
+///      \brief   Parse the source if it is not resident. A resident TU whose
+//                files changed is reparsed, which reuses its preamble
+//==============================================================================
+void Daemon::update(const std::string &source,
+                    const std::vector<std::string> &args) {
+  ResidentTU &rtu = tus_[source];
+  if(rtu.tu_ && rtu.args_ != args) {
+    // Different flags, the TU has to be parsed from scratch
+    clang_disposeTranslationUnit(rtu.tu_);
+    rtu.tu_ = NULL;
+  }
+  if(rtu.tu_) {
+    if(!is_stale(rtu)) {
+      return;
+    }
+    if(0 == clang_reparseTranslationUnit(rtu.tu_, 0, NULL,
+                                         clang_defaultReparseOptions(rtu.tu_))) {
+      record_deps(rtu);
+      return;
+    }
+    // The TU is unusable once reparse fails
+    clang_disposeTranslationUnit(rtu.tu_);
+    rtu.tu_ = NULL;
+  }
+  std::vector<const char*> c_args;
+  for(size_t i=0; i<args.size(); i++) {
+    c_args.push_back(args[i].c_str());
+  }
+  rtu.args_ = args;
+  rtu.tu_ = clang_parseTranslationUnit(idx_,
+                                       source.c_str(),
+                                       c_args.empty() ? NULL : &c_args[0],
+                                       c_args.size(),
+                                       NULL, 0,
+                                       CXTranslationUnit_DetailedPreprocessingRecord |
+                                       clang_defaultEditingTranslationUnitOptions());
+  if(NULL == rtu.tu_) {
+    fprintf(stderr, "sca: failed to parse %s\n", source.c_str());
+    tus_.erase(source);
+    return;
+  }
+  record_deps(rtu);
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  analyze
+///      \brief   Same as a "sca" run with the given args, except that the TUs
+//                are served from memory. The tree is rebuilt for every
+//                request as it links classes and files across the TUs
+//==============================================================================
+void Daemon::analyze(const std::string &cwd,
+                     std::vector<std::string> &argv,
+                     FILE *out) {
+  std::vector<std::string> sources;
+  std::vector<std::string> args;
+  bool compact = false;
+  SCA::OutputFormat format = SCA::kFormatJson;
+  std::string sqlite_path;
+  std::string shard_dir;
+  SCA::InputMerger merger;
+  for(size_t i=0; i<argv.size(); i++) {
+    if(argv[i] == "--sca-compact") {
+      compact = true;
+    } else if(!argv[i].compare(0, 13, "--sca-format=")) {
+      if(!parseOutputFormat(argv[i].c_str() + 13, format)) {
+        fprintf(stderr, "sca: unknown output format %s\n", argv[i].c_str() + 13);
+      }
+    } else if(argv[i] == "-o" && (i+1 < argv.size())) {
+      // Only sent with --sca-format=shards
+      shard_dir = make_absolute(cwd, argv[++i]);
+    } else if(!argv[i].compare(0, 13, "--sca-sqlite=")) {
+      sqlite_path = make_absolute(cwd, argv[i].substr(13));
+    } else if(!argv[i].compare(0, 6, "--sca-")) {
+      // Driver options do not apply to the daemon
+      continue;
+    } else if(isOptionWithValue(argv[i].c_str()) && (i+1 < argv.size())) {
+      args.push_back(argv[i]);
+      args.push_back(argv[i+1]);
+      i++;
+    } else {
+      std::string cur_file = make_absolute(cwd, argv[i]);
+      if(isFileOfInterest(cur_file) && merger.add(cur_file)) {
+        // Output of an earlier run, merged in to the tree below
+      } else if(getType(cur_file) == SCA::File::kSource ||
+                getType(cur_file) == SCA::File::kHeader) {
+        sources.push_back(cur_file);
+      } else if(!isFileOfInterest(cur_file)) {
+        args.push_back(argv[i]);
+      }
+    }
+  }
+  absolutize_args(cwd, args);
+  SCA_globals::getGlobals()->set_write_descriptor(out);
+  SCA_GET_WRITER().set_compact(compact);
+  SCA_GET_WRITER().set_format(format);
+  SCA_globals::getGlobals()->set_sqlite_path(sqlite_path);
+  SCA_globals::getGlobals()->set_shard_dir(shard_dir);
+  if(format == SCA::kFormatShards && shard_dir.empty()) {
+    fprintf(stderr, "sca: --sca-format=shards needs the directory of the shards in -o\n");
+    SCA_GET_WRITER().set_format(SCA::kFormatJson);
+  }
+  SCA_globals::getGlobals()->stats() = SCA::Stats();
+  // The daemon has the machine to itself
+  merger.run(SCA::WorkQueue::num_cpus());
+  for(size_t i=0; i<sources.size(); i++) {
+    update(sources[i], args);
+    std::map<std::string, ResidentTU>::iterator it = tus_.find(sources[i]);
+    if(it != tus_.end()) {
+      SCA::Context cntxt;
+      getLexArgs(sources[i], args, cntxt.lex_args_);
+      sca_lex_translation_unit(it->second.tu_, &cntxt);
+      sca_visit_translation_unit(it->second.tu_, &cntxt);
+    }
+  }
+  sca_analyzer();
+  if(SCA_globals::getGlobals()->stats_enabled()) {
+    sca_dump_stats();
+  }
+  // Also closes "out"
+  clean_up();
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  serve
+///      \brief   Serve one connection. Returns false on a shutdown request
+//==============================================================================
+bool Daemon::serve(int fd) {
+  std::vector<std::string> strs;
+  if(!read_request(fd, strs)) {
+    close(fd);
+    return true;
+  }
+  std::string cwd = strs[0];
+  std::vector<std::string> argv(strs.begin() + 1, strs.end());
+  if(argv.size() == 1 && argv[0] == "--sca-shutdown") {
+    close(fd);
+    return false;
+  }
+  FILE *out = fdopen(fd, "w");
+  if(NULL == out) {
+    close(fd);
+    return true;
+  }
+  analyze(cwd, argv, out);
+  return true;
+}
+
+//==============================================================================
+///      \class   Daemon
+///      \method  run
+///      \brief   Serve requests until a shutdown request
+//==============================================================================
+int Daemon::run(void) {
+  struct sockaddr_un addr;
+  if(!make_address(socket_path_, addr)) {
+    return 1;
+  }
+  // A client that goes away must not take the daemon down
+  signal(SIGPIPE, SIG_IGN);
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socket_path_.c_str());
+  if(sock < 0 ||
+     bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+     listen(sock, 16) != 0) {
+    fprintf(stderr, "sca: could not listen on %s\n", socket_path_.c_str());
+    if(sock >= 0) {
+      close(sock);
+    }
+    return 1;
+  }
+  bool running = true;
+  while(running) {
+    int fd = accept(sock, NULL, NULL);
+    if(fd < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    running = serve(fd);
+  }
+  close(sock);
+  unlink(socket_path_.c_str());
+  return 0;
+}
+
+//==============================================================================
+///      \brief Send the args to the daemon and write the reply to the -o file
+//              or to stdout
+//==============================================================================
+int sca_client(const std::string &socket_path, int argc, char *argv[]) {
+  char cwd[1024];
+  if(getcwd(cwd, sizeof(cwd)) == NULL) {
+    fprintf(stderr, "sca: getcwd() error\n");
+    return 1;
+  }
+  std::string request(cwd, strlen(cwd) + 1);
+  const char *out_file = NULL;
+  // The shards are written by the daemon, it gets the directory
+  bool shards = false;
+  for(int i=1; i<argc; i++) {
+    shards = shards || !strcmp(argv[i], "--sca-format=shards");
+  }
+  for(int i=1; i<argc; i++) {
+    if(!strcmp(argv[i], "-o") && (i+1 < argc) && !shards) {
+      out_file = argv[++i];
+    } else if(!strncmp(argv[i], "--sca-client=", 13) || argv[i][0] == '\0') {
+      continue;
+    } else {
+      request.append(argv[i], strlen(argv[i]) + 1);
+    }
+  }
+  request.push_back('\0');
+  struct sockaddr_un addr;
+  if(!make_address(socket_path, addr)) {
+    return 1;
+  }
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "sca: no daemon listening on %s\n", socket_path.c_str());
+    if(sock >= 0) {
+      close(sock);
+    }
+    return 1;
+  }
+  if(!write_all(sock, request.c_str(), request.size())) {
+    close(sock);
+    return 1;
+  }
+  FILE *fp = out_file ? fopen(out_file, "w") : stdout;
+  if(NULL == fp) {
+    close(sock);
+    return 1;
+  }
+  char chunk[4096];
+  ssize_t n;
+  while((n = read(sock, chunk, sizeof(chunk))) != 0) {
+    if(n < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    fwrite(chunk, 1, n, fp);
+  }
+  close(sock);
+  if(out_file) {
+    fclose(fp);
+  }
+  return (n == 0) ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_daemon.hh
+ *
+ *  \brief
+ *      Resident analysis server and its thin client
+ *
+ *  \details
+ *      The daemon keeps the CXIndex and the parsed translation units in
+ *      memory and serves analyze requests over a Unix domain socket. A TU
+ *      whose source or headers changed since it was parsed is brought up
+ *      to date with clang_reparseTranslationUnit, which reuses the
+ *      precompiled preamble of the TU. Every request rebuilds the SCA tree
+ *      by walking the resident TUs and the dump is sent back to the client.
+ *
+ *      Request : <cwd>\0<arg>\0<arg>\0...\0\0
+ *      Reply   : The JSON output, till the daemon closes the connection
+ *
+ *  \history
+ *      10/18/26 10:02:11 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_DAEMON_H
+#define SCA_DAEMON_H
+
+#include <time.h>
+#include <clang-c/Index.h>
+#include "sca_int.hh"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  ResidentTU
+///        \brief  A translation unit kept in memory by the daemon
+// ============================================================================
+class ResidentTU {
+  public:
+    ResidentTU(void) {
+      tu_ = NULL;
+    }
+    /// The parsed TU
+    CXTranslationUnit tu_;
+    /// Compiler args it is parsed with
+    std::vector<std::string> args_;
+    /// Modification time of the source and of every header it includes
+    std::map<std::string, time_t> deps_;
+};
+
+// ============================================================================
+///        \class  Daemon
+///        \brief  Serves analyze requests on a Unix domain socket
+// ============================================================================
+class Daemon {
+  public:
+    /// Ctor
+    Daemon(const std::string &socket_path);
+    /// Dtor
+    ~Daemon();
+    /// Serve requests until a shutdown request. Returns the exit code
+    int run(void);
+
+  private:
+    /// Serve one connection
+    bool serve(int fd);
+    /// Bring the requested sources up to date and dump the tree to "out"
+    void analyze(const std::string &cwd,
+                 std::vector<std::string> &argv,
+                 FILE *out);
+    /// Parse the source or reparse it if any of its files changed
+    void update(const std::string &source, const std::vector<std::string> &args);
+    /// Record the files the TU depends on along with their mtime
+    static void record_deps(ResidentTU &rtu);
+    /// Whether any of the files the TU depends on changed
+    static bool is_stale(const ResidentTU &rtu);
+    /// Path of the socket
+    std::string socket_path_;
+    /// The index that owns all the resident TUs
+    CXIndex idx_;
+    /// Resident TUs keyed on the absolute path of the source
+    std::map<std::string, ResidentTU> tus_;
+};
+
+} // END SCA namespace
+
+//--------------------------------------------------------------------------------------
+///      \brief Send the args to the daemon on "socket_path" and write the reply
+///             to the -o file (or stdout). Returns the exit code
+//--------------------------------------------------------------------------------------
+int sca_client(const std::string &socket_path, int argc, char *argv[]);
+
+#endif    /* SCA_DAEMON_H */
@@ -0,0 +1,324 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_driver.cc
+ *
+ *  \brief
+ *      Implementation of the multi translation unit driver
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 07:21:44 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <clang-c/CXCompilationDatabase.h>
+#include "sca_cache.hh"
+#include "sca_driver.hh"
+#include "sca_globals.hh"
+#include "sca_preamble.hh"
+#include "sca_visitor.hh"
+#include "sca_workqueue.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \brief Tells if the compiler option takes a separate value i.e "-I dir"
+//==============================================================================
+bool isOptionWithValue(const char *arg) {
+  static const char* options[] = {
+    "-I", "-D", "-U", "-x", "-include", "-imacros", "-isystem", "-iquote",
+    "-idirafter", "-MF", "-MT", "-MQ", "-Xclang", "-arch", "-target", NULL
+  };
+  for(int i=0; options[i]; i++) {
+    if(!strcmp(arg, options[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//==============================================================================
+///      \brief Prefix "dir" to a relative path
+//==============================================================================
+std::string make_absolute(const std::string &dir, const std::string &path) {
+  if(path.empty() || path[0] == '/' || dir.empty()) {
+    return path;
+  }
+  return dir + "/" + path;
+}
+
+//==============================================================================
+///      \brief Rewrite the path options of a compile command so that they are
+//              valid from any working directory. The compilation database
+//              paths are relative to the "directory" of the entry.
+//==============================================================================
+void absolutize_args(const std::string &dir, std::vector<std::string> &args) {
+  static const char* path_options[] = {
+    "-I", "-include", "-imacros", "-isystem", "-iquote", "-idirafter", NULL
+  };
+  for(size_t i=0; i<args.size(); i++) {
+    for(int j=0; path_options[j]; j++) {
+      size_t len = strlen(path_options[j]);
+      if(args[i].compare(0, len, path_options[j]) != 0) {
+        continue;
+      }
+      if(args[i].size() == len) {
+        // "-I dir" form
+        if(i+1 < args.size()) {
+          args[i+1] = make_absolute(dir, args[i+1]);
+          i++;
+        }
+      } else if(len == 2) {
+        // "-Idir" form. Only -I can be glued to its value
+        args[i] = args[i].substr(0, len) + make_absolute(dir, args[i].substr(len));
+      } else {
+        continue;
+      }
+      break;
+    }
+  }
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method
+///      \brief   Constructor
+//==============================================================================
+Driver::Driver(void) {
+  num_workers_    = 1;
+  preamble_cache_ = NULL;
+  result_cache_   = NULL;
+  next_turn_      = 0;
+  pthread_mutex_init(&turn_lock_, NULL);
+  pthread_cond_init(&turn_, NULL);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method
+///      \brief   Destructor
+//==============================================================================
+Driver::~Driver() {
+  pthread_cond_destroy(&turn_);
+  pthread_mutex_destroy(&turn_lock_);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  addSource
+///      \brief   Add a source file to be parsed with "args"
+//==============================================================================
+void Driver::addSource(const std::string &source,
+                       const std::vector<std::string> &args) {
+  TUJob job;
+  job.source_ = source;
+  job.args_   = args;
+  jobs_.push_back(job);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  loadCompilationDatabase
+///      \brief   Add all the entries of the compile_commands.json in "dir"
+//==============================================================================
+bool Driver::loadCompilationDatabase(const std::string &dir) {
+  CXCompilationDatabase_Error err;
+  CXCompilationDatabase db = clang_CompilationDatabase_fromDirectory(dir.c_str(), &err);
+  if(err != CXCompilationDatabase_NoError || !db) {
+    return false;
+  }
+  CXCompileCommands cmds = clang_CompilationDatabase_getAllCompileCommands(db);
+  unsigned num_cmds = clang_CompileCommands_getSize(cmds);
+  for(unsigned i=0; i<num_cmds; i++) {
+    CXCompileCommand cmd = clang_CompileCommands_getCommand(cmds, i);
+    CXString cx_dir  = clang_CompileCommand_getDirectory(cmd);
+    CXString cx_file = clang_CompileCommand_getFilename(cmd);
+    std::string cmd_dir(clang_getCString(cx_dir));
+    std::string file(clang_getCString(cx_file));
+    clang_disposeString(cx_dir);
+    clang_disposeString(cx_file);
+    std::vector<std::string> args;
+    unsigned num_args = clang_CompileCommand_getNumArgs(cmd);
+    // Arg 0 is the compiler itself
+    for(unsigned j=1; j<num_args; j++) {
+      CXString cx_arg = clang_CompileCommand_getArg(cmd, j);
+      std::string arg(clang_getCString(cx_arg));
+      clang_disposeString(cx_arg);
+      if(arg == "-o") {
+        j++;
+        continue;
+      }
+      if(arg == file) {
+        continue;
+      }
+      args.push_back(arg);
+    }
+    absolutize_args(cmd_dir, args);
+    addSource(make_absolute(cmd_dir, file), args);
+  }
+  clang_CompileCommands_dispose(cmds);
+  clang_CompilationDatabase_dispose(db);
+  return true;
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  parse_job
+///      \brief   Parse the job, with the PCH if "pch" is not empty
+//==============================================================================
+CXTranslationUnit Driver::parse_job(CXIndex idx, 
+                                    const TUJob &job, 
+                                    const std::string &pch) {
+  std::vector<const char*> c_args;
+  for(size_t i=0; i<job.args_.size(); i++) {
+    c_args.push_back(job.args_[i].c_str());
+  }
+  if(!pch.empty()) {
+    c_args.push_back("-include-pch");
+    c_args.push_back(pch.c_str());
+  }
+  return clang_parseTranslationUnit(idx,
+                                    job.source_.c_str(),
+                                    c_args.empty() ? NULL : &c_args[0],
+                                    c_args.size(),
+                                    NULL, 0,
+                                    CXTranslationUnit_DetailedPreprocessingRecord);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  wait_turn
+///      \brief   The queue hands the jobs out in order, so the jobs before
+//                "item" are all being parsed already and the wait is bounded
+//==============================================================================
+void Driver::wait_turn(size_t item) {
+  pthread_mutex_lock(&turn_lock_);
+  while(next_turn_ != item) {
+    pthread_cond_wait(&turn_, &turn_lock_);
+  }
+  pthread_mutex_unlock(&turn_lock_);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  end_turn
+///      \brief   Wake up the waiter of the next job
+//==============================================================================
+void Driver::end_turn(void) {
+  pthread_mutex_lock(&turn_lock_);
+  next_turn_++;
+  pthread_cond_broadcast(&turn_);
+  pthread_mutex_unlock(&turn_lock_);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  analyze_job
+///      \brief   Parse one TU on the calling worker and walk it in its turn.
+//                FileIds and PkgIds are handed out by the walk, so the jobs
+//                must reach the tree in order for the output to be the same
+//                with any number of workers
+//==============================================================================
+void Driver::analyze_job(void *user_data, size_t item, int worker) {
+  Driver *driver = static_cast<Driver*>(user_data);
+  TUJob &job = driver->jobs_[item];
+  CXIndex idx = driver->indices_[worker];
+  ULL cache_key = 0;
+  bool stats_enabled = SCA_globals::getGlobals()->stats_enabled();
+  double start_time = stats_enabled ? sca_time_now() : 0;
+  SCA::CacheHit hit;
+  if(driver->result_cache_ && driver->result_cache_->lookup(job, cache_key, hit)) {
+    // Nothing changed since the last run. No need to even parse
+    driver->wait_turn(item);
+    driver->result_cache_->load(hit);
+    driver->end_turn();
+    return;
+  }
+  std::string pch;
+  if(driver->preamble_cache_) {
+    pch = driver->preamble_cache_->acquire(driver->jobs_, item, idx);
+  }
+  // If an earlier TU walked the headers of the PCH, their declarations
+  // are not even handed to the visitor. A TU is marked after its walk,
+  // which comes after the walk of every job before it, so the marker is
+  // always earlier in the order
+  if(!pch.empty() && driver->preamble_cache_->isCovered(pch)) {
+    idx = driver->local_indices_[worker];
+  }
+  // Parsing is where the time goes and it needs no global state
+  CXTranslationUnit TU = parse_job(idx, job, pch);
+  if(TU && !pch.empty() && hasDiagnostics(TU, CXDiagnostic_Fatal)) {
+    // Mostly a header changed after the PCH was built. Parse from scratch
+    clang_disposeTranslationUnit(TU);
+    driver->preamble_cache_->invalidate(pch);
+    pch.clear();
+    TU = parse_job(driver->indices_[worker], job, pch);
+  }
+  if(NULL == TU) {
+    driver->wait_turn(item);
+    fprintf(stderr, "sca: failed to parse %s\n", job.source_.c_str());
+    driver->end_turn();
+    return;
+  }
+  // Counting the Halstead tokens and hashing the included files need no
+  // global state either
+  SCA::Context cntxt;
+  SCA::CacheEntry entry;
+  getLexArgs(job.source_, job.args_, cntxt.lex_args_);
+  sca_lex_translation_unit(TU, &cntxt);
+  if(driver->result_cache_) {
+    driver->result_cache_->prepare(cache_key, TU, entry);
+  }
+  // Walking the AST updates the global tree. One TU at a time, in order
+  double wait_time = stats_enabled ? sca_time_now() : 0;
+  driver->wait_turn(item);
+  SCA_globals::getGlobals()->lock();
+  double locked_time = stats_enabled ? sca_time_now() : 0;
+  sca_visit_translation_unit(TU, &cntxt);
+  if(driver->result_cache_) {
+    driver->result_cache_->render(entry);
+  }
+  if(stats_enabled) {
+    SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+    stats.tus_++;
+    stats.tu_parallel_time_ += wait_time - start_time;
+    stats.tu_wait_time_     += locked_time - wait_time;
+    stats.tu_locked_time_   += sca_time_now() - locked_time;
+  }
+  SCA_globals::getGlobals()->unlock();
+  if(!pch.empty()) {
+    driver->preamble_cache_->markCovered(pch);
+  }
+  driver->end_turn();
+  if(driver->result_cache_) {
+    driver->result_cache_->store(entry);
+  }
+  clang_disposeTranslationUnit(TU);
+}
+
+//==============================================================================
+///      \class   Driver
+///      \method  run
+///      \brief   Parse all the jobs on the worker threads
+//==============================================================================
+void Driver::run(void) {
+  if(preamble_cache_) {
+    preamble_cache_->plan(jobs_);
+  }
+  next_turn_ = 0;
+  WorkQueue queue(jobs_.size(), num_workers_);
+  indices_.resize(queue.num_workers());
+  local_indices_.resize(queue.num_workers());
+  for(int i=0; i<queue.num_workers(); i++) {
+    indices_[i] = clang_createIndex(0, 1);
+    local_indices_[i] = clang_createIndex(1, 1);
+  }
+  queue.run(Driver::analyze_job, this);
+  for(int i=0; i<queue.num_workers(); i++) {
+    clang_disposeIndex(indices_[i]);
+    clang_disposeIndex(local_indices_[i]);
+  }
+  indices_.clear();
+  local_indices_.clear();
+}
@@ -0,0 +1,126 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_driver.hh
+ *
+ *  \brief
+ *      Parses many translation units in parallel
+ *
+ *  \details
+ *      The driver takes a list of sources (either from the command line or
+ *      from a compile_commands.json) and parses them on N worker threads.
+ *      Every worker owns its CXIndex. Parsing runs in parallel, the walk
+ *      over the AST is serialized on the SCA_globals lock so that all the
+ *      TUs end up in the same package tree. The TUs are walked in the order
+ *      they were added, so the output does not depend on the number of
+ *      workers.
+ *
+ *  \history
+ *      10/18/26 07:10:05 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_DRIVER_H
+#define SCA_DRIVER_H
+
+#include <pthread.h>
+#include <clang-c/Index.h>
+#include "sca_int.hh"
+
+namespace SCA {
+
+class PreambleCache;
+class ResultCache;
+
+// ============================================================================
+///        \class  TUJob
+///        \brief  One translation unit to be parsed
+// ============================================================================
+class TUJob {
+  public:
+    /// The source file
+    std::string source_;
+    /// Compiler args excluding the source file itself
+    std::vector<std::string> args_;
+};
+
+// ============================================================================
+///        \class  Driver
+///        \brief  Parses the translation units on a pool of threads
+// ============================================================================
+class Driver {
+  public:
+    /// Ctor
+    Driver(void);
+    /// Dtor
+    ~Driver();
+    /// Add a source file to be parsed with "args"
+    void addSource(const std::string &source,
+                   const std::vector<std::string> &args);
+    /// Add all the entries of the compile_commands.json present in "dir"
+    bool loadCompilationDatabase(const std::string &dir);
+    /// Set the number of worker threads
+    void set_num_workers(int num_workers) {
+      num_workers_ = num_workers;
+    }
+    /// Use the PCH cache for the include blocks of the TUs
+    void set_preamble_cache(PreambleCache *cache) {
+      preamble_cache_ = cache;
+    }
+    /// Serve the TUs that did not change from the result cache
+    void set_result_cache(ResultCache *cache) {
+      result_cache_ = cache;
+    }
+    /// Number of jobs queued
+    size_t cJobs(void) const { return jobs_.size(); }
+    /// Parse all the jobs
+    void run(void);
+
+  private:
+    Driver(const Driver&);
+    Driver& operator=(const Driver&);
+    /// Work queue callback
+    static void analyze_job(void *user_data, size_t item, int worker);
+    /// Parse the job, with the PCH if "pch" is not empty
+    static CXTranslationUnit parse_job(CXIndex idx, 
+                                       const TUJob &job, 
+                                       const std::string &pch);
+    /// Wait for the jobs before "item" to be walked
+    void wait_turn(size_t item);
+    /// Let the next job be walked
+    void end_turn(void);
+    /// All the jobs
+    std::vector<TUJob> jobs_;
+    /// One index per worker
+    std::vector<CXIndex> indices_;
+    /// One index per worker that leaves out the declarations of the PCH.
+    ///  Used once the headers of the PCH are in the tree
+    std::vector<CXIndex> local_indices_;
+    /// Number of worker threads
+    int num_workers_;
+    /// PCH cache, NULL if not enabled
+    PreambleCache *preamble_cache_;
+    /// Result cache, NULL if not enabled
+    ResultCache *result_cache_;
+    /// Index of the next job to be walked
+    size_t next_turn_;
+    pthread_mutex_t turn_lock_;
+    pthread_cond_t turn_;
+};
+
+} // END SCA namespace
+
+//--------------------------------------------------------------------------------------
+///      \brief Tells if the compiler option takes a separate value i.e "-I dir"
+//--------------------------------------------------------------------------------------
+bool isOptionWithValue(const char *arg);
+
+//--------------------------------------------------------------------------------------
+///      \brief Prefix "dir" to a relative path
+//--------------------------------------------------------------------------------------
+std::string make_absolute(const std::string &dir, const std::string &path);
+
+//--------------------------------------------------------------------------------------
+///      \brief Make the path options (-I, -include, ...) absolute w.r.t "dir"
+//--------------------------------------------------------------------------------------
+void absolutize_args(const std::string &dir, std::vector<std::string> &args);
+
+#endif    /* SCA_DRIVER_H */
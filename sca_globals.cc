@@ -12,12 +12,60 @@
  *      06/06/14 02:23:43 PDT Created By Prakash S
  *
  *  ----------------------------------------------------------*/
+#include <limits.h>
 #include "sca_globals.hh"
 
 FileIdMgr* FileIdMgr::instance_ = NULL;
 PkgIdMgr* PkgIdMgr::instance_   = NULL;
 SCA_globals* SCA_globals::instance_ = NULL;
 
+//==============================================================================
+///      \brief The arena that owns the SCA tree
+//==============================================================================
+SCA::Arena& SCA::sca_obj_arena(void) {
+  return SCA_globals::getGlobals()->obj_arena();
+}
+
+//==============================================================================
+///      \brief The pool the names of the objects are interned in
+//==============================================================================
+StringTable& SCA::sca_name_pool(void) {
+  return SCA_globals::getGlobals()->name_pool();
+}
+
+//==============================================================================
+///      \class   SCA_globals
+///      \method  realPath
+///      \brief   Canonical path of the file, cached on the unique id (device,
+//                inode, mtime) of the file
+//==============================================================================
+std::string SCA_globals::realPath(CXFile file) {
+  CXFileUniqueID uid;
+  bool has_uid = (0 == clang_getFileUniqueID(file, &uid));
+  pthread_mutex_lock(&paths_lock_);
+  stats_.path_lookups_++;
+  if(has_uid) {
+    std::map<FileUniqueKey, std::string>::iterator it = real_paths_.find(FileUniqueKey(uid));
+    if(it != real_paths_.end()) {
+      std::string path = it->second;
+      pthread_mutex_unlock(&paths_lock_);
+      return path;
+    }
+  }
+  stats_.path_misses_++;
+  pthread_mutex_unlock(&paths_lock_);
+  CXString name = clang_getFileName(file);
+  char real_path[PATH_MAX] = "";
+  getAbsolutePathFromRelativePath(clang_getCString(name), real_path);
+  clang_disposeString(name);
+  if(has_uid) {
+    pthread_mutex_lock(&paths_lock_);
+    real_paths_[FileUniqueKey(uid)] = real_path;
+    pthread_mutex_unlock(&paths_lock_);
+  }
+  return std::string(real_path);
+}
+
 //==============================================================================
 ///      \class   FileIdMgr
 ///      \method  insertFile
@@ -31,14 +79,15 @@ FileIdMgr::insertFile(std::string file_name) {
   if(!(file_type == SCA::File::kSource || file_type == SCA::File::kHeader)) {
     return INVALID_FILE_ID;
   }
-  // Split up the path in to pkg name and base name
-  std::string base_name;
-  std::string pkg_name;
-  split_path(file_name, pkg_name, base_name); 
-  if(!name_vs_fileId_.count(base_name)) {
+  // Files are identified by the full path. a/util.h and b/util.h differ
+  FileId cur_id = paths_.intern(file_name);
+  if(cur_id == file_count_) {
+    // Split up the path in to pkg name and base name
+    std::string base_name;
+    std::string pkg_name;
+    split_path(file_name, pkg_name, base_name); 
     PkgId pkg_id = (PkgIdMgr::getPkgIdMgr()->insertPkg(pkg_name));
-    FileId cur_id = file_count_++;
-    name_vs_fileId_[base_name] = cur_id;
+    file_count_++;
     SCA::File* file=NULL;
     if(file_type == SCA::File::kSource) { 
       file = new SCA::SourceFile(SCA_PKG(pkg_id), base_name, cur_id);
@@ -47,7 +96,7 @@ FileIdMgr::insertFile(std::string file_name) {
     }
     files_.push_back(file);
   } 
-  return name_vs_fileId_[base_name];
+  return cur_id;
 }
 
 //==============================================================================
@@ -56,27 +105,23 @@ FileIdMgr::insertFile(std::string file_name) {
 ///      \brief   Get FileId from the file name
 //==============================================================================
 FileId 
-FileIdMgr::getFileId(std::string file_name) {
+FileIdMgr::getFileId(const std::string &file_name) {
   SCA::File::FileType file_type = getType(file_name);
   if(!(file_type == SCA::File::kSource || file_type == SCA::File::kHeader)) {
     return INVALID_FILE_ID;
   }
-  // Split up the path in to pkg name and base name
-  std::string base_name;
-  std::string pkg_name;
-  split_path(file_name, pkg_name, base_name); 
-  return ((name_vs_fileId_.count(base_name) != 0) ? name_vs_fileId_[base_name] : INVALID_FILE_ID);
+  return paths_.find(file_name);
 }
 
 //==============================================================================
 ///      \class   FileIdMgr
 ///      \method  getFileName
-///      \brief   Get the file name from the id
+///      \brief   Get the full path of the file from the id
 //==============================================================================
 const char* 
 FileIdMgr::getFileName(FileId id) {
   assert(id < file_count_);
-  return files_[id]->get_full_name().c_str();
+  return paths_.name(id);
 }
 
 //==============================================================================
@@ -118,7 +163,7 @@ PkgId PkgIdMgr::getPkgId(std::string &pkg_name) {
 //==============================================================================
 const char* PkgIdMgr::getPkgName(PkgId id) {
   assert(id < pkg_count_);
-  return packages_[id]->name().c_str();
+  return packages_[id]->name();
 }
 
 //==============================================================================
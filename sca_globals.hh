@@ -20,11 +20,20 @@
  *
  *      Includes
  */
+#include <pthread.h>
+#include <sys/stat.h>
 #include "sca_int.hh"
 #include "sca_utils.hh"
+#include "sca_writer.hh"
+#include "sca_callgraph.hh"
+#include "sca_includes.hh"
+#include "sca_packages.hh"
 
 #define SCA_GET_WRITE_PTR() \
   (SCA_globals::getGlobals()->get_write_descriptor())
+
+#define SCA_GET_WRITER() \
+  (SCA_globals::getGlobals()->writer())
  
 #define SCA_GETFILEFROMID(sourceId) \
    (SourceIdConvertor::getFileIdFromSourceId(sourceId))
@@ -50,6 +59,36 @@
 #define SCA_PKGEXIST(str) \
   (PkgIdMgr::getPkgIdMgr()->getPkgId(str) != INVALID_PKG_ID)
 
+// ============================================================================
+///        \class  FileUniqueKey
+///        \brief  clang_getFileUniqueID of a file, usable as a map key
+// ============================================================================
+class FileUniqueKey {
+  public:
+    FileUniqueKey(const CXFileUniqueID &id) {
+      data_[0] = id.data[0];
+      data_[1] = id.data[1];
+      data_[2] = id.data[2];
+    }
+    /// Same key from stat(), as libclang makes it i.e device, inode and
+    ///  modification time
+    FileUniqueKey(const struct stat &st) {
+      data_[0] = st.st_dev;
+      data_[1] = st.st_ino;
+      data_[2] = st.st_mtime;
+    }
+    bool operator<(const FileUniqueKey &rhs) const {
+      for(int i=0; i<3; i++) {
+        if(data_[i] != rhs.data_[i]) {
+          return data_[i] < rhs.data_[i];
+        }
+      }
+      return false;
+    }
+  private:
+    ULL data_[3];
+};
+
 // ============================================================================
 ///        \class  SCA_globals
 ///        \brief  Holds all the global vars used by SCA during file parsing
@@ -74,14 +113,77 @@ class SCA_globals {
     void clear(void) {
       class_hash_.clear();
       function_hash_.clear();
+      call_graph_.clear();
+      include_graph_.clear();
+      package_graph_.clear();
+      analyzed_files_.clear();
+      streamed_funcs_.clear();
+      streamed_classes_.clear();
+      ingested_inputs_.clear();
+      sqlite_path_.clear();
+      shard_dir_.clear();
+      // The whole tree goes at once
+      obj_arena_.release();
+      name_pool_.clear();
+      writer_.set_file(NULL);
       if(fp_) {
         fclose(fp_);
+        fp_ = NULL;
       }
     }
+    /// Whether the SCA_STATS counters are collected
+    bool stats_enabled(void) const { return stats_enabled_; }
+    void set_stats_enabled(bool enabled) {
+      stats_enabled_ = enabled;
+    }
+    /// The counters
+    SCA::Stats& stats(void) { return stats_; }
+    /// Whether an earlier TU of the session walked the file
+    bool isFileAnalyzed(FileId id) const {
+      return analyzed_files_.count(id) != 0;
+    }
+    /// Mark the file as walked
+    void markFileAnalyzed(FileId id) {
+      analyzed_files_.insert(id);
+    }
+    /// Mark the class or function as written by the streaming output.
+    ///  Returns false if it already was
+    bool markStreamed(SCA::Obj::ObjType type, const SourceId &id) {
+      std::set<ULL> &ids = (type == SCA::Obj::kClass) ? streamed_classes_ : streamed_funcs_;
+      return ids.insert(id.key()).second;
+    }
+    /// Whether the class or function was written by the streaming output
+    bool isStreamed(SCA::Obj::ObjType type, const SourceId &id) const {
+      const std::set<ULL> &ids = (type == SCA::Obj::kClass) ? streamed_classes_ : streamed_funcs_;
+      return ids.count(id.key()) != 0;
+    }
+    /// Dump only the files in "ids" and the methods defined in them, or
+    ///  the whole tree if NULL
+    void set_dump_filter(const std::set<FileId> *ids) {
+      dump_filter_ = ids;
+    }
+    bool isDumped(FileId id) const {
+      return NULL == dump_filter_ || dump_filter_->count(id) != 0;
+    }
+    /// Mark an input file as merged in to the tree. Returns false if it
+    ///  already was
+    bool markIngested(const FileUniqueKey &key) {
+      return ingested_inputs_.insert(key).second;
+    }
+    /// The arena that owns all the objects of the tree
+    SCA::Arena& obj_arena(void) { return obj_arena_; }
+    /// The names of the objects of the tree
+    StringTable& name_pool(void) { return name_pool_; }
      /// Class hash accesssor
     DoubleHash<SCA::Class>& class_hash(void) { return class_hash_; }
     /// Function hash accessor
     DoubleHash<SCA::Function>& function_hash(void) { return function_hash_; }
+    /// The calls between the functions, built by the analyzer
+    SCA::CallGraph& call_graph(void) { return call_graph_; }
+    /// Include graph of the build, built by the analyzer
+    SCA::IncludeGraph& include_graph(void) { return include_graph_; }
+    /// Dependencies between the packages, built by the analyzer
+    SCA::PackageGraph& package_graph(void) { return package_graph_; }
     /// Set the cwd
     void set_cwd(std::string cwd) {
       cwd_ = cwd;
@@ -92,10 +194,34 @@ class SCA_globals {
     }
     void set_write_descriptor(FILE *fp) {
       fp_ = fp;
+      writer_.set_file(fp);
     }
     FILE* get_write_descriptor(void) const {
       return fp_;
     }
+    /// Buffers the output written to the write descriptor
+    SCA::Writer& writer(void) { return writer_; }
+    /// Database the tree is also exported to. Empty if none
+    const std::string& sqlite_path(void) const { return sqlite_path_; }
+    void set_sqlite_path(const std::string &path) {
+      sqlite_path_ = path;
+    }
+    /// Directory of the shards i.e the -o of --sca-format=shards
+    const std::string& shard_dir(void) const { return shard_dir_; }
+    void set_shard_dir(const std::string &dir) {
+      shard_dir_ = dir;
+    }
+    /// Canonical path of the file. realpath() is done once per file per
+    ///  process, whatever the spelling of the path in the TUs. Thread safe
+    std::string realPath(CXFile file);
+    /// Lock the global tree. All the updates from worker threads must hold it
+    void lock(void) {
+      pthread_mutex_lock(&lock_);
+    }
+    /// Unlock the global tree
+    void unlock(void) {
+      pthread_mutex_unlock(&lock_);
+    }
     // Static instance
     static SCA_globals* instance_;
   private:
@@ -103,6 +229,10 @@ class SCA_globals {
     SCA_globals() {
       fp_             = NULL;
       parse_id_       = INVALID_FILE_ID;
+      stats_enabled_  = false;
+      dump_filter_    = NULL;
+      pthread_mutex_init(&lock_, NULL);
+      pthread_mutex_init(&paths_lock_, NULL);
     }
     /// File being parsed currently
     FileId parse_id_;
@@ -110,10 +240,45 @@ class SCA_globals {
     DoubleHash<SCA::Class> class_hash_;
     ///Double hash for function
     DoubleHash<SCA::Function> function_hash_;
+    /// Call graph of the functions of function_hash_
+    SCA::CallGraph call_graph_;
+    /// Include graph of the files of FileIdMgr
+    SCA::IncludeGraph include_graph_;
+    /// Dependencies between the packages of PkgIdMgr
+    SCA::PackageGraph package_graph_;
     /// The current working directory
     std::string cwd_;
     /// The file pointer for the writing .o
     FILE *fp_;
+    /// The dump routines write through it
+    SCA::Writer writer_;
+    /// --sca-sqlite=FILE
+    std::string sqlite_path_;
+    /// -o with --sca-format=shards
+    std::string shard_dir_;
+    /// Counters dumped when SCA_STATS is set
+    SCA::Stats stats_;
+    bool stats_enabled_;
+    /// Files that were walked by the TUs done so far
+    std::set<FileId> analyzed_files_;
+    /// Files being dumped, NULL for all
+    const std::set<FileId> *dump_filter_;
+    /// Functions/methods and classes written by the streaming output
+    std::set<ULL> streamed_funcs_;
+    std::set<ULL> streamed_classes_;
+    /// Inputs merged in to the tree
+    std::set<FileUniqueKey> ingested_inputs_;
+    /// Owns the objects of the tree
+    SCA::Arena obj_arena_;
+    /// Owns the names of the objects
+    StringTable name_pool_;
+    /// Canonical paths keyed on the unique id of the file. It is not a
+    /// part of the tree, clear() keeps it
+    std::map<FileUniqueKey, std::string> real_paths_;
+    /// Protects real_paths_. realPath() is called without the lock_ too
+    pthread_mutex_t paths_lock_;
+    /// Protects the global tree when TUs are parsed in parallel
+    pthread_mutex_t lock_;
 };
 
 // ============================================================================
@@ -135,8 +300,8 @@ class FileIdMgr {
     ///  if needed
     FileId insertFile(std::string file_name);
     /// Get the fileId assocaited with the "file_name"
-    FileId getFileId(std::string file_name);
-    /// Get the file name from the FIleId
+    FileId getFileId(const std::string &file_name);
+    /// Get the full path of the file from the FIleId
     const char* getFileName(FileId id);
     /// Get the actual SCA::File from the fileId
     SCA::File* getFile(FileId id);
@@ -144,9 +309,7 @@ class FileIdMgr {
     FileId cFiles(void) const { return file_count_; }
     /// Clear all the contents
     void clear(void) {
-      for(unsigned int i=0; i<file_count_; i++) {
-        delete files_[i];
-      }
+      // The files are owned by the object arena
       delete instance_;
       instance_ = NULL;
     }
@@ -159,8 +322,8 @@ class FileIdMgr {
     FileIdMgr(void) {
       file_count_ = 0;
     }
-    /// Map of <file_name, FileId> 
-    std::map<std::string, FileId> name_vs_fileId_;
+    /// Full path of the files. The id of the path is the FileId
+    StringTable paths_;
     /// Array of SCA::File indexed with FileId
     std::vector<SCA::File*> files_;
     /// Total file count
@@ -194,9 +357,7 @@ class PkgIdMgr {
     PkgId cPkgs(void) const { return pkg_count_; }
     /// Clear all the contents
     void clear(void) {
-      for(unsigned int i=0; i<pkg_count_; i++) {
-        delete packages_[i];
-      }
+      // The packages are owned by the object arena
       delete instance_;
       instance_ = NULL;
     }
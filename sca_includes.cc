@@ -0,0 +1,270 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_includes.cc
+ *
+ *  \brief
+ *      Implementation of the include graph
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 19:10:05 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <algorithm>
+#include "sca_includes.hh"
+
+using namespace SCA;
+
+/// Low link of a file whose component is done, i.e it is off the stack
+#define SCC_DONE ((U)-1)
+
+/// A file on the walk and the position of the next of its includes to look
+/// at in the targets
+struct IncludeFrame {
+  U node_;
+  U next_;
+};
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method
+///      \brief   Constructor
+//==============================================================================
+IncludeGraph::IncludeGraph(void) {
+  num_bytes_  = 0;
+  num_cycles_ = 0;
+}
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method  clear
+///      \brief   Gives the memory back
+//==============================================================================
+void IncludeGraph::clear(void) {
+  std::vector<File*>().swap(nodes_);
+  std::vector<U>().swap(offsets_);
+  std::vector<U>().swap(targets_);
+  std::vector<U>().swap(columns_);
+  std::vector<U>().swap(headers_);
+  std::vector<U>().swap(components_);
+  std::vector<U>().swap(member_offsets_);
+  std::vector<U>().swap(members_);
+  std::vector<U>().swap(dag_offsets_);
+  std::vector<U>().swap(dag_targets_);
+  std::vector<ULL>().swap(closures_);
+  num_bytes_  = 0;
+  num_cycles_ = 0;
+}
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method  build
+///      \brief   Only the files included by some file get a bit, so a
+//                source costs nothing in the closures. A source is a TU and
+//                counts for itself and for what it includes
+//==============================================================================
+void IncludeGraph::build(const std::vector<File*> &files) {
+  clear();
+  U num_nodes = files.size();
+  nodes_ = files;
+  // The includes are FileIds, which need not be the position of the file
+  FileId max_id = 0;
+  for(U i=0; i<num_nodes; i++) {
+    max_id = std::max(max_id, nodes_[i]->id());
+  }
+  std::vector<U> node_of(num_nodes ? max_id + 1 : 0, (U)-1);
+  for(U i=0; i<num_nodes; i++) {
+    node_of[nodes_[i]->id()] = i;
+  }
+  offsets_.resize(num_nodes + 1);
+  columns_.resize(num_nodes, (U)-1);
+  for(U i=0; i<num_nodes; i++) {
+    offsets_[i] = targets_.size();
+    const ArenaVector<FileId> &includes = nodes_[i]->direct_includes();
+    for(size_t k=0; k<includes.size(); k++) {
+      U target = (includes[k] < node_of.size()) ? node_of[includes[k]] : (U)-1;
+      if(target == (U)-1) {
+        continue;
+      }
+      targets_.push_back(target);
+      if(columns_[target] == (U)-1) {
+        columns_[target] = headers_.size();
+        headers_.push_back(target);
+      }
+    }
+  }
+  offsets_[num_nodes] = targets_.size();
+  find_components();
+  build_dag();
+  U num_components = member_offsets_.size() - 1;
+  std::vector<U> num_tus(headers_.size(), 0);
+  std::vector<ULL> closure_bytes(num_components, 0);
+  std::vector<ULL> closure_lines(num_components, 0);
+  for(U first=0; first<headers_.size(); first+=kIncludeBlockBits) {
+    U num_bits = std::min((U)kIncludeBlockBits, (U)headers_.size() - first);
+    close_block(first, num_bits, num_tus, closure_bytes, closure_lines);
+  }
+  num_bytes_ = nodes_.capacity() * sizeof(File*) + offsets_.capacity() * sizeof(U) +
+               targets_.capacity() * sizeof(U) + columns_.capacity() * sizeof(U) +
+               headers_.capacity() * sizeof(U) + components_.capacity() * sizeof(U) +
+               member_offsets_.capacity() * sizeof(U) + members_.capacity() * sizeof(U) +
+               dag_offsets_.capacity() * sizeof(U) + dag_targets_.capacity() * sizeof(U) +
+               closures_.capacity() * sizeof(ULL);
+  std::vector<ULL>().swap(closures_);
+  for(U i=0; i<num_nodes; i++) {
+    File *file = nodes_[i];
+    ULL bytes = closure_bytes[components_[i]];
+    ULL lines = closure_lines[components_[i]];
+    if(columns_[i] != (U)-1) {
+      // In its own closure
+      file->set_num_tus(num_tus[columns_[i]]);
+    } else {
+      file->set_num_tus(file->type() == Obj::kSourceFile ? 1 : 0);
+      bytes += file->num_bytes();
+      lines += file->num_lines();
+    }
+    file->set_closure(bytes, lines);
+  }
+}
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method  find_components
+///      \brief   Tarjan's algorithm with the recursion on an explicit stack,
+//                same as the call graph. When a component is done, so are
+//                the components of everything it includes. O(files +
+//                includes)
+//==============================================================================
+void IncludeGraph::find_components(void) {
+  U num_nodes = nodes_.size();
+  std::vector<U> index(num_nodes, 0);
+  std::vector<U> low(num_nodes, 0);
+  std::vector<U> stack_members;
+  std::vector<IncludeFrame> stack;
+  U counter = 0;
+  components_.assign(num_nodes, (U)-1);
+  members_.reserve(num_nodes);
+  member_offsets_.push_back(0);
+  for(U root=0; root<num_nodes; root++) {
+    if(index[root]) {
+      continue;
+    }
+    index[root] = low[root] = ++counter;
+    stack_members.push_back(root);
+    IncludeFrame first = { root, offsets_[root] };
+    stack.push_back(first);
+    while(!stack.empty()) {
+      IncludeFrame &top = stack.back();
+      U node = top.node_;
+      if(top.next_ < offsets_[node + 1]) {
+        U included = targets_[top.next_++];
+        if(0 == index[included]) {
+          index[included] = low[included] = ++counter;
+          stack_members.push_back(included);
+          IncludeFrame frame = { included, offsets_[included] };
+          stack.push_back(frame);
+        } else if(low[included] != SCC_DONE && index[included] < low[node]) {
+          // Still on the member stack, i.e in the component being built
+          low[node] = index[included];
+        }
+        continue;
+      }
+      stack.pop_back();
+      if(low[node] != index[node]) {
+        U includer = stack.back().node_;
+        if(low[node] < low[includer]) {
+          low[includer] = low[node];
+        }
+        continue;
+      }
+      size_t start = stack_members.size() - 1;
+      while(stack_members[start] != node) {
+        start--;
+      }
+      U component = member_offsets_.size() - 1;
+      for(size_t i=start; i<stack_members.size(); i++) {
+        low[stack_members[i]] = SCC_DONE;
+        components_[stack_members[i]] = component;
+        members_.push_back(stack_members[i]);
+      }
+      member_offsets_.push_back(members_.size());
+      if(stack_members.size() - start > 1) {
+        num_cycles_++;
+      }
+      stack_members.resize(start);
+    }
+  }
+}
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method  build_dag
+///      \brief   A component includes only components done before it
+//==============================================================================
+void IncludeGraph::build_dag(void) {
+  U num_components = member_offsets_.size() - 1;
+  std::vector<U> seen(num_components, (U)-1);
+  dag_offsets_.resize(num_components + 1);
+  for(U c=0; c<num_components; c++) {
+    dag_offsets_[c] = dag_targets_.size();
+    for(U m=member_offsets_[c]; m<member_offsets_[c + 1]; m++) {
+      for(U e=offsets_[members_[m]]; e<offsets_[members_[m] + 1]; e++) {
+        U target = components_[targets_[e]];
+        if(target != c && seen[target] != c) {
+          seen[target] = c;
+          dag_targets_.push_back(target);
+        }
+      }
+    }
+  }
+  dag_offsets_[num_components] = dag_targets_.size();
+}
+
+//==============================================================================
+///      \class   IncludeGraph
+///      \method  close_block
+///      \brief   In the order of the components, a word at a time. The bits
+//                set in the closure of a source are the headers of its TU
+//==============================================================================
+void IncludeGraph::close_block(U first, U num_bits, std::vector<U> &num_tus,
+                               std::vector<ULL> &closure_bytes,
+                               std::vector<ULL> &closure_lines) {
+  U num_components = member_offsets_.size() - 1;
+  U num_words = (num_bits + 63) / 64;
+  closures_.assign((size_t)num_components * num_words, 0);
+  for(U c=0; c<num_components; c++) {
+    ULL *closure = &closures_[(size_t)c * num_words];
+    for(U m=member_offsets_[c]; m<member_offsets_[c + 1]; m++) {
+      U bit = columns_[members_[m]] - first;
+      if(columns_[members_[m]] != (U)-1 && bit < num_bits) {
+        closure[bit >> 6] |= 1ULL << (bit & 63);
+      }
+    }
+    for(U e=dag_offsets_[c]; e<dag_offsets_[c + 1]; e++) {
+      const ULL *included = &closures_[(size_t)dag_targets_[e] * num_words];
+      for(U w=0; w<num_words; w++) {
+        closure[w] |= included[w];
+      }
+    }
+    for(U w=0; w<num_words; w++) {
+      for(ULL bits=closure[w]; bits; bits &= bits - 1) {
+        const File *header = nodes_[headers_[first + (w << 6) + lowest_bit(bits)]];
+        closure_bytes[c] += header->num_bytes();
+        closure_lines[c] += header->num_lines();
+      }
+    }
+  }
+  for(U i=0; i<nodes_.size(); i++) {
+    if(nodes_[i]->type() != Obj::kSourceFile) {
+      continue;
+    }
+    const ULL *closure = &closures_[(size_t)components_[i] * num_words];
+    for(U w=0; w<num_words; w++) {
+      for(ULL bits=closure[w]; bits; bits &= bits - 1) {
+        num_tus[first + (w << 6) + lowest_bit(bits)]++;
+      }
+    }
+  }
+}
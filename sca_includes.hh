@@ -0,0 +1,107 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_includes.hh
+ *
+ *  \brief
+ *      Include graph of the whole build
+ *
+ *  \details
+ *      Every TU records the #include directives it sees as the direct
+ *      includes of the files (see InclusionDirective_visitor). A header is
+ *      included the same way by every TU, so the edges of all the TUs and
+ *      of the merged inputs add up to the include graph of the build.
+ *
+ *      The transitive closure of every file is a bitset with one bit per
+ *      file that some file includes (the headers). Files that include each
+ *      other (a cycle, cut short by the include guards) share a closure, so
+ *      the graph is first reduced to its strongly connected components with
+ *      Tarjan's algorithm. It numbers a component only once everything it
+ *      includes is numbered, so in that order the closure of a component is
+ *      its own bits ORed with the closures of the components it includes.
+ *      All the closures at once would take files * headers / 8 bytes (i.e
+ *      900 MB for 100000 files), so they are built kIncludeBlockBits
+ *      headers at a time and only the counts are kept.
+ *
+ *      From the closures of the sources, which are the TUs, every file
+ *      gets the number of TUs it is part of, and with its size what it adds
+ *      to the preprocessed sources of the build. Every file also gets its
+ *      size along with all it includes. Files SCA does not track (i.e
+ *      <vector>) are not in the graph, so neither is their size. Only the
+ *      #includes of them are counted, see File::external_includes().
+ *
+ *  \history
+ *      10/18/26 19:02:37 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_INCLUDES_H
+#define SCA_INCLUDES_H
+
+#include <vector>
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+/// Headers whose closure bits are built at a time, see IncludeGraph
+#define kIncludeBlockBits 4096
+
+namespace SCA {
+
+// ============================================================================
+///        \class  IncludeGraph
+///        \brief  The #include edges of all the files of the tree and their
+//                 transitive closures
+// ============================================================================
+class IncludeGraph {
+  public:
+    /// Ctor
+    IncludeGraph(void);
+    /// Build the graph of "files" and set their TU count and closure size
+    void build(const std::vector<File*> &files);
+    /// Drop the graph
+    void clear(void);
+    /// Number of files
+    U num_nodes(void) const { return nodes_.size(); }
+    /// Number of #include edges
+    ULL num_edges(void) const { return targets_.size(); }
+    /// Number of files included by some file, i.e the bits of a closure
+    U num_headers(void) const { return headers_.size(); }
+    /// Number of include cycles
+    U num_cycles(void) const { return num_cycles_; }
+    /// Bytes held by the graph, with the closures of one block
+    size_t num_bytes(void) const { return num_bytes_; }
+
+  private:
+    /// Tarjan's strongly connected components, numbered in the order they
+    ///  are done
+    void find_components(void);
+    /// The includes between the components, without the duplicates
+    void build_dag(void);
+    /// The closures of the headers [first, first + num_bits), counted in to
+    ///  the TUs of the headers and the closure size of the components
+    void close_block(U first, U num_bits, std::vector<U> &num_tus,
+                     std::vector<ULL> &closure_bytes, std::vector<ULL> &closure_lines);
+    /// The files, in the order they came
+    std::vector<File*> nodes_;
+    /// Compressed sparse row of the direct includes
+    std::vector<U> offsets_;
+    std::vector<U> targets_;
+    /// Bit of a node in the closures, (U)-1 if no file includes it, and
+    ///  the node of a bit
+    std::vector<U> columns_;
+    std::vector<U> headers_;
+    /// Component of a node. The nodes of component c are
+    ///  members_[member_offsets_[c] .. member_offsets_[c + 1])
+    std::vector<U> components_;
+    std::vector<U> member_offsets_;
+    std::vector<U> members_;
+    /// Compressed sparse row of the components a component includes
+    std::vector<U> dag_offsets_;
+    std::vector<U> dag_targets_;
+    /// The closures of a block, one row of words per component
+    std::vector<ULL> closures_;
+    size_t num_bytes_;
+    U num_cycles_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_INCLUDES_H */
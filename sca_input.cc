@@ -0,0 +1,260 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_input.cc
+ *
+ *  \brief
+ *      Implementation of the merge of the result files
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 15:10:21 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sca_input.hh"
+#include "sca_binary.hh"
+#include "sca_globals.hh"
+#include "sca_json_reader.hh"
+#include "sca_workqueue.hh"
+
+using namespace SCA;
+
+/// Bytes looked at to tell the format. Enough for the binary magic and the
+/// leading blanks of an indented JSON
+#define SCA_SNIFF_SIZE 64
+
+/// Format of a result file
+enum InputFormat {
+  kInputUnknown,
+  kInputJson,
+  kInputBinary,
+  kInputArchive
+};
+
+//==============================================================================
+///      \brief Format from the first bytes of a file
+//==============================================================================
+static InputFormat sniff(const char *head, size_t len) {
+  if(isBinaryHeader(head, len)) {
+    return kInputBinary;
+  }
+  if(isJsonHeader(head, len)) {
+    return kInputJson;
+  }
+  if(isArchiveHeader(head, len)) {
+    return kInputArchive;
+  }
+  return kInputUnknown;
+}
+
+//==============================================================================
+///      \brief Format from the first bytes of an open file
+//==============================================================================
+static InputFormat sniff_fd(int fd) {
+  char head[SCA_SNIFF_SIZE];
+  ssize_t len = pread(fd, head, sizeof(head), 0);
+  if(len <= 0) {
+    return kInputUnknown;
+  }
+  return sniff(head, len);
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method
+///      \brief   Constructor
+//==============================================================================
+InputMerger::InputMerger(void) {
+  next_turn_ = 0;
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&turn_, NULL);
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method
+///      \brief   Destructor
+//==============================================================================
+InputMerger::~InputMerger() {
+  for(size_t i=0; i<archives_.size(); i++) {
+    delete archives_[i];
+  }
+  pthread_cond_destroy(&turn_);
+  pthread_mutex_destroy(&lock_);
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  add
+///      \brief   The file is opened once to tell its format and its
+//                identity. It is read in full by run()
+//==============================================================================
+bool InputMerger::add(const std::string &file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+  struct stat st;
+  InputFormat format = kInputUnknown;
+  if(fstat(fd, &st) == 0) {
+    format = sniff_fd(fd);
+  }
+  close(fd);
+  if(format == kInputUnknown) {
+    return false;
+  }
+  if(!SCA_globals::getGlobals()->markIngested(FileUniqueKey(st))) {
+    // Queued already
+    return true;
+  }
+  if(format == kInputArchive) {
+    add_archive(file_name);
+    return true;
+  }
+  Input input;
+  input.path_   = file_name;
+  input.binary_ = (format == kInputBinary);
+  input.size_   = st.st_size;
+  input.data_   = NULL;
+  inputs_.push_back(input);
+  return true;
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  add_archive
+///      \brief   Members that are not results of SCA (i.e real objects) are
+//                skipped. The archive stays mapped till the merge is done
+//==============================================================================
+void InputMerger::add_archive(const std::string &file_name) {
+  ArchiveReader *archive = new ArchiveReader();
+  if(!archive->open(file_name)) {
+    delete archive;
+    return;
+  }
+  ArchiveMember member;
+  size_t num_inputs = inputs_.size();
+  while(archive->next(member)) {
+    size_t head_len = (member.size_ < SCA_SNIFF_SIZE) ? member.size_ : SCA_SNIFF_SIZE;
+    InputFormat format = sniff(member.data_, head_len);
+    if(format != kInputJson && format != kInputBinary) {
+      continue;
+    }
+    Input input;
+    input.path_   = file_name + "(" + member.name_ + ")";
+    input.binary_ = (format == kInputBinary);
+    input.size_   = member.size_;
+    input.data_   = member.data_;
+    inputs_.push_back(input);
+  }
+  if(inputs_.size() == num_inputs) {
+    delete archive;
+  } else {
+    archives_.push_back(archive);
+  }
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  wait_turn
+///      \brief   The queue hands the items out in order, so the files before
+//                "item" are all being read already and the wait is bounded
+//==============================================================================
+void InputMerger::wait_turn(size_t item) {
+  pthread_mutex_lock(&lock_);
+  while(next_turn_ != item) {
+    pthread_cond_wait(&turn_, &lock_);
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  end_turn
+///      \brief   Wake up the waiter of the next file. The times of the file
+//                are added while it is still its turn
+//==============================================================================
+void InputMerger::end_turn(double read_time, double splice_time) {
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  stats.merge_read_time_   += read_time;
+  stats.merge_splice_time_ += splice_time;
+  pthread_mutex_lock(&lock_);
+  next_turn_++;
+  pthread_cond_broadcast(&turn_);
+  pthread_mutex_unlock(&lock_);
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  merge_one
+///      \brief   Read the file in to objects of its own, then splice them in
+//                to the tree in its turn
+//==============================================================================
+void InputMerger::merge_one(void *user_data, size_t item, int worker) {
+  InputMerger *merger = static_cast<InputMerger*>(user_data);
+  Input &input = merger->inputs_[item];
+  double start = sca_time_now();
+  if(input.binary_) {
+    SCA::BinaryReader reader;
+    bool ok = input.data_ ? reader.open(input.data_, input.size_, input.path_) :
+                            reader.open(input.path_);
+    double read_time = sca_time_now() - start;
+    merger->wait_turn(item);
+    double splice_start = sca_time_now();
+    if(ok) {
+      reader.load();
+    }
+    merger->end_turn(read_time, sca_time_now() - splice_start);
+  } else {
+    JsonPartial partial;
+    JsonParser parser;
+    int ret = input.data_ ? parser.record(input.data_, input.size_, partial) :
+                            parser.record(input.path_, partial);
+    bool ok = (ret == JsonParser::kSuccess);
+    JsonStage objects;
+    if(ok) {
+      parser.stage(partial, objects);
+    } else {
+      fprintf(stderr, "sca: %s is not a valid SCA JSON file\n", input.path_.c_str());
+    }
+    double read_time = sca_time_now() - start;
+    merger->wait_turn(item);
+    double splice_start = sca_time_now();
+    if(ok) {
+      objects.splice();
+      SCA_globals::getGlobals()->stats().merged_tokens_ += parser.num_tokens();
+    }
+    merger->end_turn(read_time, sca_time_now() - splice_start);
+  }
+}
+
+//==============================================================================
+///      \class   InputMerger
+///      \method  run
+///      \brief   Nothing else runs while the files are merged, so the tree
+//                is updated without the global lock
+//==============================================================================
+void InputMerger::run(int num_workers) {
+  if(inputs_.empty()) {
+    return;
+  }
+  double start = sca_time_now();
+  next_turn_ = 0;
+  WorkQueue queue(inputs_.size(), num_workers);
+  queue.run(merge_one, this);
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  stats.merged_inputs_ += inputs_.size();
+  for(size_t i=0; i<inputs_.size(); i++) {
+    stats.merged_bytes_ += inputs_[i].size_;
+  }
+  stats.merge_time_ += sca_time_now() - start;
+  inputs_.clear();
+  for(size_t i=0; i<archives_.size(); i++) {
+    delete archives_[i];
+  }
+  archives_.clear();
+}
@@ -0,0 +1,88 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_input.hh
+ *
+ *  \brief
+ *      Merge of the results of earlier runs passed as inputs
+ *
+ *  \details
+ *      At the link step the per TU results come back as the object files.
+ *      The format of such a file is told from its first bytes only, and the
+ *      file is then read once by the reader of that format. A file that was
+ *      already merged (same device, inode and modification time, whatever
+ *      the spelling of its path) is skipped, so passing it twice or through
+ *      a symlink does not cost a second read.
+ *
+ *      The members of an archive (a static library of result files) are
+ *      read in place from the mapping of the archive, like loose files.
+ *
+ *      The files are read on a pool of threads. A JSON file is parsed in to
+ *      a JsonPartial and made in to a JsonStage, objects of its own with
+ *      local ids, and a binary file is mapped and validated, none of which
+ *      touches the tree. The results are then spliced in to the tree one at
+ *      a time in the order of the command line, so the tree does not depend
+ *      on the number of threads. A file is added as soon as the ones before
+ *      it are, while the threads go on reading the later files.
+ *
+ *  \history
+ *      10/18/26 15:02:44 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_INPUT_H
+#define SCA_INPUT_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "sca_int.hh"
+#include "sca_archive.hh"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  InputMerger
+///        \brief  Merges the result files in to the tree
+// ============================================================================
+class InputMerger {
+  public:
+    /// Ctor
+    InputMerger(void);
+    /// Dtor
+    ~InputMerger();
+    /// Queue the file if it is a result of SCA. Returns false if it is not
+    bool add(const std::string &file_name);
+    /// Merge the queued files using "num_workers" threads
+    void run(int num_workers);
+
+  private:
+    /// A queued file or archive member
+    struct Input {
+      /// The file, or "archive(member)"
+      std::string path_;
+      bool binary_;
+      ULL size_;
+      /// The member in the mapping of its archive. NULL for a file
+      const char *data_;
+    };
+    /// Queue the members of the archive that are results of SCA
+    void add_archive(const std::string &file_name);
+    /// Work function of the queue
+    static void merge_one(void *user_data, size_t item, int worker);
+    /// Wait for the files before "item" to be added to the tree
+    void wait_turn(size_t item);
+    /// Let the next file be added. The seconds the file took to read and
+    ///  to add go in to the stats
+    void end_turn(double read_time, double splice_time);
+    /// The queued files
+    std::vector<Input> inputs_;
+    /// The archives the queued members are in
+    std::vector<ArchiveReader*> archives_;
+    /// Index of the next file to be added to the tree
+    size_t next_turn_;
+    pthread_mutex_t lock_;
+    pthread_cond_t turn_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_INPUT_H */
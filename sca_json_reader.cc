@@ -12,80 +12,743 @@
  *      07/23/14 22:45:57 PDT Created By Prakash S
  *
  *  ----------------------------------------------------------*/
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <string>
 #include <string.h>
 #include <stdio.h>
-#include <json.h>
 #include "sca_json_reader.hh"
 
-CurParseObj JsonParser::cur_context_;
-std::stack<SCA::Obj*> JsonParser::obj_stack_;
-
-int JsonParser::sca_callback(void *userdata, 
-                            int type, 
-                            const char *data, 
-                            uint32_t length) { 
-//  FILE *output = (FILE*)((userdata) ? userdata : stdout);
-  FILE *output = stdout;
-  char value[1024];
-  switch (type) {
-    case JSON_OBJECT_BEGIN:
-      //printf("Begin object: %s\n", data);
-      break;
-    case JSON_OBJECT_END:
-      //printf("Ending object: %s\n", data);
-      break;
-    case JSON_ARRAY_BEGIN: {
-      //printf("Begin array : %s\n", data);
-      if(cur_context_.cur_obj_) {
-        obj_stack_.push(cur_context_.cur_obj_);
+//==============================================================================
+///      \class   StrView
+///      \method  to_int
+///      \brief   Optional sign followed by digits, the rest is ignored
+//==============================================================================
+int StrView::to_int(void) const {
+  size_t i = 0;
+  bool negative = false;
+  if(i < len_ && (ptr_[i] == '-' || ptr_[i] == '+')) {
+    negative = (ptr_[i] == '-');
+    i++;
+  }
+  int val = 0;
+  for(; i < len_ && ptr_[i] >= '0' && ptr_[i] <= '9'; i++) {
+    val = val * 10 + (ptr_[i] - '0');
+  }
+  return negative ? -val : val;
+}
+
+//==============================================================================
+///      \class   StrView
+///      \method  to_hex
+///      \brief   Lower or upper case digits, no 0x
+//==============================================================================
+ULL StrView::to_hex(size_t &end) const {
+  ULL val = 0;
+  size_t i = 0;
+  for(; i < len_; i++) {
+    char c = ptr_[i];
+    if(c >= '0' && c <= '9') {
+      val = (val << 4) | (c - '0');
+    } else if(c >= 'a' && c <= 'f') {
+      val = (val << 4) | (c - 'a' + 10);
+    } else if(c >= 'A' && c <= 'F') {
+      val = (val << 4) | (c - 'A' + 10);
+    } else {
+      break;
+    }
+  }
+  end = i;
+  return val;
+}
+
+//==============================================================================
+///      \brief The callees of a "hash hash ..." value, added sorted and unique
+//              at the end of "callees". Returns how many
+//==============================================================================
+static U parse_callees(const StrView &value, std::vector<ULL> &callees) {
+  size_t first = callees.size();
+  StrView rest = value;
+  while(rest.len_) {
+    if(*rest.ptr_ == ' ') {
+      rest.ptr_++;
+      rest.len_--;
+      continue;
+    }
+    size_t end;
+    callees.push_back(rest.to_hex(end));
+    if(0 == end) {
+      break;
+    }
+    rest.ptr_ += end;
+    rest.len_ -= end;
+  }
+  // Written sorted, but a hand made file might not be
+  std::sort(callees.begin() + first, callees.end());
+  callees.erase(std::unique(callees.begin() + first, callees.end()), callees.end());
+  return callees.size() - first;
+}
+
+//==============================================================================
+///      \brief The direct includes of a "path:path:..." value, added as local
+//              ids at the end of the includes of "stage". Returns how many
+//==============================================================================
+static U parse_includes(const StrView &value, JsonStage &stage) {
+  size_t first = stage.includes_.size();
+  const char *cur = value.ptr_;
+  const char *end = value.ptr_ + value.len_;
+  while(cur < end) {
+    const char *colon = static_cast<const char*>(memchr(cur, ':', end - cur));
+    const char *next = colon ? colon : end;
+    if(next > cur) {
+      stage.includes_.push_back(stage.path_id(std::string(cur, next - cur)));
+    }
+    cur = next + 1;
+  }
+  return stage.includes_.size() - first;
+}
+
+//==============================================================================
+///      \class   JsonPartial
+///      \method
+///      \brief   Destructor. Unmaps the file
+//==============================================================================
+JsonPartial::~JsonPartial() {
+  if(map_) {
+    munmap(map_, map_size_);
+  }
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  package_id
+///      \brief   Local id of a package name, the same for every object of
+//                the package
+//==============================================================================
+U JsonStage::package_id(const std::string &name) {
+  std::map<std::string, U>::iterator it = package_ids_.find(name);
+  if(it != package_ids_.end()) {
+    return it->second;
+  }
+  U id = paths_.size();
+  paths_.push_back(Path());
+  paths_.back().name_    = name;
+  paths_.back().package_ = true;
+  package_ids_[name] = id;
+  return id;
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  path_id
+///      \brief   Local id of a file name, the same for every object of the
+//                file
+//==============================================================================
+U JsonStage::path_id(const std::string &name) {
+  std::map<std::string, U>::iterator it = path_ids_.find(name);
+  if(it != path_ids_.end()) {
+    return it->second;
+  }
+  U id = paths_.size();
+  paths_.push_back(Path());
+  paths_.back().name_    = name;
+  paths_.back().package_ = false;
+  path_ids_[name] = id;
+  return id;
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  add_object
+///      \brief   Objects are made in the order of the file, so a parent
+//                always comes before its children
+//==============================================================================
+U JsonStage::add_object(SCA::Obj::ObjType type, U parent, const StrView &name,
+                        U path, LineId line) {
+  Object obj;
+  obj.type_   = type;
+  obj.parent_ = parent;
+  obj.name_   = name;
+  obj.path_   = path;
+  obj.line_   = line;
+  objects_.push_back(obj);
+  return objects_.size() - 1;
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  add_field
+///      \brief   A field with no object before it (a hand made file) is
+//                dropped by splice()
+//==============================================================================
+JsonStage::Field& JsonStage::add_field(U obj, JsonKey key, ULL value) {
+  Field field;
+  field.obj_   = obj;
+  field.key_   = key;
+  field.value_ = value;
+  field.first_ = 0;
+  field.num_   = 0;
+  fields_.push_back(field);
+  return fields_.back();
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  splice
+///      \brief   The names are interned in the order the file has them, so
+//                the ids in the tree are the ones a read straight in to the
+//                tree gives. A class or function another input added
+//                already is updated in place
+//==============================================================================
+void JsonStage::splice(void) const {
+  SCA_globals *globals = SCA_globals::getGlobals();
+  std::vector<U> ids(paths_.size());
+  for(size_t i=0; i<paths_.size(); i++) {
+    if(paths_[i].package_) {
+      std::string name = paths_[i].name_;
+      ids[i] = PkgIdMgr::getPkgIdMgr()->insertPkg(name);
+    } else {
+      ids[i] = FileIdMgr::getFileIdMgr()->insertFile(paths_[i].name_);
+    }
+  }
+  std::vector<SCA::Obj*> objs(objects_.size(), (SCA::Obj*)NULL);
+  for(size_t i=0; i<objects_.size(); i++) {
+    const Object &obj = objects_[i];
+    SCA::Obj *parent = (obj.parent_ == kNone) ? NULL : objs[obj.parent_];
+    switch(obj.type_) {
+      case SCA::Obj::kPackage:
+        objs[i] = PkgIdMgr::getPkgIdMgr()->getPkg(ids[obj.path_]);
+        break;
+      case SCA::Obj::kSourceFile:
+      case SCA::Obj::kHeaderFile:
+        objs[i] = FileIdMgr::getFileIdMgr()->getFile(ids[obj.path_]);
+        break;
+      case SCA::Obj::kClass: {
+        ClassId class_id(ids[obj.path_], obj.line_);
+        SCA::Class *cls = globals->class_hash()[class_id];
+        if(NULL == cls) {
+          cls = new SCA::Class(static_cast<SCA::File*>(parent), obj.name_.str(), class_id);
+          globals->class_hash().insert(class_id, cls);
+        }
+        objs[i] = cls;
+        break;
+      }
+      case SCA::Obj::kFunction: {
+        FuncId func_id(ids[obj.path_], obj.line_);
+        SCA::Function *found = globals->function_hash()[func_id];
+        // A method on the same line is a different object
+        SCA::Function *func = (found && found->type() == SCA::Obj::kFunction) ? found : NULL;
+        if(NULL == func) {
+          func = new SCA::Function(parent, obj.name_.str(), func_id);
+          if(NULL == found) {
+            globals->function_hash().insert(func_id, func);
+          }
+        }
+        objs[i] = func;
+        break;
+      }
+      case SCA::Obj::kMethod: {
+        FuncId method_id(ids[obj.path_], obj.line_);
+        SCA::Function *found = globals->function_hash()[method_id];
+        // A free function on the same line is not a method
+        SCA::Function *method = (found && found->type() == SCA::Obj::kMethod) ? found : NULL;
+        if(NULL == method) {
+          method = new SCA::Method(parent, obj.name_.str(), method_id);
+          if(NULL == found) {
+            globals->function_hash().insert(method_id, method);
+          }
+        }
+        objs[i] = method;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  for(size_t i=0; i<fields_.size(); i++) {
+    const Field &field = fields_[i];
+    if(field.obj_ != kNone && objs[field.obj_]) {
+      apply(objs[field.obj_], field, ids);
+    }
+  }
+}
+
+//==============================================================================
+///      \class   JsonStage
+///      \method  apply
+///      \brief   The field is told by the object in the tree, i.e "ssca_isC"
+//                is isCLike of a class and isConst of a method
+//==============================================================================
+void JsonStage::apply(SCA::Obj *obj, const Field &field, const std::vector<U> &ids) const {
+  U value = (U)field.value_;
+  switch(obj->type()) {
+    case SCA::Obj::kSourceFile:
+    case SCA::Obj::kHeaderFile: {
+      SCA::File *file = static_cast<SCA::File*>(obj);
+      switch(field.key_) {
+        case kKeyBytes: file->set_size(value, file->num_lines());  break;
+        case kKeyLines: file->set_size(file->num_bytes(), value);  break;
+        case kKeyExternalIncludes: file->set_external_includes(value); break;
+        case kKeyIncludes:
+          for(U i=field.first_; i<field.first_ + field.num_; i++) {
+            FileId id = ids[includes_[i]];
+            if(id != INVALID_FILE_ID && id != file->id()) {
+              file->insert_direct_include(id);
+            }
+          }
+          break;
+        default:
+          break;
       }
       break;
     }
-    case JSON_ARRAY_END: {
-      //printf("Ending array : %s\n", data);
-      if(obj_stack_.size()) {
-        cur_context_.cur_obj_ = obj_stack_.top();
-        obj_stack_.pop();
-        cur_context_.cur_obj_type_ = cur_context_.cur_obj_->type();
+    case SCA::Obj::kClass: {
+      SCA::Class *cls = static_cast<SCA::Class*>(obj);
+      switch(field.key_) {
+        case kKeyWidth:         cls->set_width((int)value);  break;
+        case kKeyDepth:         cls->set_depth((int)value);  break;
+        case kKeyIsAggregate:   cls->set_isAggregate(value);   break;
+        case kKeyIsC:           cls->set_isCLike(value);       break;
+        case kKeyIsEmpty:       cls->set_isEmpty(value);       break;
+        case kKeyIsPolymorphic: cls->set_isPolymorphic(value); break;
+        case kKeyIsAbstract:    cls->set_isAbstract(value);    break;
+        case kKeyIsTrivial:     cls->set_isTrivial(value);     break;
+        case kKeyIsLiteral:     cls->set_isLiteral(value);     break;
+        default:
+          break;
       }
       break;
     }
-    case JSON_KEY:
-    case JSON_STRING:
-    case JSON_INT:
-    case JSON_FLOAT: {
-      //printf("Object : %s\n", data);
-      sprintf(value, "%*s", length, data);
-      //NOTE: If you add any new type it must be handled here
-      if(!strcmp(value, "pkg")) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kPackage; return 0;
-      } else if(!strcmp(value, PackageSourceFile)) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kSourceFile; return 0;
-      } else if(!strcmp(value, PackageHeaderFile)) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kHeaderFile; return 0;
-      } else if(!strcmp(value, FileFunction)) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kFunction; return 0;
-      } else if(!strcmp(value, FileClass)) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kClass; return 0;
-      } else if(!strcmp(value, ClassMethod)) {
-        cur_context_.cur_obj_type_ = SCA::Obj::kMethod; return 0;
-      } else  {
-        if(cur_context_.nvpair_.name_.empty()) {
-          cur_context_.nvpair_.name_ = value;
-        } else {
-          assert(cur_context_.nvpair_.value_.empty());
-          cur_context_.nvpair_.value_ = value;
-          //Since we have name-vale pair now, commit it
-          commit_all(cur_context_.nvpair_);
-          //Clear the nvpair to cache next nvpair
-          cur_context_.nvpair_.clear();
+    case SCA::Obj::kFunction:
+    case SCA::Obj::kMethod: {
+      SCA::Function *func = static_cast<SCA::Function*>(obj);
+      switch(field.key_) {
+        case kKeyCyclomatic: func->set_cyclomatic(value);  break;
+        case kKeyComplexity: func->set_complexity(value);  break;
+        case kKeyMaxNesting: func->set_max_nesting(value); break;
+        case kKeyNumLines:   func->set_num_lines(value);   break;
+        case kKeyParamSize:  func->set_param_size(value);  break;
+        case kKeyUsr:        func->set_usr(field.value_);  break;
+        case kKeyCalls:
+          func->set_callees(field.num_ ? &callees_[field.first_] : NULL, field.num_,
+                            SCA_globals::getGlobals()->obj_arena());
+          break;
+        case kKeyOperators:
+          func->set_operators(value, func->unique_operators());
+          break;
+        case kKeyOperands:
+          func->set_operands(value, func->unique_operands());
+          break;
+        case kKeyUniqueOperators:
+          func->set_operators(func->num_operators(), value);
+          break;
+        case kKeyUniqueOperands:
+          func->set_operands(func->num_operands(), value);
+          break;
+        case kKeyIsC:
+        case kKeyIsStatic:
+        case kKeyIsVirtual: {
+          if(obj->type() != SCA::Obj::kMethod) {
+            break;
+          }
+          SCA::Method *method = static_cast<SCA::Method*>(obj);
+          if(field.key_ == kKeyIsC) {
+            method->set_isConst(value);
+          } else if(field.key_ == kKeyIsStatic) {
+            method->set_isStatic(value);
+          } else {
+            method->set_isVirtual(value);
+          }
+          break;
         }
+        default:
+          break;
       }
       break;
     }
+    default:
+      break;
+  }
+}
+
+/// A slot of the key table
+struct JsonKeyEntry {
+  const char *name_;
+  JsonKey key_;
+};
+
+/// The keys by their slot, see json_key_slot(). To add a key, put it in the
+/// slot json_key_slot() gives for it. If that slot is taken, change the
+/// multipliers so that every key gets a slot of its own
+static const JsonKeyEntry kJsonKeys[64] = {
+  /*  0 */ { PackageSourceFile, kKeySourceFiles },
+  /*  1 */ { NULL, kKeyNone },
+  /*  2 */ { PackageLayer, kKeyPkgLayer },
+  /*  3 */ { FunctionId, kKeyId },
+  /*  4 */ { FileNumTus, kKeyNumTus },
+  /*  5 */ { FunctionFanOut, kKeyFanOut },
+  /*  6 */ { ClassisLiteral, kKeyIsLiteral },
+  /*  7 */ { FunctionOperands, kKeyOperands },
+  /*  8 */ { PackageReach, kKeyPkgReach },
+  /*  9 */ { FunctionParamSize, kKeyParamSize },
+  /* 10 */ { ClassisPolymorphic, kKeyIsPolymorphic },
+  /* 11 */ { FunctionOperators, kKeyOperators },
+  /* 12 */ { NULL, kKeyNone },
+  /* 13 */ { MethodisStatic, kKeyIsStatic },
+  /* 14 */ { ClassisTrivial, kKeyIsTrivial },
+  /* 15 */ { FunctionUsr, kKeyUsr },
+  /* 16 */ { MethodisVirtual, kKeyIsVirtual },
+  /* 17 */ { ClassWidth, kKeyWidth },
+  /* 18 */ { FunctionEffort, kKeyEffort },
+  /* 19 */ { PackageDependents, kKeyPkgDependents },
+  /* 20 */ { FileLines, kKeyLines },
+  /* 21 */ { PackageName, kKeyPkgName },
+  /* 22 */ { NULL, kKeyNone },
+  /* 23 */ { NULL, kKeyNone },
+  /* 24 */ { FileName, kKeyFileName },
+  /* 25 */ { FileFunction, kKeyFunctions },
+  /* 26 */ { NULL, kKeyNone },
+  /* 27 */ { NULL, kKeyNone },
+  /* 28 */ { NULL, kKeyNone },
+  /* 29 */ { PackageDepends, kKeyPkgDepends },
+  /* 30 */ { FunctionCalls, kKeyCalls },
+  /* 31 */ { FunctionCyclomatic, kKeyCyclomatic },
+  /* 32 */ { FileClass, kKeyClasses },
+  /* 33 */ { ClassName, kKeyClassName },
+  /* 34 */ { FunctionName, kKeyFunctionName },
+  /* 35 */ { FunctionMaxNesting, kKeyMaxNesting },
+  /* 36 */ { FileBuildBytes, kKeyBuildBytes },
+  /* 37 */ { FileExternalIncludes, kKeyExternalIncludes },
+  /* 38 */ { FileIncludes, kKeyIncludes },
+  /* 39 */ { ClassMethod, kKeyMethods },
+  /* 40 */ { FunctionComplexity, kKeyComplexity },
+  /* 41 */ { FileClosureBytes, kKeyClosureBytes },
+  /* 42 */ { FunctionDifficulty, kKeyDifficulty },
+  /* 43 */ { PackageHeaderFile, kKeyHeaderFiles },
+  /* 44 */ { FunctionNumLines, kKeyNumLines },
+  /* 45 */ { FunctionScc, kKeyScc },
+  /* 46 */ { FileBuildLines, kKeyBuildLines },
+  /* 47 */ { MethodName, kKeyMethodName },
+  /* 48 */ { NULL, kKeyNone },
+  /* 49 */ { FileBytes, kKeyBytes },
+  /* 50 */ { NULL, kKeyNone },
+  /* 51 */ { FileClosureLines, kKeyClosureLines },
+  /* 52 */ { FunctionUniqueOperators, kKeyUniqueOperators },
+  /* 53 */ { FunctionUniqueOperands, kKeyUniqueOperands },
+  /* 54 */ { NULL, kKeyNone },
+  /* 55 */ { ClassisAbstract, kKeyIsAbstract },
+  /* 56 */ { "pkg", kKeyPkg },
+  /* 57 */ { PackageCycle, kKeyPkgCycle },
+  /* 58 */ { FunctionFanIn, kKeyFanIn },
+  /* 59 */ { FunctionVolume, kKeyVolume },
+  /* 60 */ { ClassisAggregate, kKeyIsAggregate },
+  /* 61 */ { ClassisCLike, kKeyIsC },
+  /* 62 */ { ClassDepth, kKeyDepth },
+  /* 63 */ { ClassisEmpty, kKeyIsEmpty },
+};
+
+//==============================================================================
+///      \brief Perfect hash of the keys, from the length, the last two
+//              characters and the middle one. No two keys share a slot
+//==============================================================================
+static inline U json_key_slot(const char *name, size_t len) {
+  return (U)(len + (unsigned char)name[len - 1] + 11 * (unsigned char)name[len - 2] +
+             31 * (unsigned char)name[len >> 1]) & 63;
+}
+
+//==============================================================================
+///      \brief One hash and one compare, whatever the key
+//==============================================================================
+JsonKey lookupJsonKey(const StrView &name) {
+  if(name.len_ < 2) {
+    return kKeyNone;
+  }
+  const JsonKeyEntry &entry = kJsonKeys[json_key_slot(name.ptr_, name.len_)];
+  if(entry.name_ && name.equals(entry.name_)) {
+    return entry.key_;
+  }
+  return kKeyNone;
+}
+
+//==============================================================================
+///      \brief Recorded events must outlive the scratch buffers, so a decoded
+//              string is copied in to the partial. Keys are looked up here, so
+//              staging does not do it again
+//==============================================================================
+void JsonParser::event(JsonEvent::Type type, const StrView &text) {
+  JsonEvent ev;
+  ev.type_ = type;
+  ev.text_ = text;
+  ev.key_  = (type == JsonEvent::kKey) ? lookupJsonKey(text) : kKeyNone;
+  if(type != JsonEvent::kNoPair) {
+    num_tokens_++;
+  }
+  const char *data = recording_->data_;
+  if(text.ptr_ && (text.ptr_ < data || text.ptr_ >= data + recording_->size_)) {
+    recording_->decoded_.push_back(text.str());
+    ev.text_.ptr_ = recording_->decoded_.back().data();
+  }
+  recording_->events_.push_back(ev);
+}
+
+void JsonParser::dispatch(const JsonEvent &ev) {
+  switch(ev.type_) {
+    case JsonEvent::kKey:
+      on_key(ev.text_, ev.key_);
+      break;
+    case JsonEvent::kValue:
+      on_value(ev.text_);
+      break;
+    case JsonEvent::kArrayBegin:
+      on_array_begin();
+      break;
+    case JsonEvent::kArrayEnd:
+      on_array_end();
+      break;
+    case JsonEvent::kNoPair:
+      cur_context_.nvpair_.clear();
+      break;
+  }
+}
+
+//==============================================================================
+///      \brief A key followed by an array tells what the array holds
+//==============================================================================
+void JsonParser::on_key(const StrView &name, JsonKey key) {
+  //NOTE: If you add any new type it must be handled here
+  switch(key) {
+    case kKeyPkg:
+      cur_context_.cur_obj_type_ = SCA::Obj::kPackage;
+      break;
+    case kKeySourceFiles:
+      cur_context_.cur_obj_type_ = SCA::Obj::kSourceFile;
+      break;
+    case kKeyHeaderFiles:
+      cur_context_.cur_obj_type_ = SCA::Obj::kHeaderFile;
+      break;
+    case kKeyFunctions:
+      cur_context_.cur_obj_type_ = SCA::Obj::kFunction;
+      break;
+    case kKeyClasses:
+      cur_context_.cur_obj_type_ = SCA::Obj::kClass;
+      break;
+    case kKeyMethods:
+      cur_context_.cur_obj_type_ = SCA::Obj::kMethod;
+      break;
+    default:
+      cur_context_.nvpair_.name_ = name;
+      cur_context_.nvpair_.key_  = key;
+      break;
+  }
+}
+
+//==============================================================================
+///      \brief A scalar completes the name value pair of its key
+//==============================================================================
+void JsonParser::on_value(const StrView &value) {
+  if(cur_context_.nvpair_.name_.empty()) {
+    // Scalars in an array, nothing of SCA
+    return;
+  }
+  cur_context_.nvpair_.value_ = value;
+  //Since we have name-vale pair now, commit it
+  commit_all(cur_context_.nvpair_);
+  //Clear the nvpair to cache next nvpair
+  cur_context_.nvpair_.clear();
+}
+
+//==============================================================================
+///      \brief The object whose members are in the array is restored at its
+//              end
+//==============================================================================
+void JsonParser::on_array_begin(void) {
+  if(cur_context_.cur_obj_ != JsonStage::kNone) {
+    obj_stack_.push(cur_context_.cur_obj_);
+  }
+}
+
+void JsonParser::on_array_end(void) {
+  if(obj_stack_.size()) {
+    cur_context_.cur_obj_ = obj_stack_.top();
+    obj_stack_.pop();
+    cur_context_.cur_obj_type_ = stage_->objects_[cur_context_.cur_obj_].type_;
+  }
+}
+
+//==============================================================================
+///      \brief A string in place. Only a string with escapes is copied
+//==============================================================================
+bool JsonParser::parse_string(StrView &out, std::string &scratch) {
+  // *cur_ is the opening quote
+  const char *start = ++cur_;
+  while(cur_ < end_ && *cur_ != '"' && *cur_ != '\\') {
+    cur_++;
+  }
+  if(cur_ == end_) {
+    return false;
+  }
+  if(*cur_ == '"') {
+    out.ptr_ = start;
+    out.len_ = cur_ - start;
+    cur_++;
+    return true;
+  }
+  scratch.assign(start, cur_ - start);
+  while(cur_ < end_ && *cur_ != '"') {
+    char c = *cur_++;
+    if(c != '\\') {
+      scratch += c;
+      continue;
+    }
+    if(cur_ == end_) {
+      return false;
+    }
+    c = *cur_++;
+    switch(c) {
+      case 'n': scratch += '\n'; break;
+      case 't': scratch += '\t'; break;
+      case 'r': scratch += '\r'; break;
+      case 'b': scratch += '\b'; break;
+      case 'f': scratch += '\f'; break;
+      case 'u': {
+        // Names are ASCII, anything else is kept as a '?'
+        if(end_ - cur_ < 4) {
+          return false;
+        }
+        unsigned code = (unsigned)strtoul(std::string(cur_, 4).c_str(), NULL, 16);
+        scratch += (code < 0x80) ? (char)code : '?';
+        cur_ += 4;
+        break;
+      }
+      default: scratch += c; break;
+    }
+  }
+  if(cur_ == end_) {
+    return false;
+  }
+  cur_++;
+  out.ptr_ = scratch.data();
+  out.len_ = scratch.size();
+  return true;
+}
+
+//==============================================================================
+///      \brief { "key" : value, ... }
+//==============================================================================
+bool JsonParser::parse_object(void) {
+  cur_++;
+  skip_space();
+  if(cur_ < end_ && *cur_ == '}') {
+    cur_++;
+    return true;
+  }
+  while(cur_ < end_) {
+    StrView key;
+    if(*cur_ != '"' || !parse_string(key, key_scratch_)) {
+      return false;
+    }
+    event(JsonEvent::kKey, key);
+    skip_space();
+    if(cur_ == end_ || *cur_ != ':') {
+      return false;
+    }
+    cur_++;
+    if(!parse_value()) {
+      return false;
+    }
+    skip_space();
+    if(cur_ == end_) {
+      return false;
+    }
+    if(*cur_ == '}') {
+      cur_++;
+      return true;
+    }
+    if(*cur_ != ',') {
+      return false;
+    }
+    cur_++;
+    skip_space();
+  }
+  return false;
+}
+
+//==============================================================================
+///      \brief [ value, ... ]
+//==============================================================================
+bool JsonParser::parse_array(void) {
+  cur_++;
+  event(JsonEvent::kArrayBegin);
+  skip_space();
+  if(cur_ < end_ && *cur_ == ']') {
+    cur_++;
+    event(JsonEvent::kArrayEnd);
+    return true;
+  }
+  while(cur_ < end_) {
+    if(!parse_value()) {
+      return false;
+    }
+    skip_space();
+    if(cur_ == end_) {
+      return false;
+    }
+    if(*cur_ == ']') {
+      cur_++;
+      event(JsonEvent::kArrayEnd);
+      return true;
+    }
+    if(*cur_ != ',') {
+      return false;
+    }
+    cur_++;
+  }
+  return false;
+}
+
+//==============================================================================
+///      \brief Any value. A number or a literal is the run of characters up
+//              to the next separator
+//==============================================================================
+bool JsonParser::parse_value(void) {
+  skip_space();
+  if(cur_ == end_) {
+    return false;
+  }
+  switch(*cur_) {
+    case '{':
+      // A key whose value is not a scalar has no pair
+      event(JsonEvent::kNoPair);
+      return parse_object();
+    case '[':
+      event(JsonEvent::kNoPair);
+      return parse_array();
+    case '"': {
+      StrView value;
+      if(!parse_string(value, value_scratch_)) {
+        return false;
+      }
+      event(JsonEvent::kValue, value);
+      return true;
+    }
+    default: {
+      StrView value;
+      value.ptr_ = cur_;
+      while(cur_ < end_ && *cur_ != ',' && *cur_ != '}' && *cur_ != ']' &&
+            *cur_ != ' ' && *cur_ != '\n' && *cur_ != '\t' && *cur_ != '\r') {
+        cur_++;
+      }
+      value.len_ = cur_ - value.ptr_;
+      if(value.empty()) {
+        return false;
+      }
+      event(JsonEvent::kValue, value);
+      return true;
+    }
   }
-  return 0;
 }
 
 void JsonParser::commit_all(NameValuePair &a_nv_pair) {
@@ -112,184 +775,350 @@ void JsonParser::commit_all(NameValuePair &a_nv_pair) {
 }
 
 void JsonParser::commit_package(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(PackageName)) {
-    PkgId pkg_id = (PkgIdMgr::getPkgIdMgr()->insertPkg(a_nvpair.value_)); 
-    cur_context_.cur_obj_ = cur_context_.cur_package_ = PkgIdMgr::getPkgIdMgr()->getPkg(pkg_id);
-  } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+  switch(a_nvpair.key_) {
+    case kKeyPkgName: {
+      pkg_name_ = a_nvpair.value_.str();
+      cur_context_.cur_obj_ = cur_context_.cur_package_ = 
+        stage_->add_object(SCA::Obj::kPackage, JsonStage::kNone, a_nvpair.value_,
+                           stage_->package_id(pkg_name_), 0);
+      // A base name in an id is relative to the package
+      id_file_ = JsonStage::kNone;
+      break;
+    }
+    case kKeyPkgDepends:
+    case kKeyPkgLayer:
+    case kKeyPkgCycle:
+    case kKeyPkgReach:
+    case kKeyPkgDependents:
+      // The package graph is built again from the includes and the calls
+      break;
+    default:
+      // If this gets hit, the probably you hvae added a new member in class Package
+      assert(0);
   }
 }
 
 void JsonParser::commit_sFile(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(FileName)) {
-    std::string pkg_name = cur_context_.cur_package_->name();
-    pkg_name += "/" + a_nvpair.value_;
-    FileId fileId = FileIdMgr::getFileIdMgr()->insertFile(pkg_name); 
-    cur_context_.cur_obj_ = cur_context_.cur_file_ = FileIdMgr::getFileIdMgr()->getFile(fileId); 
-  } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+  U file = cur_context_.cur_file_;
+  switch(a_nvpair.key_) {
+    case kKeyFileName: {
+      std::string path = pkg_name_;
+      path += "/";
+      path.append(a_nvpair.value_.ptr_, a_nvpair.value_.len_);
+      cur_context_.cur_obj_ = cur_context_.cur_file_ = 
+        stage_->add_object(cur_context_.cur_obj_type_, JsonStage::kNone, a_nvpair.value_,
+                           stage_->path_id(path), 0);
+      break;
+    }
+    case kKeyBytes:
+    case kKeyLines:
+    case kKeyExternalIncludes:
+      stage_->add_field(file, a_nvpair.key_, a_nvpair.value_.to_int());
+      break;
+    case kKeyIncludes: {
+      JsonStage::Field &field = stage_->add_field(file, a_nvpair.key_, 0);
+      field.first_ = stage_->includes_.size();
+      field.num_   = parse_includes(a_nvpair.value_, *stage_);
+      break;
+    }
+    case kKeyNumTus:
+    case kKeyBuildBytes:
+    case kKeyBuildLines:
+    case kKeyClosureBytes:
+    case kKeyClosureLines:
+      // The include graph is closed again once all the inputs are in
+      break;
+    default:
+      // If this gets hit, the probably you hvae added a new member in class Package
+      assert(0);
   }
 }
 
 void JsonParser::commit_hFile(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(FileName)) {
-    std::string pkg_name = cur_context_.cur_package_->name();
-    pkg_name += "/" + a_nvpair.value_;
-    FileId fileId = FileIdMgr::getFileIdMgr()->insertFile(pkg_name);
-    cur_context_.cur_obj_ = cur_context_.cur_file_ = FileIdMgr::getFileIdMgr()->getFile(fileId); 
+  // Same fields as a source file
+  commit_sFile(a_nvpair);
+}
+
+//==============================================================================
+///      \class   JsonParser
+///      \method  source_id
+///      \brief   The local id of the path of a "path:line" value. The ids of
+//                a file are mostly in a row, so the path of the last one is
+//                kept. The outputs of older versions carry the base name
+//                only, which is taken to be in the package being read
+//==============================================================================
+U JsonParser::source_id(const StrView &value, LineId &line_no) {
+  size_t name_len = value.len_;
+  while(name_len && value.ptr_[name_len - 1] != ':') {
+    name_len--;
+  }
+  StrView line;
+  if(name_len) {
+    line.ptr_ = value.ptr_ + name_len;
+    line.len_ = value.len_ - name_len;
+    name_len--;
   } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+    name_len = value.len_;
+  }
+  if(id_file_ == JsonStage::kNone || id_path_.compare(0, std::string::npos, value.ptr_, name_len)) {
+    id_path_.assign(value.ptr_, name_len);
+    std::string path;
+    if(!memchr(value.ptr_, '/', name_len) && !pkg_name_.empty()) {
+      path = pkg_name_;
+      path += "/";
+    }
+    path += id_path_;
+    id_file_ = stage_->path_id(path);
   }
+  line_no = (LineId)line.to_int();
+  return id_file_;
 }
 
 void JsonParser::commit_function(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(FunctionName)) {
-     cur_context_.cur_obj_name_ = a_nvpair.value_;
-  } else if(!a_nvpair.name_.compare(FunctionId)) {
-    size_t pos = a_nvpair.value_.find_first_of(':');
-    std::string file_name = (a_nvpair.value_.substr(0, pos));
-    LineId lineid = atoi((a_nvpair.value_.substr(pos+1, a_nvpair.value_.size()-1)).c_str());
-    SourceId func_id(file_name, lineid);
-    cur_context_.cur_obj_ = cur_context_.cur_function_ =
-      SCA_globals::getGlobals()->function_hash()[func_id];
-    if(NULL == cur_context_.cur_function_) {
+  U func = cur_context_.cur_function_;
+  size_t end;
+  switch(a_nvpair.key_) {
+    case kKeyFunctionName:
+      cur_context_.cur_obj_name_ = a_nvpair.value_;
+      break;
+    case kKeyId: {
+      LineId line;
+      U path = source_id(a_nvpair.value_, line);
       cur_context_.cur_obj_ = cur_context_.cur_function_ = 
-        new SCA::Function(cur_context_.cur_file_,
-                          cur_context_.cur_obj_name_,
-                          func_id); 
-       SCA_globals::getGlobals()->function_hash().insert(func_id, cur_context_.cur_function_);
-    }
-  } else if(!a_nvpair.name_.compare(FunctionCyclomatic)) {
-    cur_context_.cur_function_->set_cyclomatic(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionComplexity)) {
-    cur_context_.cur_function_->set_complexity(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionMaxNesting)) {
-    cur_context_.cur_function_->set_max_nesting(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionNumLines)) {
-    cur_context_.cur_function_->set_num_lines(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionParamSize)) {
-    cur_context_.cur_function_->set_param_size(atoi(a_nvpair.value_.c_str()));
-  } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+        stage_->add_object(SCA::Obj::kFunction, cur_context_.cur_file_,
+                           cur_context_.cur_obj_name_, path, line);
+      break;
+    }
+    case kKeyCyclomatic:
+    case kKeyComplexity:
+    case kKeyMaxNesting:
+    case kKeyNumLines:
+    case kKeyParamSize:
+    case kKeyOperators:
+    case kKeyOperands:
+    case kKeyUniqueOperators:
+    case kKeyUniqueOperands:
+      stage_->add_field(func, a_nvpair.key_, a_nvpair.value_.to_int());
+      break;
+    case kKeyUsr:
+      stage_->add_field(func, a_nvpair.key_, a_nvpair.value_.to_hex(end));
+      break;
+    case kKeyCalls: {
+      JsonStage::Field &field = stage_->add_field(func, a_nvpair.key_, 0);
+      field.first_ = stage_->callees_.size();
+      field.num_   = parse_callees(a_nvpair.value_, stage_->callees_);
+      break;
+    }
+    case kKeyVolume:
+    case kKeyDifficulty:
+    case kKeyEffort:
+      // Derived from the counts
+      break;
+    case kKeyFanIn:
+    case kKeyFanOut:
+    case kKeyScc:
+      // The call graph is built again once all the inputs are in
+      break;
+    default:
+      // If this gets hit, the probably you hvae added a new member in class Package
+      assert(0);
   }
 }
 
 void JsonParser::commit_class(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(ClassName)) {
-    cur_context_.cur_obj_name_ = a_nvpair.value_;
-  } else if(!a_nvpair.name_.compare(ClassIdentity)) {
-    size_t pos = a_nvpair.value_.find_first_of(':');
-    std::string file_name = (a_nvpair.value_.substr(0, pos));
-    LineId lineid = atoi((a_nvpair.value_.substr(pos+1, a_nvpair.value_.size()-1)).c_str());
-    SourceId class_id(file_name, lineid);
-    cur_context_.cur_obj_ = cur_context_.cur_class_ = 
-      SCA_globals::getGlobals()->class_hash()[class_id];
-    if(NULL == cur_context_.cur_class_) {
+  U cls = cur_context_.cur_class_;
+  switch(a_nvpair.key_) {
+    case kKeyClassName:
+      cur_context_.cur_obj_name_ = a_nvpair.value_;
+      break;
+    case kKeyId: {
+      LineId line;
+      U path = source_id(a_nvpair.value_, line);
       cur_context_.cur_obj_ = cur_context_.cur_class_ = 
-        new SCA::Class((SCA::File*)cur_context_.cur_file_,
-                       cur_context_.cur_obj_name_,
-                       class_id); 
-       SCA_globals::getGlobals()->class_hash().insert(class_id, cur_context_.cur_class_);
-    }
-  } else if(!a_nvpair.name_.compare(ClassWidth)) {
-    cur_context_.cur_class_->set_width(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassDepth)) {
-    cur_context_.cur_class_->set_depth(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisAggregate)) {
-    cur_context_.cur_class_->set_isAggregate(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisCLike)) {
-    cur_context_.cur_class_->set_isCLike(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisEmpty)) {
-    cur_context_.cur_class_->set_isEmpty(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisPolymorphic)) {
-    cur_context_.cur_class_->set_isPolymorphic(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisAbstract)) {
-    cur_context_.cur_class_->set_isAbstract(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisTrivial)) {
-    cur_context_.cur_class_->set_isTrivial(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(ClassisLiteral)) {
-    cur_context_.cur_class_->set_isLiteral(atoi(a_nvpair.value_.c_str()));
-  } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+        stage_->add_object(SCA::Obj::kClass, cur_context_.cur_file_,
+                           cur_context_.cur_obj_name_, path, line);
+      break;
+    }
+    case kKeyWidth:
+    case kKeyDepth:
+    case kKeyIsAggregate:
+    case kKeyIsC:
+    case kKeyIsEmpty:
+    case kKeyIsPolymorphic:
+    case kKeyIsAbstract:
+    case kKeyIsTrivial:
+    case kKeyIsLiteral:
+      stage_->add_field(cls, a_nvpair.key_, a_nvpair.value_.to_int());
+      break;
+    default:
+      // If this gets hit, the probably you hvae added a new member in class Package
+      assert(0);
   }
 }
 
 void JsonParser::commit_method(NameValuePair &a_nvpair) {
-  if(!a_nvpair.name_.compare(MethodName)) {
-    cur_context_.cur_obj_name_ = a_nvpair.value_;
-  } else if(!a_nvpair.name_.compare(MethodId)) {
-    size_t pos = a_nvpair.value_.find_first_of(':');
-    std::string file_name = (a_nvpair.value_.substr(0, pos));
-    LineId lineid = atoi((a_nvpair.value_.substr(pos+1, a_nvpair.value_.size()-1)).c_str());
-    SourceId method_id(file_name, lineid);
-    cur_context_.cur_obj_ = cur_context_.cur_method_ = 
-      static_cast<SCA::Method*>(SCA_globals::getGlobals()->function_hash()[method_id]); 
-    if(NULL == cur_context_.cur_method_) {
+  U method = cur_context_.cur_method_;
+  size_t end;
+  switch(a_nvpair.key_) {
+    case kKeyMethodName:
+      cur_context_.cur_obj_name_ = a_nvpair.value_;
+      break;
+    case kKeyId: {
+      LineId line;
+      U path = source_id(a_nvpair.value_, line);
       cur_context_.cur_obj_ = cur_context_.cur_method_ = 
-        new SCA::Method(cur_context_.cur_class_,
-                        cur_context_.cur_obj_name_,
-                        method_id); 
-      SCA_globals::getGlobals()->function_hash().insert(method_id, cur_context_.cur_method_);
-    }
-  } else if(!a_nvpair.name_.compare(MethodisConstant)) {
-    cur_context_.cur_method_->set_isConst(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(MethodisStatic)) {
-    cur_context_.cur_method_->set_isStatic(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(MethodisVirtual)) {
-    cur_context_.cur_method_->set_isVirtual(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionCyclomatic)) {
-    cur_context_.cur_method_->set_cyclomatic(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionComplexity)) {
-    cur_context_.cur_method_->set_complexity(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionMaxNesting)) {
-    cur_context_.cur_method_->set_max_nesting(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionNumLines)) {
-    cur_context_.cur_method_->set_num_lines(atoi(a_nvpair.value_.c_str()));
-  } else if(!a_nvpair.name_.compare(FunctionParamSize)) {
-    cur_context_.cur_method_->set_param_size(atoi(a_nvpair.value_.c_str()));
-  } else {
-    // If this gets hit, the probably you hvae added a new member in class Package
-    assert(0);
+        stage_->add_object(SCA::Obj::kMethod, cur_context_.cur_class_,
+                           cur_context_.cur_obj_name_, path, line);
+      break;
+    }
+    case kKeyIsC:
+    case kKeyIsStatic:
+    case kKeyIsVirtual:
+    case kKeyCyclomatic:
+    case kKeyComplexity:
+    case kKeyMaxNesting:
+    case kKeyNumLines:
+    case kKeyParamSize:
+    case kKeyOperators:
+    case kKeyOperands:
+    case kKeyUniqueOperators:
+    case kKeyUniqueOperands:
+      stage_->add_field(method, a_nvpair.key_, a_nvpair.value_.to_int());
+      break;
+    case kKeyUsr:
+      stage_->add_field(method, a_nvpair.key_, a_nvpair.value_.to_hex(end));
+      break;
+    case kKeyCalls: {
+      JsonStage::Field &field = stage_->add_field(method, a_nvpair.key_, 0);
+      field.first_ = stage_->callees_.size();
+      field.num_   = parse_callees(a_nvpair.value_, stage_->callees_);
+      break;
+    }
+    case kKeyVolume:
+    case kKeyDifficulty:
+    case kKeyEffort:
+      // Derived from the counts
+      break;
+    case kKeyFanIn:
+    case kKeyFanOut:
+    case kKeyScc:
+      break;
+    default:
+      // If this gets hit, the probably you hvae added a new member in class Package
+      assert(0);
   }
 }
 
+const char* JsonParser::map_file(std::string &file, size_t &size, int &ret) {
+  int fd = open(file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    ret = kFileError;
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0) {
+    close(fd);
+    ret = kFileError;
+    return NULL;
+  }
+  if(st.st_size == 0) {
+    close(fd);
+    ret = kNotAJSONFile;
+    return NULL;
+  }
+  void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) {
+    ret = kFileError;
+    return NULL;
+  }
+  // The file is read front to back once
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+  size = st.st_size;
+  return static_cast<const char*>(addr);
+}
+
 int JsonParser::parse(std::string &file) {
-  json_parser parser;
-  FILE *fp = fopen(file.c_str(), "r");
-  if(!fp) return kFileError;
-  bool inside_json=false;
+  JsonPartial partial;
+  int ret = record(file, partial);
+  if(ret == kSuccess) {
+    JsonStage objects;
+    stage(partial, objects);
+    objects.splice();
+  }
+  return ret;
+}
+
+int JsonParser::parse(const char *data, size_t size) {
+  JsonPartial partial;
+  int ret = record(data, size, partial);
+  if(ret == kSuccess) {
+    JsonStage objects;
+    stage(partial, objects);
+    objects.splice();
+  }
+  return ret;
+}
+
+int JsonParser::record(std::string &file, JsonPartial &partial) {
+  size_t size = 0;
+  int ret = kSuccess;
+  const char *data = map_file(file, size, ret);
+  if(NULL == data) {
+    return ret;
+  }
+  partial.map_      = const_cast<char*>(data);
+  partial.map_size_ = size;
+  return record(data, size, partial);
+}
+
+int JsonParser::record(const char *data, size_t size, JsonPartial &partial) {
+  partial.data_ = data;
+  partial.size_ = size;
+  recording_ = &partial;
+  int ret = scan(data, size);
+  recording_ = NULL;
+  return ret;
+}
+
+//==============================================================================
+///      \class   JsonParser
+///      \method  stage
+///      \brief   The events are walked again with the objects going in to
+//                the stage. Only the partial and the stage are touched
+//==============================================================================
+void JsonParser::stage(const JsonPartial &partial, JsonStage &stage) {
+  stage_ = &stage;
+  // Most events are fields, about one in twenty makes an object
+  stage.fields_.reserve(stage.fields_.size() + partial.events_.size() / 2);
+  stage.objects_.reserve(stage.objects_.size() + partial.events_.size() / 16);
+  for(size_t i=0; i<partial.events_.size(); i++) {
+    dispatch(partial.events_[i]);
+  }
+  stage_ = NULL;
+}
+
+int JsonParser::scan(const char *data, size_t size) {
   bool found_atleast_one_json_object = false;
-  int line_num=0;
-  while (fgets(sca_json_string_, 1024, fp))
-  {
-    line_num++;
-    if(!inside_json && sca_json_string_[0] == '{') {
-      inside_json = true;
-      if (json_parser_init(&parser, 
-                           NULL, 
-                           JsonParser::sca_callback, //Call back 
-                           this)) { //User data
-        return kParseInitError;
-      }
-    }
-    if(inside_json) {
-      ret_ = json_parser_string(&parser, 
-          sca_json_string_, 
-          strlen(sca_json_string_), 
-          NULL);
-      if(ret_) {
+  const char *end = data + size;
+  const char *line = data;
+  while(line < end) {
+    if(*line == '{') {
+      cur_ = line;
+      end_ = end;
+      event(JsonEvent::kNoPair);
+      if(!parse_value()) {
         return kParseSyntaxError;
       }
       found_atleast_one_json_object = true;
-      if(sca_json_string_[0] == '}') {
-        inside_json = false;
-      }
+      line = cur_;
     }
+    // Next line
+    line = static_cast<const char*>(memchr(line, '\n', end - line));
+    if(NULL == line) {
+      break;
+    }
+    line++;
   }
   if(found_atleast_one_json_object) {
     return kSuccess;
@@ -298,10 +1127,14 @@ int JsonParser::parse(std::string &file) {
   }
 }
 
-bool isJsonFile(std::string &file_name) {
-  JsonParser parser;
-  if(parser.parse(file_name) != JsonParser::kSuccess) {
-    return false;
+bool isJsonHeader(const char *data, size_t len) {
+  for(size_t i=0; i<len; i++) {
+    if(data[i] == '{') {
+      return true;
+    }
+    if(data[i] != ' ' && data[i] != '\n' && data[i] != '\t' && data[i] != '\r') {
+      return false;
+    }
   }
-  return true;
+  return false;
 }
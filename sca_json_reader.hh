@@ -16,34 +16,264 @@
 #ifndef SCA_JSON_READER_H
 #define SCA_JSON_READER_H
 #include <stdint.h>
+#include <deque>
+#include <map>
 #include <stack>
 #include <string>
+#include <vector>
 #include <sca_utils.hh>
 #include <sca_globals.hh>
 
-bool isJsonFile(std::string &file_name);
+/// Tells if the first "len" bytes of a file look like the start of a JSON
+///  document i.e the first non blank character is a '{'
+bool isJsonHeader(const char *data, size_t len);
+
+// ============================================================================
+///        \class  StrView
+///        \brief  A string in the mapped file, not NUL terminated
+// ============================================================================
+class StrView {
+  public:
+    StrView(void) {
+      ptr_ = NULL;
+      len_ = 0;
+    }
+    bool empty(void) const { return len_ == 0; }
+    /// Compare with a C string
+    bool equals(const char *str) const {
+      return !strncmp(ptr_, str, len_) && str[len_] == '\0';
+    }
+    /// The leading integer, like atoi()
+    int to_int(void) const;
+    /// The leading hex digits, like strtoull(16). "end" gets the position
+    ///  after the last digit
+    ULL to_hex(size_t &end) const;
+    std::string str(void) const { return std::string(ptr_, len_); }
+    const char *ptr_;
+    size_t len_;
+};
+
+/// The keys of the SCA output. A key that is used by several objects
+///  (i.e "ssca_i") has one value, the object being read tells which field it
+///  is
+enum JsonKey {
+  kKeyNone,
+  kKeyPkg,
+  kKeyPkgName,
+  kKeySourceFiles,
+  kKeyHeaderFiles,
+  kKeyFileName,
+  kKeyFunctions,
+  kKeyClasses,
+  kKeyMethods,
+  kKeyFunctionName,
+  kKeyClassName,
+  kKeyMethodName,
+  kKeyId,
+  kKeyCyclomatic,
+  kKeyComplexity,
+  kKeyMaxNesting,
+  kKeyNumLines,
+  kKeyParamSize,
+  kKeyWidth,
+  kKeyDepth,
+  kKeyIsAggregate,
+  /// isCLike of a class, isConst of a method
+  kKeyIsC,
+  kKeyIsEmpty,
+  kKeyIsPolymorphic,
+  kKeyIsAbstract,
+  kKeyIsTrivial,
+  kKeyIsLiteral,
+  kKeyIsStatic,
+  kKeyIsVirtual,
+  kKeyUsr,
+  kKeyCalls,
+  kKeyFanIn,
+  kKeyFanOut,
+  kKeyScc,
+  kKeyBytes,
+  kKeyLines,
+  kKeyIncludes,
+  kKeyExternalIncludes,
+  kKeyNumTus,
+  kKeyBuildBytes,
+  kKeyBuildLines,
+  kKeyClosureBytes,
+  kKeyClosureLines,
+  kKeyPkgDepends,
+  kKeyPkgLayer,
+  kKeyPkgCycle,
+  kKeyPkgReach,
+  kKeyPkgDependents,
+  kKeyOperators,
+  kKeyOperands,
+  kKeyUniqueOperators,
+  kKeyUniqueOperands,
+  kKeyVolume,
+  kKeyDifficulty,
+  kKeyEffort
+};
+
+/// The key of a name. kKeyNone if it is not a key of the SCA output
+JsonKey lookupJsonKey(const StrView &name);
 
 class NameValuePair  {
   public:
+    NameValuePair(void) {
+      key_ = kKeyNone;
+    }
     void clear(void) {
-      name_.clear();
-      value_.clear();
+      name_  = StrView();
+      value_ = StrView();
+      key_   = kKeyNone;
     }
-    std::string name_;
-    std::string value_;
+    StrView name_;
+    StrView value_;
+    JsonKey key_;
+};
+
+// ============================================================================
+///        \class  JsonStage
+///        \brief  The objects of a recorded file, made without touching the
+///                tree. The objects refer to their parent and to the path of
+///                their id by an index in the stage, a local id. The fields
+///                are decoded already. The names point in to the partial the
+///                stage was made from, which must outlive it. Any number of
+///                files can be staged in parallel, splice() adds one to the
+///                tree
+// ============================================================================
+class JsonStage {
+  public:
+    /// No object, no path
+    static const U kNone = (U)-1;
+    /// A package, file, class, function or method
+    class Object {
+      public:
+        SCA::Obj::ObjType type_;
+        /// The object it is in: the file of a class or function, the class
+        ///  of a method. kNone for a package or a file
+        U parent_;
+        StrView name_;
+        /// The package or file itself, or the file of the id
+        U path_;
+        LineId line_;
+    };
+    /// A field of an object, in the order of the file. The callees and the
+    ///  includes are a range of callees_ and includes_
+    class Field {
+      public:
+        U obj_;
+        JsonKey key_;
+        ULL value_;
+        U first_;
+        U num_;
+    };
+    /// A package or file name, interned in the tree by splice() in the
+    ///  order they came
+    class Path {
+      public:
+        std::string name_;
+        bool package_;
+    };
+    JsonStage(void) {}
+    /// Local id of a package or file name
+    U package_id(const std::string &name);
+    U path_id(const std::string &name);
+    /// Add an object, returns its local id
+    U add_object(SCA::Obj::ObjType type, U parent, const StrView &name, 
+                 U path, LineId line);
+    /// Add a field of "obj", returns it to be filled in
+    Field& add_field(U obj, JsonKey key, ULL value);
+    /// Add the objects to the tree. The ids are interned, then the objects
+    ///  are looked up or made and the fields set. Nothing else may update
+    ///  the tree meanwhile
+    void splice(void) const;
+    std::vector<Object> objects_;
+    std::vector<Field> fields_;
+    std::vector<Path> paths_;
+    std::vector<ULL> callees_;
+    std::vector<U> includes_;
+  private:
+    /// Set a field of the object in the tree. "ids" are the ids in the tree
+    ///  of the local paths
+    void apply(SCA::Obj *obj, const Field &field, const std::vector<U> &ids) const;
+    std::map<std::string, U> package_ids_;
+    std::map<std::string, U> path_ids_;
+    JsonStage(const JsonStage&);
+    JsonStage& operator=(const JsonStage&);
 };
 
 class CurParseObj {
   public:
-    SCA::Package* cur_package_;
-    SCA::Function *cur_function_;
-    SCA::Class *cur_class_;
-    SCA::Method *cur_method_;
-    SCA::Obj *cur_file_;
-    SCA::Obj *cur_obj_;
+    CurParseObj(void) {
+      cur_package_  = JsonStage::kNone;
+      cur_function_ = JsonStage::kNone;
+      cur_class_    = JsonStage::kNone;
+      cur_method_   = JsonStage::kNone;
+      cur_file_     = JsonStage::kNone;
+      cur_obj_      = JsonStage::kNone;
+      cur_obj_type_ = SCA::Obj::kPackage;
+    }
+    /// Local ids in the stage being built
+    U cur_package_;
+    U cur_function_;
+    U cur_class_;
+    U cur_method_;
+    U cur_file_;
+    U cur_obj_;
     SCA::Obj::ObjType cur_obj_type_; 
     NameValuePair nvpair_;
-    std::string cur_obj_name_;
+    StrView cur_obj_name_;
+};
+
+// ============================================================================
+///        \class  JsonEvent
+///        \brief  A step of the walk of a JSON document
+// ============================================================================
+class JsonEvent {
+  public:
+    enum Type {
+      kKey,
+      kValue,
+      kArrayBegin,
+      kArrayEnd,
+      /// The pending key has an object or an array for its value
+      kNoPair
+    };
+    Type type_;
+    StrView text_;
+    /// The key of a kKey event
+    JsonKey key_;
+};
+
+// ============================================================================
+///        \class  JsonPartial
+///        \brief  A file that is parsed but not yet added to the tree. The
+///                views of the events point in to the data that was parsed.
+///                A mapping made for it is kept until the partial goes
+// ============================================================================
+class JsonPartial {
+  public:
+    JsonPartial(void) {
+      data_     = NULL;
+      size_     = 0;
+      map_      = NULL;
+      map_size_ = 0;
+    }
+    ~JsonPartial();
+    std::vector<JsonEvent> events_;
+    /// Strings that had escapes in them
+    std::deque<std::string> decoded_;
+    /// The data that was parsed
+    const char *data_;
+    size_t size_;
+    /// The mapping of the file, if the data is not owned by the caller
+    void *map_;
+    size_t map_size_;
+  private:
+    JsonPartial(const JsonPartial&);
+    JsonPartial& operator=(const JsonPartial&);
 };
 
 class JsonParser {
@@ -55,25 +285,89 @@ class JsonParser {
       kParseInitError,
       kParseSyntaxError
     };
+    JsonParser(void) {
+      recording_  = NULL;
+      stage_      = NULL;
+      cur_        = NULL;
+      end_        = NULL;
+      num_tokens_ = 0;
+      id_file_    = JsonStage::kNone;
+    }
+    /// Map the file and parse every JSON document in it in to the tree. A
+    ///  document starts with a '{' at the start of a line. Nothing is added
+    ///  if the file does not parse
     int parse(std::string &file);
+    /// Same as above for the content of a file
+    int parse(const char *data, size_t size);
+    /// Parse the file in to "partial" without touching the tree. Any number
+    ///  of files can be recorded in parallel
+    int record(std::string &file, JsonPartial &partial);
+    /// Same as above for data that outlives "partial" (i.e a member of an
+    ///  archive)
+    int record(const char *data, size_t size, JsonPartial &partial);
+    /// Make the objects of a recorded file in "stage", without touching the
+    ///  tree. Any number of files can be staged in parallel
+    void stage(const JsonPartial &partial, JsonStage &stage);
+    /// Keys, scalars and array brackets read so far
+    ULL num_tokens(void) const { return num_tokens_; }
   private:
-    static int sca_callback(void *userdata, 
-                            int type, 
-                            const char *data, 
-                            uint32_t length);
+    /// Parse every JSON document of the data in to the recording
+    int scan(const char *data, size_t size);
+    /// Map the file. Returns the mapping or NULL with the error in "ret"
+    static const char* map_file(std::string &file, size_t &size, int &ret);
+    /// Recursive descent over one value. Returns false on a syntax error
+    bool parse_value(void);
+    bool parse_object(void);
+    bool parse_array(void);
+    /// A string token. Escaped strings are decoded in to "scratch"
+    bool parse_string(StrView &out, std::string &scratch);
+    /// Skip the whitespace
+    void skip_space(void) {
+      while(cur_ < end_ && (*cur_ == ' ' || *cur_ == '\n' || *cur_ == '\t' || *cur_ == '\r')) {
+        cur_++;
+      }
+    }
+    /// Record an event of the walk
+    void event(JsonEvent::Type type, const StrView &text);
+    void event(JsonEvent::Type type) {
+      event(type, StrView());
+    }
+    /// Hand the event to its handler
+    void dispatch(const JsonEvent &ev);
+    /// Handlers of the events
+    void on_key(const StrView &name, JsonKey key);
+    void on_value(const StrView &value);
+    void on_array_begin(void);
+    void on_array_end(void);
     //NOTE: If you add any new type it must be handled here
     //All commit API's
-    static void commit_all(NameValuePair &a_nvpair);
-    static void commit_package(NameValuePair &a_nvpair);
-    static void commit_sFile(NameValuePair &a_nvpair);
-    static void commit_hFile(NameValuePair &a_nvpair);
-    static void commit_function(NameValuePair &a_nvpair);
-    static void commit_class(NameValuePair &a_nvpair);
-    static void commit_method(NameValuePair &a_nvpair);
-    static std::stack<SCA::Obj*> obj_stack_;
-    char sca_json_string_[1024];
-    static CurParseObj cur_context_;
-    int ret_;
+    void commit_all(NameValuePair &a_nvpair);
+    void commit_package(NameValuePair &a_nvpair);
+    void commit_sFile(NameValuePair &a_nvpair);
+    void commit_hFile(NameValuePair &a_nvpair);
+    void commit_function(NameValuePair &a_nvpair);
+    void commit_class(NameValuePair &a_nvpair);
+    void commit_method(NameValuePair &a_nvpair);
+    /// The local id of the path of a "path:line" value and the line
+    U source_id(const StrView &value, LineId &line);
+    std::stack<U> obj_stack_;
+    CurParseObj cur_context_;
+    /// Where the events go when recording
+    JsonPartial *recording_;
+    /// Where the objects go when staging
+    JsonStage *stage_;
+    /// Name of the package being read
+    std::string pkg_name_;
+    ULL num_tokens_;
+    /// The unparsed part of the input
+    const char *cur_;
+    const char *end_;
+    /// Decoded keys and values that had escapes in them
+    std::string key_scratch_;
+    std::string value_scratch_;
+    /// Path and local id of the path of the last id read
+    std::string id_path_;
+    U id_file_;
 };
 
 #endif    /* SCA_JSON_READER_H */
@@ -0,0 +1,255 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_packages.cc
+ *
+ *  \brief
+ *      Implementation of the package dependency graph
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 20:21:50 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <algorithm>
+#include "sca_packages.hh"
+
+using namespace SCA;
+
+/// Low link of a package whose component is done, i.e it is off the stack
+#define SCC_DONE ((U)-1)
+
+/// A package on the walk and the bit of its row to look at next
+struct PackageFrame {
+  U node_;
+  U next_;
+};
+
+//==============================================================================
+///      \brief First bit set in "row" from bit "from" on, "num_bits" if none
+//==============================================================================
+static inline U next_bit(const ULL *row, U from, U num_bits) {
+  U num_words = (num_bits + 63) / 64;
+  U w = from >> 6;
+  if(w >= num_words) {
+    return num_bits;
+  }
+  ULL bits = row[w] & (~0ULL << (from & 63));
+  while(!bits) {
+    if(++w == num_words) {
+      return num_bits;
+    }
+    bits = row[w];
+  }
+  return (w << 6) + lowest_bit(bits);
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method
+///      \brief   Constructor
+//==============================================================================
+PackageGraph::PackageGraph(void) {
+  num_nodes_  = 0;
+  num_words_  = 0;
+  num_edges_  = 0;
+  num_cycles_ = 0;
+  num_layers_ = 0;
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  clear
+///      \brief   Gives the memory back
+//==============================================================================
+void PackageGraph::clear(void) {
+  std::vector<ULL>().swap(deps_);
+  std::vector<ULL>().swap(reach_);
+  std::vector<U>().swap(components_);
+  std::vector<U>().swap(member_offsets_);
+  std::vector<U>().swap(members_);
+  std::vector<U>().swap(layers_);
+  std::vector<U>().swap(cycles_);
+  std::vector<U>().swap(num_reach_);
+  std::vector<U>().swap(num_dependents_);
+  num_nodes_  = 0;
+  num_words_  = 0;
+  num_edges_  = 0;
+  num_cycles_ = 0;
+  num_layers_ = 0;
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  reset
+///      \brief   Clears the matrix
+//==============================================================================
+void PackageGraph::reset(U num_nodes) {
+  clear();
+  num_nodes_ = num_nodes;
+  num_words_ = (num_nodes + 63) / 64;
+  deps_.assign((size_t)num_nodes_ * num_words_, 0);
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  add_dependency
+///      \brief   Called for every include and call between two packages, so
+//                most of them are already there
+//==============================================================================
+void PackageGraph::add_dependency(PkgId from, PkgId to) {
+  if(from == to || from >= num_nodes_ || to >= num_nodes_) {
+    return;
+  }
+  ULL &word = deps_[(size_t)from * num_words_ + (to >> 6)];
+  ULL bit = 1ULL << (to & 63);
+  if(!(word & bit)) {
+    word |= bit;
+    num_edges_++;
+  }
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  num_bytes
+///      \brief   Bytes held by the vectors
+//==============================================================================
+size_t PackageGraph::num_bytes(void) const {
+  return (deps_.capacity() + reach_.capacity()) * sizeof(ULL) +
+         (components_.capacity() + member_offsets_.capacity() + members_.capacity() +
+          layers_.capacity() + cycles_.capacity() + num_reach_.capacity() +
+          num_dependents_.capacity()) * sizeof(U);
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  build
+///      \brief   O(packages * packages / 64 + dependencies) for the
+//                components, see close() for the rest
+//==============================================================================
+void PackageGraph::build(void) {
+  find_components();
+  close();
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  find_components
+///      \brief   Tarjan's algorithm with the recursion on an explicit stack,
+//                same as the include graph. The edges of a package are the
+//                bits of its row
+//==============================================================================
+void PackageGraph::find_components(void) {
+  std::vector<U> index(num_nodes_, 0);
+  std::vector<U> low(num_nodes_, 0);
+  std::vector<U> stack_members;
+  std::vector<PackageFrame> stack;
+  U counter = 0;
+  components_.assign(num_nodes_, (U)-1);
+  members_.reserve(num_nodes_);
+  member_offsets_.push_back(0);
+  for(U root=0; root<num_nodes_; root++) {
+    if(index[root]) {
+      continue;
+    }
+    index[root] = low[root] = ++counter;
+    stack_members.push_back(root);
+    PackageFrame first = { root, 0 };
+    stack.push_back(first);
+    while(!stack.empty()) {
+      PackageFrame &top = stack.back();
+      U node = top.node_;
+      U dependency = next_bit(dependencies(node), top.next_, num_nodes_);
+      if(dependency < num_nodes_) {
+        top.next_ = dependency + 1;
+        if(0 == index[dependency]) {
+          index[dependency] = low[dependency] = ++counter;
+          stack_members.push_back(dependency);
+          PackageFrame frame = { dependency, 0 };
+          stack.push_back(frame);
+        } else if(low[dependency] != SCC_DONE && index[dependency] < low[node]) {
+          // Still on the member stack, i.e in the component being built
+          low[node] = index[dependency];
+        }
+        continue;
+      }
+      stack.pop_back();
+      if(low[node] != index[node]) {
+        U dependent = stack.back().node_;
+        if(low[node] < low[dependent]) {
+          low[dependent] = low[node];
+        }
+        continue;
+      }
+      size_t start = stack_members.size() - 1;
+      while(stack_members[start] != node) {
+        start--;
+      }
+      U component = member_offsets_.size() - 1;
+      for(size_t i=start; i<stack_members.size(); i++) {
+        low[stack_members[i]] = SCC_DONE;
+        components_[stack_members[i]] = component;
+        members_.push_back(stack_members[i]);
+      }
+      member_offsets_.push_back(members_.size());
+      // A package can not depend on itself, so a cycle has two or more
+      cycles_.push_back((stack_members.size() - start > 1) ? ++num_cycles_ : 0);
+      stack_members.resize(start);
+    }
+  }
+}
+
+//==============================================================================
+///      \class   PackageGraph
+///      \method  close
+///      \brief   In the order of the components. The members of a cycle
+//                reach each other, and so themselves. A component adds its
+//                size to the dependents of every package it reaches, which
+//                is O(components * packages / 64 + transitive dependencies)
+//==============================================================================
+void PackageGraph::close(void) {
+  U num_components = member_offsets_.size() - 1;
+  reach_.assign((size_t)num_components * num_words_, 0);
+  layers_.assign(num_components, 0);
+  num_reach_.assign(num_nodes_, 0);
+  num_dependents_.assign(num_nodes_, 0);
+  for(U c=0; c<num_components; c++) {
+    ULL *reach = &reach_[(size_t)c * num_words_];
+    U layer = 0;
+    for(U m=member_offsets_[c]; m<member_offsets_[c + 1]; m++) {
+      const ULL *deps = dependencies(members_[m]);
+      for(U w=0; w<num_words_; w++) {
+        for(ULL bits=deps[w]; bits; bits &= bits - 1) {
+          U dependency = (w << 6) + lowest_bit(bits);
+          U component = components_[dependency];
+          ULL bit = 1ULL << (dependency & 63);
+          if(component != c) {
+            layer = std::max(layer, layers_[component] + 1);
+            if(!(reach[w] & bit)) {
+              const ULL *reached = &reach_[(size_t)component * num_words_];
+              for(U k=0; k<num_words_; k++) {
+                reach[k] |= reached[k];
+              }
+            }
+          }
+          reach[w] |= bit;
+        }
+      }
+    }
+    layers_[c] = layer;
+    num_layers_ = std::max(num_layers_, layer + 1);
+    U num_members = member_offsets_[c + 1] - member_offsets_[c];
+    U num_reached = 0;
+    for(U w=0; w<num_words_; w++) {
+      for(ULL bits=reach[w]; bits; bits &= bits - 1) {
+        U reached = (w << 6) + lowest_bit(bits);
+        num_dependents_[reached] += num_members - (components_[reached] == c);
+        num_reached++;
+      }
+    }
+    for(U m=member_offsets_[c]; m<member_offsets_[c + 1]; m++) {
+      num_reach_[members_[m]] = num_reached - (num_members > 1);
+    }
+  }
+}
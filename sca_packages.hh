@@ -0,0 +1,119 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_packages.hh
+ *
+ *  \brief
+ *      Dependencies between the packages of the tree
+ *
+ *  \details
+ *      A package depends on another one when one of its files includes a
+ *      file of the other or one of its functions or methods calls a
+ *      function or method of the other. The edges come from the include
+ *      graph and the call graph, so they are for the whole build.
+ *
+ *      There are far fewer packages than files, so the dependencies are a
+ *      dense matrix with one row of bits per package: bit q of row p is set
+ *      if p depends on q directly. 10000 packages take 12 MB per matrix.
+ *      Packages that depend on each other (a cycle) are found with Tarjan's
+ *      algorithm on the rows. It numbers a component only once all it
+ *      depends on is numbered, so in that order the transitive dependencies
+ *      of a component are its own rows ORed with those of the components it
+ *      depends on. The row of a dependency already set is skipped, as what
+ *      it reaches is in the row already.
+ *
+ *      The layering of the tree follows: a package that depends on nothing
+ *      else is in layer 0 and any other package is one layer above the
+ *      highest of its dependencies. The packages of a cycle are in the same
+ *      layer, as they can not be built or tested apart. Every package also
+ *      gets the number of packages it depends on transitively and of those
+ *      that depend on it, i.e what a change to it can break.
+ *
+ *  \history
+ *      10/18/26 20:14:26 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_PACKAGES_H
+#define SCA_PACKAGES_H
+
+#include <vector>
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  PackageGraph
+///        \brief  The direct and transitive dependencies of the packages as
+//                 bit matrices, with their cycles and layers
+// ============================================================================
+class PackageGraph {
+  public:
+    /// Ctor
+    PackageGraph(void);
+    /// Drop the graph and start one of "num_nodes" packages without any
+    ///  dependency
+    void reset(U num_nodes);
+    /// Package "from" depends on "to". Ignored if they are the same
+    void add_dependency(PkgId from, PkgId to);
+    /// Whether "from" depends on "to" directly
+    bool depends(PkgId from, PkgId to) const {
+      return (deps_[(size_t)from * num_words_ + (to >> 6)] >> (to & 63)) & 1;
+    }
+    /// Find the cycles and the layers and close the dependencies
+    void build(void);
+    /// Drop the graph
+    void clear(void);
+    /// Number of packages
+    U num_nodes(void) const { return num_nodes_; }
+    /// Number of direct dependencies
+    ULL num_edges(void) const { return num_edges_; }
+    /// Number of cycles
+    U num_cycles(void) const { return num_cycles_; }
+    /// Number of layers, one more than the highest
+    U num_layers(void) const { return num_layers_; }
+    /// Bytes held by the graph
+    size_t num_bytes(void) const;
+    /// The packages "p" depends on directly, num_words() words of bits
+    const ULL* dependencies(PkgId p) const { return &deps_[(size_t)p * num_words_]; }
+    U num_words(void) const { return num_words_; }
+    /// Layer of "p", 0 if it depends on no other package
+    U layer(PkgId p) const { return layers_[components_[p]]; }
+    /// Cycle of "p", numbered from 1, 0 if it is not part of one
+    U cycle(PkgId p) const { return cycles_[components_[p]]; }
+    /// Number of other packages "p" depends on, directly or not
+    U num_reach(PkgId p) const { return num_reach_[p]; }
+    /// Number of other packages that depend on "p", directly or not
+    U num_dependents(PkgId p) const { return num_dependents_[p]; }
+
+  private:
+    /// Tarjan's strongly connected components, numbered in the order they
+    ///  are done
+    void find_components(void);
+    /// The transitive dependencies, layer and counts of every component
+    void close(void);
+    U num_nodes_;
+    /// Words of a row
+    U num_words_;
+    /// Direct dependencies, a row per package
+    std::vector<ULL> deps_;
+    /// Transitive dependencies, a row per component
+    std::vector<ULL> reach_;
+    /// Component of a package. The packages of component c are
+    ///  members_[member_offsets_[c] .. member_offsets_[c + 1])
+    std::vector<U> components_;
+    std::vector<U> member_offsets_;
+    std::vector<U> members_;
+    /// Layer and cycle of a component
+    std::vector<U> layers_;
+    std::vector<U> cycles_;
+    /// Counts of a package
+    std::vector<U> num_reach_;
+    std::vector<U> num_dependents_;
+    ULL num_edges_;
+    U num_cycles_;
+    U num_layers_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_PACKAGES_H */
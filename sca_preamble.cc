@@ -0,0 +1,386 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_preamble.cc
+ *
+ *  \brief
+ *      Implementation of the precompiled include block cache
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 08:17:42 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <sys/stat.h>
+#include "sca_preamble.hh"
+#include "sca_utils.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method
+///      \brief   Constructor
+//==============================================================================
+PreambleCache::PreambleCache(const std::string &dir) : dir_(dir) {
+  tmp_count_ = 0;
+  mkdir(dir_.c_str(), 0777);
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&built_, NULL);
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method
+///      \brief   Destructor
+//==============================================================================
+PreambleCache::~PreambleCache() {
+  pthread_cond_destroy(&built_);
+  pthread_mutex_destroy(&lock_);
+}
+
+//==============================================================================
+///      \brief   Whether the source is a C source i.e foo.c
+//==============================================================================
+static bool is_c_source(const std::string &source) {
+  size_t len = source.size();
+  return (len > 2 && source[len-2] == '.' && source[len-1] == 'c');
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  path
+///      \brief   Path of the cache file for the key
+//==============================================================================
+std::string PreambleCache::path(ULL key, const char *ext) {
+  char name[64];
+  snprintf(name, sizeof(name), "/%016llx%s", key, ext);
+  return dir_ + name;
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  read_include_block
+///      \brief   Collect the #include lines at the top of the file. Stops at
+//                the first line that is not an include, a comment or blank
+//==============================================================================
+void PreambleCache::read_include_block(const std::string &file, PreambleInfo &info) {
+  std::ifstream in(file.c_str());
+  std::string line;
+  bool in_comment = false;
+  while(std::getline(in, line)) {
+    size_t pos = line.find_first_not_of(" \t\r");
+    if(in_comment) {
+      size_t end = line.find("*/");
+      if(end == std::string::npos) {
+        continue;
+      }
+      in_comment = false;
+      pos = line.find_first_not_of(" \t\r", end + 2);
+    }
+    if(pos == std::string::npos || !line.compare(pos, 2, "//")) {
+      continue;
+    }
+    if(!line.compare(pos, 2, "/*")) {
+      size_t end = line.find("*/", pos + 2);
+      if(end == std::string::npos) {
+        in_comment = true;
+        continue;
+      }
+      if(line.find_first_not_of(" \t\r", end + 2) == std::string::npos) {
+        continue;
+      }
+      break;
+    }
+    if(line[pos] != '#') {
+      break;
+    }
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if(pos == std::string::npos || line.compare(pos, 7, "include")) {
+      break;
+    }
+    pos = line.find_first_not_of(" \t", pos + 7);
+    if(pos == std::string::npos) {
+      break;
+    }
+    char close = (line[pos] == '<') ? '>' : ((line[pos] == '"') ? '"' : 0);
+    size_t end = close ? line.find(close, pos + 1) : std::string::npos;
+    if(end == std::string::npos) {
+      // Macro includes can not be precompiled safely
+      break;
+    }
+    if(close == '"') {
+      info.has_quoted_ = true;
+    }
+    info.lines_.push_back("#include " + line.substr(pos, end - pos + 1));
+  }
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  plan
+///      \brief   Read the include blocks of all the jobs. The PCH of a job
+//                covers the longest include prefix it shares with another
+//                job of the run, or its whole block if it shares nothing
+//==============================================================================
+void PreambleCache::plan(const std::vector<TUJob> &jobs) {
+  infos_.clear();
+  infos_.resize(jobs.size());
+  std::map<ULL, U> prefix_count;
+  for(size_t i=0; i<jobs.size(); i++) {
+    PreambleInfo &info = infos_[i];
+    read_include_block(jobs[i].source_, info);
+    // Flags and language decide whether a PCH can be used by a TU
+    ULL key = hash_bytes(SCA_PCH_VERSION, sizeof(SCA_PCH_VERSION));
+    for(size_t j=0; j<jobs[i].args_.size(); j++) {
+      key = hash_bytes(jobs[i].args_[j].c_str(), jobs[i].args_[j].size() + 1, key);
+    }
+    std::string lang = is_c_source(jobs[i].source_) ? "c" : "c++";
+    key = hash_bytes(lang.c_str(), lang.size() + 1, key);
+    if(info.has_quoted_) {
+      // "quoted" includes are searched relative to the source
+      std::string dir_name, base_name;
+      split_path(jobs[i].source_, dir_name, base_name);
+      key = hash_bytes(dir_name.c_str(), dir_name.size() + 1, key);
+    }
+    for(size_t j=0; j<info.lines_.size(); j++) {
+      key = hash_bytes(info.lines_[j].c_str(), info.lines_[j].size() + 1, key);
+      info.keys_.push_back(key);
+      prefix_count[key]++;
+    }
+  }
+  for(size_t i=0; i<infos_.size(); i++) {
+    PreambleInfo &info = infos_[i];
+    info.build_len_ = info.lines_.size();
+    for(size_t k=info.keys_.size(); k>0; k--) {
+      if(prefix_count[info.keys_[k-1]] > 1) {
+        info.build_len_ = k;
+        break;
+      }
+    }
+  }
+}
+
+//==============================================================================
+///      \brief Inclusion visitor. Collects the headers the block includes
+//              itself, in the order of its lines
+//==============================================================================
+static void collect_block_file(CXFile file,
+                               CXSourceLocation *stack,
+                               unsigned stack_len,
+                               CXClientData client_data) {
+  if(1 == stack_len) {
+    static_cast<std::vector<CXFile>*>(client_data)->push_back(file);
+  }
+}
+
+//==============================================================================
+///      \brief Find the first header of the block that has no include guard.
+//              A header included earlier in the block is not listed again,
+//              so "line" may be before its actual line, never after
+//==============================================================================
+static bool find_unguarded(CXTranslationUnit TU, size_t &line) {
+  std::vector<CXFile> files;
+  clang_getInclusions(TU, collect_block_file, &files);
+  for(size_t i=0; i<files.size(); i++) {
+    if(!clang_isFileMultipleIncludeGuarded(TU, files[i])) {
+      line = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  build
+///      \brief   Compile the first "len" include lines of the job in to a PCH.
+//                The source includes the headers again after the PCH, which
+//                only a guarded header can take
+//==============================================================================
+bool PreambleCache::build(const TUJob &job,
+                          const PreambleInfo &info,
+                          size_t len,
+                          CXIndex idx,
+                          size_t &guarded_len) {
+  ULL key = info.keys_[len-1];
+  pthread_mutex_lock(&lock_);
+  U tmp_id = tmp_count_++;
+  pthread_mutex_unlock(&lock_);
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".tmp.%d.%u", (int)getpid(), tmp_id);
+  // The include block is compiled as a header of its own. The PCH records
+  // the mtime of the header, so an existing one is never rewritten
+  std::string header = path(key, ".h");
+  struct stat st;
+  if(stat(header.c_str(), &st) != 0) {
+    std::string tmp_header = header + suffix;
+    std::ofstream out(tmp_header.c_str());
+    for(size_t i=0; i<len; i++) {
+      out << info.lines_[i] << "\n";
+    }
+    out.close();
+    if(!out || rename(tmp_header.c_str(), header.c_str()) != 0) {
+      unlink(tmp_header.c_str());
+      return false;
+    }
+  }
+  std::vector<const char*> c_args;
+  for(size_t i=0; i<job.args_.size(); i++) {
+    const std::string &arg = job.args_[i];
+    // Dependency generation must not be done for the PCH
+    if(arg == "-MF" || arg == "-MT" || arg == "-MQ") {
+      i++;
+      continue;
+    }
+    if(!arg.compare(0, 2, "-M")) {
+      continue;
+    }
+    c_args.push_back(arg.c_str());
+  }
+  std::string dir_name, base_name;
+  if(info.has_quoted_) {
+    split_path(job.source_, dir_name, base_name);
+    c_args.push_back("-iquote");
+    c_args.push_back(dir_name.c_str());
+  }
+  c_args.push_back("-x");
+  c_args.push_back(is_c_source(job.source_) ? "c-header" : "c++-header");
+  CXTranslationUnit TU = clang_parseTranslationUnit(idx, header.c_str(),
+                                                    &c_args[0], c_args.size(),
+                                                    NULL, 0,
+                                                    CXTranslationUnit_ForSerialization |
+                                                    CXTranslationUnit_Incomplete);
+  if(NULL == TU) {
+    return false;
+  }
+  bool ok = !hasDiagnostics(TU, CXDiagnostic_Error);
+  guarded_len = len;
+  if(ok && find_unguarded(TU, guarded_len)) {
+    ok = false;
+  }
+  if(ok) {
+    std::string pch = path(key, ".pch");
+    std::string tmp_pch = pch + suffix;
+    ok = (CXSaveError_None == clang_saveTranslationUnit(TU, tmp_pch.c_str(),
+                                                         clang_defaultSaveOptions(TU)));
+    // rename() is atomic. Concurrent processes never see a partial PCH
+    ok = ok && (0 == rename(tmp_pch.c_str(), pch.c_str()));
+    if(!ok) {
+      unlink(tmp_pch.c_str());
+    }
+  }
+  clang_disposeTranslationUnit(TU);
+  return ok;
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  acquire
+///      \brief   Get the PCH for the job, building it if needed
+//==============================================================================
+std::string PreambleCache::acquire(const std::vector<TUJob> &jobs,
+                                   size_t job,
+                                   CXIndex idx) {
+  const PreambleInfo &info = infos_[job];
+  if(info.build_len_ == 0) {
+    return std::string();
+  }
+  // A longer prefix already on disk (say from another sca process) is
+  // as good as the one we planned to build
+  for(size_t k=info.keys_.size(); k>=info.build_len_; k--) {
+    ULL key = info.keys_[k-1];
+    std::string pch = path(key, ".pch");
+    struct stat st;
+    pthread_mutex_lock(&lock_);
+    bool ready = ready_.count(key) != 0;
+    bool failed = failed_.count(key) != 0;
+    pthread_mutex_unlock(&lock_);
+    if(ready || (!failed && stat(pch.c_str(), &st) == 0)) {
+      return pch;
+    }
+  }
+  // The block is cut before a header without an include guard, and built
+  // again for the lines before it
+  size_t len = info.build_len_;
+  while(len > 0) {
+    ULL key = info.keys_[len-1];
+    pthread_mutex_lock(&lock_);
+    while(building_.count(key)) {
+      pthread_cond_wait(&built_, &lock_);
+    }
+    if(ready_.count(key) || failed_.count(key)) {
+      bool ready = ready_.count(key) != 0;
+      std::map<ULL, size_t>::const_iterator it = guarded_lens_.find(key);
+      size_t guarded_len = (it != guarded_lens_.end()) ? it->second : 0;
+      pthread_mutex_unlock(&lock_);
+      if(ready) {
+        return path(key, ".pch");
+      }
+      len = guarded_len;
+      continue;
+    }
+    building_.insert(key);
+    pthread_mutex_unlock(&lock_);
+    size_t guarded_len = len;
+    bool ok = build(jobs[job], info, len, idx, guarded_len);
+    pthread_mutex_lock(&lock_);
+    building_.erase(key);
+    if(ok) {
+      ready_.insert(key);
+    } else {
+      failed_.insert(key);
+      if(guarded_len < len) {
+        guarded_lens_[key] = guarded_len;
+      }
+    }
+    pthread_cond_broadcast(&built_);
+    pthread_mutex_unlock(&lock_);
+    if(ok) {
+      return path(key, ".pch");
+    }
+    len = (guarded_len < len) ? guarded_len : 0;
+  }
+  return std::string();
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  invalidate
+///      \brief   Drop a PCH that could not be loaded i.e a header changed
+//                after the PCH was built
+//==============================================================================
+void PreambleCache::invalidate(const std::string &pch) {
+  size_t pos = pch.find_last_of('/');
+  ULL key = strtoull(pch.c_str() + pos + 1, NULL, 16);
+  pthread_mutex_lock(&lock_);
+  ready_.erase(key);
+  failed_.insert(key);
+  covered_.erase(pch);
+  pthread_mutex_unlock(&lock_);
+  unlink(pch.c_str());
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  markCovered
+///      \brief   Mark that a TU using the PCH has been walked
+//==============================================================================
+void PreambleCache::markCovered(const std::string &pch) {
+  pthread_mutex_lock(&lock_);
+  covered_.insert(pch);
+  pthread_mutex_unlock(&lock_);
+}
+
+//==============================================================================
+///      \class   PreambleCache
+///      \method  isCovered
+///      \brief   Whether the headers of the PCH are walked by an earlier TU
+//==============================================================================
+bool PreambleCache::isCovered(const std::string &pch) {
+  pthread_mutex_lock(&lock_);
+  bool covered = covered_.count(pch) != 0;
+  pthread_mutex_unlock(&lock_);
+  return covered;
+}
@@ -0,0 +1,114 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_preamble.hh
+ *
+ *  \brief
+ *      On-disk cache of precompiled include blocks
+ *
+ *  \details
+ *      The leading block of #include lines of a source file is compiled in
+ *      to a PCH with clang_saveTranslationUnit and the TU is then parsed
+ *      with -include-pch. The PCH is keyed by the compile flags plus the
+ *      include lines, so every TU that starts with the same includes (or a
+ *      prefix of them shared with other TUs of the run) reuses it. The cache
+ *      directory can be shared by concurrent sca processes.
+ *
+ *      The #include lines stay in the source, so a header is included again
+ *      after the PCH. Only the lines up to the first header without an
+ *      include guard (or #pragma once) are precompiled.
+ *
+ *  \history
+ *      10/18/26 08:05:19 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_PREAMBLE_H
+#define SCA_PREAMBLE_H
+
+#include <pthread.h>
+#include <clang-c/Index.h>
+#include "sca_int.hh"
+#include "sca_driver.hh"
+
+/// Bump when the PCH of a block changes i.e it covers other lines
+#define SCA_PCH_VERSION "sca-pch 2"
+
+namespace SCA {
+
+// ============================================================================
+///        \class  PreambleInfo
+///        \brief  The leading include block of one TU
+// ============================================================================
+class PreambleInfo {
+  public:
+    PreambleInfo(void) {
+      build_len_ = 0;
+      has_quoted_ = false;
+    }
+    /// Normalized #include lines
+    std::vector<std::string> lines_;
+    /// Key of every prefix. keys_[k] covers lines_[0..k]
+    std::vector<ULL> keys_;
+    /// Number of lines the PCH is built for, if it needs to be built
+    size_t build_len_;
+    /// Whether any of the includes is a "quoted" include
+    bool has_quoted_;
+};
+
+// ============================================================================
+///        \class  PreambleCache
+///        \brief  Builds and hands out PCH files for the driver jobs
+// ============================================================================
+class PreambleCache {
+  public:
+    /// Ctor. "dir" is the cache directory
+    PreambleCache(const std::string &dir);
+    /// Dtor
+    ~PreambleCache();
+    /// Read the include blocks of all the jobs and decide which prefixes
+    ///  are worth a PCH. Must be called before acquire()
+    void plan(const std::vector<TUJob> &jobs);
+    /// Get the PCH for the job, building it if needed. Returns an empty
+    ///  string if the job can not use a PCH
+    std::string acquire(const std::vector<TUJob> &jobs, size_t job, CXIndex idx);
+    /// Drop the PCH that failed to load for the job
+    void invalidate(const std::string &pch);
+    /// Mark that a TU using the PCH has been walked. All the headers in
+    ///  the PCH are then in the tree
+    void markCovered(const std::string &pch);
+    /// Whether the headers of the PCH are walked by an earlier TU
+    bool isCovered(const std::string &pch);
+
+  private:
+    /// Build the PCH for the first "len" include lines of the job. If a
+    ///  header of them is not guarded, nothing is built and "guarded_len"
+    ///  is set to the number of lines before it
+    bool build(const TUJob &job, const PreambleInfo &info, size_t len, CXIndex idx,
+               size_t &guarded_len);
+    /// Path of the file for the key
+    std::string path(ULL key, const char *ext);
+    /// Read the leading include block of "file"
+    static void read_include_block(const std::string &file, PreambleInfo &info);
+    /// The cache directory
+    std::string dir_;
+    /// Include block of every job
+    std::vector<PreambleInfo> infos_;
+    /// Keys that are available, being built or failed to build in this run
+    std::set<ULL> ready_;
+    std::set<ULL> building_;
+    std::set<ULL> failed_;
+    /// Number of guarded lines of the keys that failed for a header that is
+    ///  not guarded
+    std::map<ULL, size_t> guarded_lens_;
+    /// PCH whose declarations need not be walked again
+    std::set<std::string> covered_;
+    /// Used to name the temporary files
+    U tmp_count_;
+    /// Protects the sets above
+    pthread_mutex_t lock_;
+    /// Signalled when a build is over
+    pthread_cond_t built_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_PREAMBLE_H */
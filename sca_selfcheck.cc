@@ -0,0 +1,548 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_selfcheck.cc
+ *
+ *  \brief
+ *      Implementation of the checks of the readers
+ *
+ *  \details
+ *      binary/tiny.json is the output of SCA on a source of two classes and
+ *      two functions, with the paths changed to /sca/fixtures.
+ *      binary/tiny.bin is the same file passed back to SCA as an input and
+ *      written with --sca-format=bin. Write it again when
+ *      SCA_BINARY_VERSION changes. binary/shared.json is tiny.json with a
+ *      free function on the line of the method Shape::twice, and
+ *      binary/shared.bin is made from it the same way. json/minified.json is tiny.json on one
+ *      line with a function of a 2005 character name added.
+ *      archive/gnu.a and archive/bsd.a hold these files and a text under
+ *      long names, as written by GNU ar and by the ar of macOS. The other
+ *      archives are broken copies of them. The sources under pch/ are
+ *      analyzed with and without --sca-pch-dir, which must not differ.
+ *
+ *  \history
+ *      10/18/26 16:47:31 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "sca_selfcheck.hh"
+#include "sca_archive.hh"
+#include "sca_binary.hh"
+#include "sca_driver.hh"
+#include "sca_globals.hh"
+#include "sca_json_reader.hh"
+#include "sca_preamble.hh"
+#include "sca_visitor.hh"
+
+using namespace SCA;
+
+/// Checks run and failed so far
+static int sca_checks   = 0;
+static int sca_failures = 0;
+
+//==============================================================================
+///      \brief Report a check
+//==============================================================================
+static void check(bool ok, const std::string &what) {
+  sca_checks++;
+  if(!ok) {
+    sca_failures++;
+  }
+  fprintf(stderr, "sca: %s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+}
+
+//==============================================================================
+///      \brief The content of a fixture in "buf", 8 byte aligned like a
+//              mapping
+//==============================================================================
+static bool read_fixture(const std::string &path, std::vector<ULL> &buf, size_t &size) {
+  FILE *fp = fopen(path.c_str(), "rb");
+  if(NULL == fp) {
+    return false;
+  }
+  fseek(fp, 0, SEEK_END);
+  long len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if(len <= 0) {
+    fclose(fp);
+    return false;
+  }
+  size = len;
+  buf.assign((size + sizeof(ULL) - 1) / sizeof(ULL), 0);
+  bool ok = (fread(&buf[0], 1, size, fp) == size);
+  fclose(fp);
+  return ok;
+}
+
+//==============================================================================
+///      \brief Whether the tree has "classes" classes and "funcs" functions
+//              and methods
+//==============================================================================
+static bool tree_has(size_t classes, size_t funcs) {
+  SCA_globals *globals = SCA_globals::getGlobals();
+  return (globals->class_hash().size() == classes &&
+          globals->function_hash().size() == funcs);
+}
+
+//==============================================================================
+///      \brief The function or method at "path:line" in the tree, NULL if
+//              there is none
+//==============================================================================
+static Function* tree_function(const char *path, LineId line) {
+  FileId id = FileIdMgr::getFileIdMgr()->getFileId(path);
+  if(id == INVALID_FILE_ID) {
+    return NULL;
+  }
+  return SCA_globals::getGlobals()->function_hash()[SourceId(id, line)];
+}
+
+//==============================================================================
+///      \brief Open and load binary data in to an empty tree
+//==============================================================================
+static bool load_binary(const char *data, size_t size, const std::string &name) {
+  clean_up();
+  BinaryReader reader;
+  if(!reader.open(data, size, name)) {
+    return false;
+  }
+  reader.load();
+  return true;
+}
+
+/// The ways the binary fixture is broken
+enum BinaryDamage {
+  kDamageMagic,
+  kDamageVersion,
+  kDamageByteOrder,
+  kDamageMisalignedColumn,
+  kDamageColumnPastEnd,
+  kDamageColumnCount,
+  kDamageStringNotEnded,
+  kDamageStringIndex,
+  kDamageRowRange,
+  kNumDamages
+};
+
+static const char *kDamageNames[kNumDamages] = {
+  "a bad magic",
+  "another version",
+  "the other byte order",
+  "a column not 8 byte aligned",
+  "a column past the end",
+  "a column shorter than its table",
+  "a string blob not NUL terminated",
+  "a string index past the table",
+  "a function range past the functions"
+};
+
+//==============================================================================
+///      \brief Break the copy of the binary fixture at "base"
+//==============================================================================
+static void damage_binary(char *base, size_t size, BinaryDamage damage) {
+  BinHeader *header = reinterpret_cast<BinHeader*>(base);
+  BinColumn *columns = header->columns_;
+  switch(damage) {
+    case kDamageMagic:
+      header->magic_[1] ^= 0x20;
+      break;
+    case kDamageVersion:
+      header->version_++;
+      break;
+    case kDamageByteOrder:
+      header->byte_order_ = ((header->byte_order_ & 0xff) << 24) | ((header->byte_order_ & 0xff00) << 8) |
+                            ((header->byte_order_ >> 8) & 0xff00) | (header->byte_order_ >> 24);
+      break;
+    case kDamageMisalignedColumn:
+      columns[kBinFuncCyclomatic].offset_ += 4;
+      break;
+    case kDamageColumnPastEnd:
+      columns[kBinFuncUsr].offset_ = (size + 8) & ~(ULL)7;
+      break;
+    case kDamageColumnCount:
+      columns[kBinFuncNumLines].count_--;
+      break;
+    case kDamageStringNotEnded:
+      base[columns[kBinStrData].offset_ + columns[kBinStrData].count_ - 1] = 'x';
+      break;
+    case kDamageStringIndex:
+      reinterpret_cast<U*>(base + columns[kBinFuncName].offset_)[0] =
+        (U)columns[kBinStrOffsets].count_;
+      break;
+    case kDamageRowRange:
+      reinterpret_cast<U*>(base + columns[kBinFileNumFuncs].offset_)[0] = 1000;
+      break;
+    default:
+      break;
+  }
+}
+
+//==============================================================================
+///      \brief BinaryReader::open() and validate() on the fixture, on a copy
+//              of it that is not 8 byte aligned, on truncated copies and on
+//              every kind of damage
+//==============================================================================
+static void selfcheck_binary(const std::string &dir) {
+  std::string path = dir + "/binary/tiny.bin";
+  std::vector<ULL> buf;
+  size_t size = 0;
+  if(!read_fixture(path, buf, size)) {
+    check(false, "binary: " + path + " can be read");
+    return;
+  }
+  const char *data = reinterpret_cast<const char*>(&buf[0]);
+  clean_up();
+  {
+    BinaryReader reader;
+    bool ok = reader.open(path);
+    if(ok) {
+      reader.load();
+    }
+    check(ok && tree_has(2, 4), "binary: tiny.bin loads 2 classes and 4 functions");
+  }
+  // A member of an archive is only 2 byte aligned
+  std::vector<char> unaligned(size + 16);
+  char *odd = &unaligned[0] + (8 - reinterpret_cast<size_t>(&unaligned[0]) % 8) % 8 + 2;
+  memcpy(odd, data, size);
+  check(load_binary(odd, size, "tiny.bin (unaligned)") && tree_has(2, 4),
+        "binary: tiny.bin at an unaligned address loads the same");
+  std::vector<ULL> cut(buf);
+  check(!load_binary(reinterpret_cast<const char*>(&cut[0]), size - 64, "tiny.bin (cut)"),
+        "binary: rejects tiny.bin without its last 64 bytes");
+  check(!load_binary(data, sizeof(BinHeader) - 1, "tiny.bin (header)"),
+        "binary: rejects tiny.bin cut inside the header");
+  {
+    clean_up();
+    BinaryReader reader;
+    check(!reader.open(dir + "/binary/truncated.bin"), "binary: rejects truncated.bin");
+  }
+  {
+    // Shape::twice and the free function twice share tiny.h:7
+    clean_up();
+    BinaryReader reader;
+    std::string shared = dir + "/binary/shared.bin";
+    bool ok = reader.open(shared);
+    if(ok) {
+      reader.load();
+    }
+    Function *func = tree_function("/sca/fixtures/tiny.h", 7);
+    check(ok && func && func->type() == Obj::kFunction &&
+          func->cyclomatic() == 5 && func->num_lines() == 9,
+          "binary: shared.bin keeps the function on the line of a method");
+    FileId file = FileIdMgr::getFileIdMgr()->getFileId("/sca/fixtures/tiny.h");
+    Class *cls = SCA_globals::getGlobals()->class_hash()[SourceId(file, 3)];
+    Obj *method = cls ? cls->getChildOfType(Obj::kMethod, "twice") : NULL;
+    check(method && static_cast<Method*>(method)->cyclomatic() == 1,
+          "binary: shared.bin keeps the method on the line of a function");
+  }
+  for(int d=0; d<kNumDamages; d++) {
+    std::vector<ULL> copy(buf);
+    damage_binary(reinterpret_cast<char*>(&copy[0]), size, (BinaryDamage)d);
+    std::string name = std::string("tiny.bin with ") + kDamageNames[d];
+    check(!load_binary(reinterpret_cast<const char*>(&copy[0]), size, name),
+          "binary: rejects " + name);
+  }
+}
+
+//==============================================================================
+///      \brief Parse a JSON fixture in to an empty tree
+//==============================================================================
+static int parse_json(const std::string &path) {
+  clean_up();
+  std::string file(path);
+  JsonParser parser;
+  return parser.parse(file);
+}
+
+static int parse_json(const char *data, size_t size) {
+  clean_up();
+  JsonParser parser;
+  return parser.parse(data, size);
+}
+
+/// Bad documents and what the parser must say. Each one stops in a
+///  different parse_*() of the JsonParser
+static const struct {
+  const char *what_;
+  const char *text_;
+  int ret_;
+} kJsonCases[] = {
+  { "an empty object",         "{}\n",                                       JsonParser::kSuccess },
+  { "no document",             "sca\n",                                      JsonParser::kNotAJSONFile },
+  { "a document not at the start of a line", " x {}\n",                      JsonParser::kNotAJSONFile },
+  { "a key with no string",    "{ssca_PkgName : \"/p\"}\n",                  JsonParser::kParseSyntaxError },
+  { "a key with no colon",     "{\"ssca_PkgName\" \"/p\"}\n",                JsonParser::kParseSyntaxError },
+  { "a missing value",         "{\"pkg\":[{\"ssca_PkgName\":}]}\n",          JsonParser::kParseSyntaxError },
+  { "a comma before a brace",  "{\"pkg\":[{\"ssca_PkgName\":\"/p\",}]}\n",   JsonParser::kParseSyntaxError },
+  { "a comma before a bracket", "{\"pkg\":[{},]}\n",                         JsonParser::kParseSyntaxError },
+  { "an array not closed",     "{\"pkg\":[{}\n",                             JsonParser::kParseSyntaxError },
+  { "a string not closed",     "{\"pkg\":[{\"ssca_PkgName\":\"/p}]}\n",      JsonParser::kParseSyntaxError },
+  { "an escape at the end",    "{\"pkg\":[{\"ssca_PkgName\":\"/p\\",         JsonParser::kParseSyntaxError },
+  { "a short \\u escape",      "{\"pkg\":[{\"ssca_PkgName\":\"\\u00",        JsonParser::kParseSyntaxError }
+};
+
+//==============================================================================
+///      \brief JsonParser::parse() and its parse_*() on the fixtures, on
+//              every cut of the minified one and on bad documents. A file
+//              that does not parse must leave the tree empty
+//==============================================================================
+static void selfcheck_json(const std::string &dir) {
+  int ret = parse_json(dir + "/binary/tiny.json");
+  Function *total = tree_function("/sca/fixtures/tiny.cc", 7);
+  check(ret == JsonParser::kSuccess && tree_has(2, 4) && total && total->num_callees() == 2,
+        "json: tiny.json loads 2 classes and 4 functions");
+  std::string minified = dir + "/json/minified.json";
+  ret = parse_json(minified);
+  total = tree_function("/sca/fixtures/tiny.cc", 7);
+  Function *longest = tree_function("/sca/fixtures/tiny.cc", 40);
+  check(ret == JsonParser::kSuccess && tree_has(2, 5) && total && total->num_callees() == 2,
+        "json: minified.json loads the same as tiny.json and one more function");
+  check(longest && strlen(longest->name()) == 2005,
+        "json: minified.json keeps a name of 2005 characters");
+  ret = parse_json(dir + "/json/escaped.json");
+  Function *literal = tree_function("/sca/fixtures/esc.cc", 2);
+  Function *path = tree_function("/sca/fixtures/esc.cc", 4);
+  check(ret == JsonParser::kSuccess && literal && !strcmp(literal->name(), "operator\"\"_km") &&
+        path && !strcmp(path->name(), "path\\to\tnameA") && path->num_callees() == 1,
+        "json: escaped.json decodes \\\", \\\\, \\t and \\u0041");
+  ret = parse_json(dir + "/json/truncated.json");
+  check(ret == JsonParser::kParseSyntaxError && tree_has(0, 0),
+        "json: rejects truncated.json and adds nothing");
+  ret = parse_json(dir + "/json/malformed.json");
+  check(ret == JsonParser::kParseSyntaxError && tree_has(0, 0),
+        "json: rejects malformed.json and adds nothing");
+  std::vector<ULL> buf;
+  size_t size = 0;
+  if(read_fixture(minified, buf, size)) {
+    const char *data = reinterpret_cast<const char*>(&buf[0]);
+    int cuts = 0;
+    int bad_cuts = 0;
+    for(size_t len=1; len<size - 1; len+=7) {
+      cuts++;
+      // Every cut ends inside the document
+      std::vector<char> cut(data, data + len);
+      if(parse_json(&cut[0], cut.size()) != JsonParser::kParseSyntaxError || !tree_has(0, 0)) {
+        bad_cuts++;
+      }
+    }
+    char what[64];
+    snprintf(what, sizeof(what), "json: rejects minified.json cut at %d points", cuts);
+    check(0 == bad_cuts, what);
+  } else {
+    check(false, "json: " + minified + " can be read");
+  }
+  for(size_t i=0; i<sizeof(kJsonCases)/sizeof(kJsonCases[0]); i++) {
+    const char *text = kJsonCases[i].text_;
+    ret = parse_json(text, strlen(text));
+    check(ret == kJsonCases[i].ret_ && tree_has(0, 0),
+          std::string(ret == JsonParser::kSuccess ? "json: takes " : "json: rejects ") +
+          kJsonCases[i].what_);
+  }
+}
+
+/// The archives and the members they must give, in order. A member is
+///  compared with the fixture after its name, or with "hello" when there is
+///  none. The broken archives stop at their damage
+static const struct {
+  const char *archive_;
+  const char *members_[3][2];
+} kArchiveCases[] = {
+  { "gnu.a",          { { "tiny_result_with_a_long_name.o",    "binary/tiny.bin" },
+                        { "note.txt",                          NULL },
+                        { "escaped_result_with_a_long_name.o", "json/escaped.json" } } },
+  { "bsd.a",          { { "tiny_result_with_a_long_name.o",    "binary/tiny.json" },
+                        { "minified.o",                        "json/minified.json" },
+                        { "note text.txt",                     NULL } } },
+  { "truncated.a",    { { "tiny_result_with_a_long_name.o",    "binary/tiny.bin" },
+                        { "note.txt",                          NULL } } },
+  { "bad_offset.a",   { { "tiny_result_with_a_long_name.o",    "binary/tiny.bin" },
+                        { "note.txt",                          NULL } } },
+  { "bad_bsd_name.a", { { "tiny_result_with_a_long_name.o",    "binary/tiny.json" } } }
+};
+
+//==============================================================================
+///      \brief Whether a member has the content of "fixture" and loads from
+//              the mapping of the archive
+//==============================================================================
+static bool member_loads(const ArchiveMember &member, const std::string &fixture) {
+  std::vector<ULL> buf;
+  size_t size = 0;
+  if(!read_fixture(fixture, buf, size) || size != member.size_ ||
+     memcmp(&buf[0], member.data_, size)) {
+    return false;
+  }
+  if(isBinaryHeader(member.data_, member.size_)) {
+    return load_binary(member.data_, member.size_, member.name_) && tree_has(2, 4);
+  }
+  return parse_json(member.data_, member.size_) == JsonParser::kSuccess && !tree_has(0, 0);
+}
+
+//==============================================================================
+///      \brief ArchiveReader::open() and next() on GNU and BSD archives and on
+//              broken ones. The members are loaded in place
+//==============================================================================
+static void selfcheck_archive(const std::string &dir) {
+  {
+    ArchiveReader reader;
+    check(!reader.open(dir + "/binary/tiny.bin"), "archive: tiny.bin is not an archive");
+  }
+  for(size_t i=0; i<sizeof(kArchiveCases)/sizeof(kArchiveCases[0]); i++) {
+    std::string archive = kArchiveCases[i].archive_;
+    ArchiveReader reader;
+    if(!reader.open(dir + "/archive/" + archive)) {
+      check(false, "archive: " + archive + " opens");
+      continue;
+    }
+    ArchiveMember member;
+    bool ok = true;
+    size_t num = 0;
+    while(num < 3 && kArchiveCases[i].members_[num][0]) {
+      num++;
+    }
+    for(size_t m=0; ok && m<num; m++) {
+      const char *name    = kArchiveCases[i].members_[m][0];
+      const char *fixture = kArchiveCases[i].members_[m][1];
+      if(!reader.next(member) || member.name_ != name) {
+        ok = false;
+      } else if(fixture) {
+        ok = member_loads(member, dir + "/" + fixture);
+      } else {
+        ok = (member.size_ == 5 && !memcmp(member.data_, "hello", 5));
+      }
+    }
+    ok = ok && !reader.next(member);
+    char what[128];
+    snprintf(what, sizeof(what), "archive: %s gives %d member%s%s", archive.c_str(), (int)num,
+             (1 == num) ? "" : "s", (3 == num) ? "" : " and stops");
+    check(ok, what);
+  }
+}
+
+/// Sources analyzed with and without a PCH, each set on its own
+static const char *kPchSources[][3] = {
+  { "guarded1.cc", "guarded2.cc", NULL },
+  { "unguarded1.cc", "unguarded2.cc", NULL }
+};
+
+//==============================================================================
+///      \brief One line per file and per function of the tree: what the
+//              walk and the Halstead counts gave it. Sorted, the ids are
+//              left out
+//==============================================================================
+static std::string tree_summary(void) {
+  std::vector<std::string> lines;
+  FileIdMgr *files = FileIdMgr::getFileIdMgr();
+  for(FileId id=0; id<files->cFiles(); id++) {
+    File *file = files->getFile(id);
+    if(NULL == file) {
+      continue;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), " %u includes, %u bytes\n",
+             (U)file->direct_includes().size(), file->num_bytes());
+    lines.push_back(files->getFileName(id) + std::string(line));
+  }
+  std::vector<Function*> funcs;
+  SCA_globals::getGlobals()->function_hash().values(funcs);
+  for(size_t i=0; i<funcs.size(); i++) {
+    char line[128];
+    snprintf(line, sizeof(line), " %u callees, %u/%u operators, %u/%u operands, %u paths\n",
+             funcs[i]->num_callees(), funcs[i]->num_operators(), funcs[i]->unique_operators(),
+             funcs[i]->num_operands(), funcs[i]->unique_operands(), funcs[i]->cyclomatic());
+    lines.push_back(funcs[i]->name() + std::string(line));
+  }
+  std::sort(lines.begin(), lines.end());
+  std::string text;
+  for(size_t i=0; i<lines.size(); i++) {
+    text += lines[i];
+  }
+  return text;
+}
+
+//==============================================================================
+///      \brief Analyze the sources in to an empty tree, with the PCH cache
+//              in "pch_dir" unless it is empty
+//==============================================================================
+static std::string analyze_sources(const std::string &dir, const char *const *sources,
+                                   const std::string &pch_dir) {
+  clean_up();
+  Driver driver;
+  PreambleCache *cache = pch_dir.empty() ? NULL : new PreambleCache(pch_dir);
+  driver.set_preamble_cache(cache);
+  for(int i=0; sources[i]; i++) {
+    driver.addSource(dir + "/pch/" + sources[i], std::vector<std::string>());
+  }
+  driver.run();
+  delete cache;
+  return tree_summary();
+}
+
+//==============================================================================
+///      \brief Remove the directory and the files in it
+//==============================================================================
+static void remove_dir(const std::string &dir) {
+  DIR *d = opendir(dir.c_str());
+  if(d) {
+    struct dirent *entry;
+    while((entry = readdir(d)) != NULL) {
+      if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+        unlink((dir + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+//==============================================================================
+///      \brief The PCH of the headers the sources share must not change the
+//              tree. The first source builds it, the second reuses it. The
+//              sources include a header without a guard after the PCH too
+//==============================================================================
+static void selfcheck_pch(const std::string &root) {
+  char *dir = realpath(root.c_str(), NULL);
+  if(NULL == dir) {
+    check(false, "pch: " + root + " can be read");
+    return;
+  }
+  for(size_t i=0; i<sizeof(kPchSources)/sizeof(kPchSources[0]); i++) {
+    std::string what = std::string(kPchSources[i][0]) + " and " + kPchSources[i][1];
+    char pch_dir[] = "/tmp/sca-selfcheck-XXXXXX";
+    if(NULL == mkdtemp(pch_dir)) {
+      check(false, "pch: a directory for the PCH of " + what + " can be made");
+      continue;
+    }
+    std::string plain = analyze_sources(dir, kPchSources[i], std::string());
+    std::string pch = analyze_sources(dir, kPchSources[i], pch_dir);
+    remove_dir(pch_dir);
+    check(!plain.empty() && plain.find(" 0/0 operators") == std::string::npos,
+          "pch: " + what + " count the tokens of every function");
+    check(pch == plain, "pch: " + what + " give the same tree with a PCH");
+    if(pch != plain) {
+      fprintf(stderr, "sca: without a PCH:\n%ssca: with it:\n%s", plain.c_str(), pch.c_str());
+    }
+  }
+  free(dir);
+}
+
+//==============================================================================
+///      \method sca_selfcheck
+///      \brief  The tree is emptied before and after every group of checks
+//==============================================================================
+int sca_selfcheck(const char *dir) {
+  std::string root(dir);
+  sca_checks   = 0;
+  sca_failures = 0;
+  selfcheck_binary(root);
+  selfcheck_json(root);
+  selfcheck_archive(root);
+  selfcheck_pch(root);
+  clean_up();
+  fprintf(stderr, "sca: selfcheck: %d checks, %d failed\n", sca_checks, sca_failures);
+  return sca_failures;
+}
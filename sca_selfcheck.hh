@@ -0,0 +1,26 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_selfcheck.hh
+ *
+ *  \brief
+ *      Checks of the readers of the result files against fixtures
+ *
+ *  \details
+ *      --sca-selfcheck=DIR runs the readers on the small files checked in
+ *      under DIR (fixtures/ of the source tree) and on copies of them that
+ *      are broken in memory. A reader must take a good file in full and
+ *      turn down a bad one without reading out of it. The sources under
+ *      DIR are also analyzed with and without a PCH. Every check is
+ *      reported on stderr.
+ *
+ *  \history
+ *      10/18/26 16:42:08 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_SELFCHECK_H
+#define SCA_SELFCHECK_H
+
+/// Run the checks on the fixtures in "dir". Returns the number that failed
+int sca_selfcheck(const char *dir);
+
+#endif    /* SCA_SELFCHECK_H */
@@ -0,0 +1,202 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_shard.cc
+ *
+ *  \brief
+ *      Implementation of the sharded output
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 17:20:05 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "sca_shard.hh"
+#include "sca_globals.hh"
+#include "sca_analyzer.hh"
+
+using namespace SCA;
+
+// ============================================================================
+///        \class  ShardSummary
+///        \brief  The numbers of a package that go in to the manifest
+// ============================================================================
+class ShardSummary {
+  public:
+    ShardSummary(void) {
+      bytes_          = 0;
+      source_files_   = 0;
+      header_files_   = 0;
+      functions_      = 0;
+      classes_        = 0;
+      methods_        = 0;
+      cyclomatic_     = 0;
+      max_cyclomatic_ = 0;
+      num_lines_      = 0;
+    }
+    /// Count the files of the package and all that is in them
+    void add(const Package *pkg);
+    std::string shard_;
+    ULL bytes_;
+    ULL source_files_;
+    ULL header_files_;
+    ULL functions_;
+    ULL classes_;
+    ULL methods_;
+    ULL cyclomatic_;
+    U max_cyclomatic_;
+    ULL num_lines_;
+
+  private:
+    void add_function(const Function *func);
+};
+
+//==============================================================================
+///      \class   ShardSummary
+///      \method  add_function
+///      \brief   Functions and methods alike
+//==============================================================================
+void ShardSummary::add_function(const Function *func) {
+  cyclomatic_ += func->cyclomatic();
+  num_lines_  += func->num_lines();
+  if(func->cyclomatic() > max_cyclomatic_) {
+    max_cyclomatic_ = func->cyclomatic();
+  }
+}
+
+//==============================================================================
+///      \class   ShardSummary
+///      \method  add
+///      \brief   Walks the package like the dump does
+//==============================================================================
+void ShardSummary::add(const Package *pkg) {
+  const ObjList &files = pkg->getChilds();
+  for(ObjList::const_iterator f=files.begin(); f!=files.end(); f++) {
+    if((*f)->type() == Obj::kSourceFile) {
+      source_files_++;
+    } else if((*f)->type() == Obj::kHeaderFile) {
+      header_files_++;
+    } else {
+      continue;
+    }
+    const ObjList &objs = (*f)->getChilds();
+    for(ObjList::const_iterator it=objs.begin(); it!=objs.end(); it++) {
+      if((*it)->type() == Obj::kFunction) {
+        functions_++;
+        add_function(static_cast<const Function*>(*it));
+      } else if((*it)->type() == Obj::kClass) {
+        classes_++;
+        const ObjList &members = (*it)->getChilds();
+        for(ObjList::const_iterator m=members.begin(); m!=members.end(); m++) {
+          if((*m)->type() == Obj::kMethod) {
+            methods_++;
+            add_function(static_cast<const Function*>(*m));
+          }
+        }
+      }
+    }
+  }
+}
+
+//==============================================================================
+///      \brief A field of the manifest entry i.e <"key" : val,>
+//==============================================================================
+static void write_field(Writer &w, const char *key, ULL val, bool isLast=false) {
+  w.key("       ", key, " : ");
+  w.num(val);
+  w.end(isLast ? "" : ",");
+}
+
+//==============================================================================
+///      \brief Write the manifest through "w", which writes to its file
+//==============================================================================
+static void write_manifest(Writer &w, const std::vector<Package*> &pkgs,
+                           const std::vector<ShardSummary> &summaries) {
+  w.line("", "{");
+  w.key("  ", ManifestPackages, " : ");
+  w.end("[");
+  for(size_t i=0; i<summaries.size(); i++) {
+    const ShardSummary &s = summaries[i];
+    w.line("    ", "{");
+    w.key("       ", PackageName, " : ");
+    w.str(pkgs[i]->name());
+    w.end(",");
+    w.key("       ", ManifestShard, " : ");
+    w.str(s.shard_.c_str());
+    w.end(",");
+    write_field(w, ManifestBytes, s.bytes_);
+    write_field(w, ManifestSourceFiles, s.source_files_);
+    write_field(w, ManifestHeaderFiles, s.header_files_);
+    write_field(w, ManifestFunctions, s.functions_);
+    write_field(w, ManifestClasses, s.classes_);
+    write_field(w, ManifestMethods, s.methods_);
+    write_field(w, ManifestCyclomatic, s.cyclomatic_);
+    write_field(w, ManifestMaxCyclomatic, s.max_cyclomatic_);
+    write_field(w, ManifestNumLines, s.num_lines_, true);
+    w.line("    ", (i + 1 == summaries.size()) ? "}" : "},");
+  }
+  w.line("            ", "]");
+  w.line("", "}");
+  if(w.compact()) {
+    w.put('\n');
+  }
+}
+
+//==============================================================================
+///      \brief The shards go through the global writer, so that the dump
+//              routines are used as they are. Its file is given back at the
+//              end
+//==============================================================================
+bool sca_write_shards(const std::vector<Package*> &pkgs, const std::string &dir) {
+  if(mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    fprintf(stderr, "sca: could not create %s\n", dir.c_str());
+    return false;
+  }
+  Writer &w = SCA_GET_WRITER();
+  FILE *out = w.file();
+  std::vector<ShardSummary> summaries(pkgs.size());
+  std::vector<Package*> one(1);
+  char name[32];
+  bool ok = true;
+  for(size_t i=0; ok && i<pkgs.size(); i++) {
+    snprintf(name, sizeof(name), "%05lu.json", (unsigned long)i);
+    std::string path = dir + "/" + name;
+    FILE *fp = fopen(path.c_str(), "w");
+    if(NULL == fp) {
+      fprintf(stderr, "sca: could not write %s\n", path.c_str());
+      ok = false;
+      break;
+    }
+    one[0] = pkgs[i];
+    w.set_file(fp);
+    sca_dump_json(one);
+    w.set_file(NULL);
+    summaries[i].shard_ = name;
+    summaries[i].bytes_ = ftell(fp);
+    summaries[i].add(pkgs[i]);
+    ok = (fclose(fp) == 0);
+  }
+  if(ok) {
+    // Readers never see a manifest that is half written
+    std::string path = dir + "/" + ManifestFile;
+    std::string tmp  = path + ".tmp";
+    FILE *fp = fopen(tmp.c_str(), "w");
+    if(NULL != fp) {
+      w.set_file(fp);
+      write_manifest(w, pkgs, summaries);
+      w.set_file(NULL);
+      ok = (fclose(fp) == 0) && (rename(tmp.c_str(), path.c_str()) == 0);
+    } else {
+      ok = false;
+    }
+    if(!ok) {
+      fprintf(stderr, "sca: could not write %s\n", path.c_str());
+    }
+  }
+  w.set_file(out);
+  return ok;
+}
@@ -0,0 +1,70 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_shard.hh
+ *
+ *  \brief
+ *      Output split in to one file per package
+ *
+ *  \details
+ *      With --sca-format=shards -o DIR every package is written to a file of
+ *      its own in DIR, and DIR/manifest.json lists the packages with their
+ *      shard and a few summary numbers. A consumer reads the manifest and
+ *      loads only the packages it needs.
+ *
+ *      A shard is a regular JSON output holding a single package, so it can
+ *      be passed back to SCA like any other result. The manifest is written
+ *      last, through a rename, so it never names a shard that is not there.
+ *
+ *      {
+ *        "ssca_manifest" : [
+ *          {
+ *            "ssca_PkgName" : "/tools/sca/src",
+ *            "ssca_shard"   : "00000.json",
+ *            "ssca_bytes"   : 5120,      size of the shard
+ *            "ssca_nsf"     : 12,        source files
+ *            "ssca_nhf"     : 9,         header files
+ *            "ssca_nfn"     : 140,       functions
+ *            "ssca_ncl"     : 20,        classes
+ *            "ssca_nmt"     : 210,       methods
+ *            "ssca_tcyc"    : 1200,      cyclomatic complexity, summed
+ *            "ssca_mcyc"    : 35,        and the largest one
+ *            "ssca_tnl"     : 9800       lines of the functions and methods
+ *          }
+ *        ]
+ *      }
+ *
+ *  \history
+ *      10/18/26 17:12:40 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_SHARD_H
+#define SCA_SHARD_H
+
+#include <string>
+#include <vector>
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+/// Keys of the manifest
+#define ManifestPackages "ssca_manifest"
+#define ManifestShard "ssca_shard"
+#define ManifestBytes "ssca_bytes"
+#define ManifestSourceFiles "ssca_nsf"
+#define ManifestHeaderFiles "ssca_nhf"
+#define ManifestFunctions "ssca_nfn"
+#define ManifestClasses "ssca_ncl"
+#define ManifestMethods "ssca_nmt"
+#define ManifestCyclomatic "ssca_tcyc"
+#define ManifestMaxCyclomatic "ssca_mcyc"
+#define ManifestNumLines "ssca_tnl"
+
+/// Name of the manifest in the shard directory
+#define ManifestFile "manifest.json"
+
+//--------------------------------------------------------------------------------------
+///      \brief Write the packages and the manifest to "dir", which is created
+///             if needed. Returns false on an error
+//--------------------------------------------------------------------------------------
+bool sca_write_shards(const std::vector<SCA::Package*> &pkgs, const std::string &dir);
+
+#endif    /* SCA_SHARD_H */
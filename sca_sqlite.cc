@@ -0,0 +1,488 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_sqlite.cc
+ *
+ *  \brief
+ *      Implementation of the SQLite export
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 16:30:52 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include <unistd.h>
+#include "sca_sqlite.hh"
+#include "sca_globals.hh"
+#include "sca_workqueue.hh"
+
+#ifdef SCA_ENABLE_SQLITE
+#include <sqlite3.h>
+
+using namespace SCA;
+
+/// The tables. Row ids are given by the exporter
+static const char *kSchema =
+  "CREATE TABLE package ("
+  "  id INTEGER PRIMARY KEY, name TEXT NOT NULL, layer INTEGER, cycle INTEGER,"
+  "  num_reach INTEGER, num_dependents INTEGER);"
+  "CREATE TABLE package_dependency ("
+  "  package_id INTEGER NOT NULL, depends_on_id INTEGER NOT NULL);"
+  "CREATE TABLE file ("
+  "  id INTEGER PRIMARY KEY, package_id INTEGER NOT NULL, name TEXT NOT NULL,"
+  "  is_header INTEGER NOT NULL, bytes INTEGER, lines INTEGER, num_tus INTEGER,"
+  "  build_bytes INTEGER, build_lines INTEGER, closure_bytes INTEGER, closure_lines INTEGER,"
+  "  external_includes INTEGER);"
+  "CREATE TABLE class ("
+  "  id INTEGER PRIMARY KEY, package_id INTEGER NOT NULL, file_id INTEGER NOT NULL,"
+  "  name TEXT NOT NULL, line INTEGER NOT NULL, width INTEGER, depth INTEGER,"
+  "  is_aggregate INTEGER, is_clike INTEGER, is_empty INTEGER, is_polymorphic INTEGER,"
+  "  is_abstract INTEGER, is_trivial INTEGER, is_literal INTEGER);"
+  "CREATE TABLE function ("
+  "  id INTEGER PRIMARY KEY, package_id INTEGER NOT NULL, file_id INTEGER NOT NULL,"
+  "  class_id INTEGER, name TEXT NOT NULL, line INTEGER NOT NULL,"
+  "  cyclomatic INTEGER, complexity INTEGER, max_nesting INTEGER, num_lines INTEGER,"
+  "  param_size INTEGER, is_const INTEGER, is_static INTEGER, is_virtual INTEGER,"
+  "  fan_in INTEGER, fan_out INTEGER, scc INTEGER, operators INTEGER, operands INTEGER,"
+  "  unique_operators INTEGER, unique_operands INTEGER, volume REAL, difficulty REAL,"
+  "  effort REAL);";
+
+/// The indices, built after the rows are in. The package name is unique so
+///  that the planner walks the (package_id, metric) index of a join on the
+///  name in order, instead of sorting the package
+static const char *kIndices =
+  "CREATE UNIQUE INDEX package_name ON package(name);"
+  "CREATE INDEX package_layer ON package(layer);"
+  "CREATE INDEX package_cycle ON package(cycle) WHERE cycle > 0;"
+  "CREATE INDEX package_num_dependents ON package(num_dependents);"
+  "CREATE INDEX package_dependency_from ON package_dependency(package_id);"
+  "CREATE INDEX package_dependency_to ON package_dependency(depends_on_id);"
+  "CREATE INDEX file_package ON file(package_id);"
+  "CREATE INDEX file_num_tus ON file(num_tus);"
+  "CREATE INDEX file_build_bytes ON file(build_bytes);"
+  "CREATE INDEX file_closure_bytes ON file(closure_bytes);"
+  "CREATE INDEX class_package_width ON class(package_id, width);"
+  "CREATE INDEX class_package_depth ON class(package_id, depth);"
+  "CREATE INDEX class_file ON class(file_id);"
+  "CREATE INDEX class_width ON class(width);"
+  "CREATE INDEX class_depth ON class(depth);"
+  "CREATE INDEX function_file ON function(file_id);"
+  "CREATE INDEX function_class ON function(class_id);"
+  "CREATE INDEX function_package_cyclomatic ON function(package_id, cyclomatic);"
+  "CREATE INDEX function_package_complexity ON function(package_id, complexity);"
+  "CREATE INDEX function_package_max_nesting ON function(package_id, max_nesting);"
+  "CREATE INDEX function_package_num_lines ON function(package_id, num_lines);"
+  "CREATE INDEX function_package_param_size ON function(package_id, param_size);"
+  "CREATE INDEX function_cyclomatic ON function(cyclomatic);"
+  "CREATE INDEX function_complexity ON function(complexity);"
+  "CREATE INDEX function_max_nesting ON function(max_nesting);"
+  "CREATE INDEX function_num_lines ON function(num_lines);"
+  "CREATE INDEX function_param_size ON function(param_size);"
+  "CREATE INDEX function_fan_in ON function(fan_in);"
+  "CREATE INDEX function_fan_out ON function(fan_out);"
+  "CREATE INDEX function_scc ON function(scc) WHERE scc > 0;"
+  "CREATE INDEX function_package_volume ON function(package_id, volume);"
+  "CREATE INDEX function_package_effort ON function(package_id, effort);"
+  "CREATE INDEX function_volume ON function(volume);"
+  "CREATE INDEX function_difficulty ON function(difficulty);"
+  "CREATE INDEX function_effort ON function(effort);";
+
+// ============================================================================
+///        \class  SqliteExporter
+///        \brief  Loads the tree in to a database
+// ============================================================================
+class SqliteExporter {
+  public:
+    /// Ctor
+    SqliteExporter(void);
+    /// Dtor. Closes the database
+    ~SqliteExporter();
+    /// Create the database and start the transaction
+    bool open(const std::string &path);
+    /// Insert the package with all that is in it
+    bool add(Package *pkg);
+    /// Insert the dependencies between the packages added
+    bool add_dependencies(const std::vector<Package*> &pkgs);
+    /// Commit and build the indices
+    bool close(void);
+    /// Rows inserted so far
+    ULL num_rows(void) const {
+      return num_pkgs_ + num_deps_ + num_files_ + num_classes_ + num_funcs_;
+    }
+
+  private:
+    /// Run SQL that returns no rows
+    bool exec(const char *sql);
+    /// Compile a statement
+    bool prepare(sqlite3_stmt **stmt, const char *sql);
+    /// Run an insert and make it ready for the next row
+    bool step(sqlite3_stmt *stmt);
+    /// Let the index builds sort on all the CPUs
+    bool set_threads(void);
+    /// Report the last error
+    bool fail(const char *what);
+    bool add_file(File *file, ULL pkg_id, bool is_header);
+    bool add_class(Class *cls, ULL pkg_id, ULL file_id);
+    bool add_function(Function *func, ULL pkg_id, ULL file_id, ULL class_id);
+    sqlite3 *db_;
+    sqlite3_stmt *insert_pkg_;
+    sqlite3_stmt *insert_dep_;
+    sqlite3_stmt *insert_file_;
+    sqlite3_stmt *insert_class_;
+    sqlite3_stmt *insert_func_;
+    /// Rows of each table, also the id of the last row
+    ULL num_pkgs_;
+    ULL num_deps_;
+    /// Row of a package by its PkgId, 0 if it is not added
+    std::vector<ULL> pkg_rows_;
+    ULL num_files_;
+    ULL num_classes_;
+    ULL num_funcs_;
+};
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method
+///      \brief   Constructor
+//==============================================================================
+SqliteExporter::SqliteExporter(void) {
+  db_           = NULL;
+  insert_pkg_   = NULL;
+  insert_dep_   = NULL;
+  insert_file_  = NULL;
+  insert_class_ = NULL;
+  insert_func_  = NULL;
+  num_pkgs_     = 0;
+  num_deps_     = 0;
+  num_files_    = 0;
+  num_classes_  = 0;
+  num_funcs_    = 0;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method
+///      \brief   Destructor. A transaction that is still open is rolled back
+//==============================================================================
+SqliteExporter::~SqliteExporter() {
+  sqlite3_finalize(insert_pkg_);
+  sqlite3_finalize(insert_dep_);
+  sqlite3_finalize(insert_file_);
+  sqlite3_finalize(insert_class_);
+  sqlite3_finalize(insert_func_);
+  sqlite3_close(db_);
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  fail
+///      \brief   Always returns false
+//==============================================================================
+bool SqliteExporter::fail(const char *what) {
+  fprintf(stderr, "sca: sqlite %s: %s\n", what, db_ ? sqlite3_errmsg(db_) : "out of memory");
+  return false;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  exec
+///      \brief   Run SQL that returns no rows
+//==============================================================================
+bool SqliteExporter::exec(const char *sql) {
+  if(sqlite3_exec(db_, sql, NULL, NULL, NULL) != SQLITE_OK) {
+    return fail("exec");
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  prepare
+///      \brief   Compile a statement
+//==============================================================================
+bool SqliteExporter::prepare(sqlite3_stmt **stmt, const char *sql) {
+  if(sqlite3_prepare_v2(db_, sql, -1, stmt, NULL) != SQLITE_OK) {
+    return fail("prepare");
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  step
+///      \brief   The bindings are overwritten by the next row, no need to
+//                clear them
+//==============================================================================
+bool SqliteExporter::step(sqlite3_stmt *stmt) {
+  if(sqlite3_step(stmt) != SQLITE_DONE) {
+    return fail("insert");
+  }
+  sqlite3_reset(stmt);
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  set_threads
+///      \brief   Ignored by a library built without worker threads
+//==============================================================================
+bool SqliteExporter::set_threads(void) {
+  char sql[64];
+  snprintf(sql, sizeof(sql), "PRAGMA threads=%d;", WorkQueue::num_cpus());
+  return exec(sql);
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  open
+///      \brief   The database is a new file every time, so there is nothing
+//                to recover from a crash. The journal is off and nothing is
+//                synced until the end
+//==============================================================================
+bool SqliteExporter::open(const std::string &path) {
+  unlink(path.c_str());
+  if(sqlite3_open(path.c_str(), &db_) != SQLITE_OK) {
+    return fail("open");
+  }
+  return exec("PRAGMA journal_mode=OFF;"
+              "PRAGMA synchronous=OFF;"
+              "PRAGMA cache_size=-65536;") &&
+         set_threads() &&
+         exec(kSchema) &&
+         exec("BEGIN;") &&
+         prepare(&insert_pkg_,
+                 "INSERT INTO package VALUES(?1, ?2, ?3, ?4, ?5, ?6)") &&
+         prepare(&insert_dep_,
+                 "INSERT INTO package_dependency VALUES(?1, ?2)") &&
+         prepare(&insert_file_,
+                 "INSERT INTO file VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12)") &&
+         prepare(&insert_class_,
+                 "INSERT INTO class VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14)") &&
+         prepare(&insert_func_,
+                 "INSERT INTO function VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14,"
+                 " ?15, ?16, ?17, ?18, ?19, ?20, ?21, ?22, ?23, ?24)");
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  add
+///      \brief   Sources first, then headers, like the dump
+//==============================================================================
+bool SqliteExporter::add(Package *pkg) {
+  ULL pkg_id = ++num_pkgs_;
+  sqlite3_bind_int64(insert_pkg_, 1, pkg_id);
+  sqlite3_bind_text(insert_pkg_, 2, pkg->name(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(insert_pkg_, 3, pkg->layer());
+  sqlite3_bind_int(insert_pkg_, 4, pkg->cycle());
+  sqlite3_bind_int(insert_pkg_, 5, pkg->num_reach());
+  sqlite3_bind_int(insert_pkg_, 6, pkg->num_dependents());
+  if(!step(insert_pkg_)) {
+    return false;
+  }
+  if(pkg->id() >= pkg_rows_.size()) {
+    pkg_rows_.resize(pkg->id() + 1, 0);
+  }
+  pkg_rows_[pkg->id()] = pkg_id;
+  const ObjList &childs = pkg->getChilds();
+  Obj::ObjType types[2] = {Obj::kSourceFile, Obj::kHeaderFile};
+  for(int k=0; k<2; k++) {
+    for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+      if((*it)->type() == types[k] &&
+         !add_file(static_cast<File*>(*it), pkg_id, types[k] == Obj::kHeaderFile)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  add_dependencies
+///      \brief   Once all the packages have a row. A dependency on a package
+//                that is not exported (see SCA_CLIENT_ROOT) is left out
+//==============================================================================
+bool SqliteExporter::add_dependencies(const std::vector<Package*> &pkgs) {
+  for(size_t i=0; i<pkgs.size(); i++) {
+    const ArenaVector<PkgId> &deps = pkgs[i]->dependent_packages();
+    for(size_t k=0; k<deps.size(); k++) {
+      if(deps[k] >= pkg_rows_.size() || !pkg_rows_[deps[k]]) {
+        continue;
+      }
+      sqlite3_bind_int64(insert_dep_, 1, pkg_rows_[pkgs[i]->id()]);
+      sqlite3_bind_int64(insert_dep_, 2, pkg_rows_[deps[k]]);
+      if(!step(insert_dep_)) {
+        return false;
+      }
+      num_deps_++;
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  add_file
+///      \brief   A file with its functions and classes
+//==============================================================================
+bool SqliteExporter::add_file(File *file, ULL pkg_id, bool is_header) {
+  ULL file_id = ++num_files_;
+  sqlite3_bind_int64(insert_file_, 1, file_id);
+  sqlite3_bind_int64(insert_file_, 2, pkg_id);
+  sqlite3_bind_text(insert_file_, 3, file->name(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(insert_file_, 4, is_header);
+  sqlite3_bind_int64(insert_file_, 5, file->num_bytes());
+  sqlite3_bind_int64(insert_file_, 6, file->num_lines());
+  sqlite3_bind_int64(insert_file_, 7, file->num_tus());
+  sqlite3_bind_int64(insert_file_, 8, file->build_bytes());
+  sqlite3_bind_int64(insert_file_, 9, file->build_lines());
+  sqlite3_bind_int64(insert_file_, 10, file->closure_bytes());
+  sqlite3_bind_int64(insert_file_, 11, file->closure_lines());
+  sqlite3_bind_int64(insert_file_, 12, file->external_includes());
+  if(!step(insert_file_)) {
+    return false;
+  }
+  const ObjList &childs = file->getChilds();
+  for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+    if((*it)->type() == Obj::kFunction) {
+      if(!add_function(static_cast<Function*>(*it), pkg_id, file_id, 0)) {
+        return false;
+      }
+    } else if((*it)->type() == Obj::kClass) {
+      if(!add_class(static_cast<Class*>(*it), pkg_id, file_id)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  add_class
+///      \brief   A class with its methods
+//==============================================================================
+bool SqliteExporter::add_class(Class *cls, ULL pkg_id, ULL file_id) {
+  ULL class_id = ++num_classes_;
+  sqlite3_stmt *stmt = insert_class_;
+  sqlite3_bind_int64(stmt, 1, class_id);
+  sqlite3_bind_int64(stmt, 2, pkg_id);
+  sqlite3_bind_int64(stmt, 3, file_id);
+  sqlite3_bind_text(stmt, 4, cls->name(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 5, cls->id().line_no());
+  sqlite3_bind_int(stmt, 6, cls->width());
+  sqlite3_bind_int(stmt, 7, cls->depth());
+  sqlite3_bind_int(stmt, 8, cls->isAggregate() != 0);
+  sqlite3_bind_int(stmt, 9, cls->isCLike() != 0);
+  sqlite3_bind_int(stmt, 10, cls->isEmpty() != 0);
+  sqlite3_bind_int(stmt, 11, cls->isPolymorphic() != 0);
+  sqlite3_bind_int(stmt, 12, cls->isAbstract() != 0);
+  sqlite3_bind_int(stmt, 13, cls->isTrivial() != 0);
+  sqlite3_bind_int(stmt, 14, cls->isLiteral() != 0);
+  if(!step(stmt)) {
+    return false;
+  }
+  const ObjList &childs = cls->getChilds();
+  for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+    if((*it)->type() == Obj::kMethod &&
+       !add_function(static_cast<Function*>(*it), pkg_id, file_id, class_id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  add_function
+///      \brief   A function, or a method if "class_id" is not 0
+//==============================================================================
+bool SqliteExporter::add_function(Function *func, ULL pkg_id, ULL file_id, ULL class_id) {
+  sqlite3_stmt *stmt = insert_func_;
+  sqlite3_bind_int64(stmt, 1, ++num_funcs_);
+  sqlite3_bind_int64(stmt, 2, pkg_id);
+  sqlite3_bind_int64(stmt, 3, file_id);
+  if(class_id) {
+    Method *method = static_cast<Method*>(func);
+    sqlite3_bind_int64(stmt, 4, class_id);
+    sqlite3_bind_int(stmt, 12, method->isConst() != 0);
+    sqlite3_bind_int(stmt, 13, method->isStatic() != 0);
+    sqlite3_bind_int(stmt, 14, method->isVirtual() != 0);
+  } else {
+    sqlite3_bind_null(stmt, 4);
+    sqlite3_bind_null(stmt, 12);
+    sqlite3_bind_null(stmt, 13);
+    sqlite3_bind_null(stmt, 14);
+  }
+  sqlite3_bind_text(stmt, 5, func->name(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 6, func->id().line_no());
+  sqlite3_bind_int(stmt, 7, func->cyclomatic());
+  sqlite3_bind_int(stmt, 8, func->complexity());
+  sqlite3_bind_int(stmt, 9, func->max_nesting());
+  sqlite3_bind_int(stmt, 10, func->num_lines());
+  sqlite3_bind_int(stmt, 11, func->param_size());
+  sqlite3_bind_int(stmt, 15, func->fan_in());
+  sqlite3_bind_int(stmt, 16, func->fan_out());
+  sqlite3_bind_int(stmt, 17, func->scc());
+  sqlite3_bind_int(stmt, 18, func->num_operators());
+  sqlite3_bind_int(stmt, 19, func->num_operands());
+  sqlite3_bind_int(stmt, 20, func->unique_operators());
+  sqlite3_bind_int(stmt, 21, func->unique_operands());
+  sqlite3_bind_double(stmt, 22, func->volume());
+  sqlite3_bind_double(stmt, 23, func->difficulty());
+  sqlite3_bind_double(stmt, 24, func->effort());
+  return step(stmt);
+}
+
+//==============================================================================
+///      \class   SqliteExporter
+///      \method  close
+///      \brief   Building the indices over the sorted rows in one go is much
+//                cheaper than keeping them up to date on every insert
+//==============================================================================
+bool SqliteExporter::close(void) {
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  double start = sca_time_now();
+  if(!exec(kIndices) || !exec("COMMIT;")) {
+    return false;
+  }
+  stats.sqlite_index_time_ += sca_time_now() - start;
+  return true;
+}
+
+//==============================================================================
+///      \brief Write the packages to a new database
+//==============================================================================
+bool sca_export_sqlite(const std::vector<Package*> &pkgs, const std::string &path) {
+  SCA::Stats &stats = SCA_globals::getGlobals()->stats();
+  SqliteExporter exporter;
+  double start = sca_time_now();
+  if(!exporter.open(path)) {
+    return false;
+  }
+  for(size_t i=0; i<pkgs.size(); i++) {
+    if(!exporter.add(pkgs[i])) {
+      return false;
+    }
+  }
+  if(!exporter.add_dependencies(pkgs)) {
+    return false;
+  }
+  stats.sqlite_rows_ += exporter.num_rows();
+  stats.sqlite_insert_time_ += sca_time_now() - start;
+  return exporter.close();
+}
+
+#else
+
+//==============================================================================
+///      \brief SQLite is not built in
+//==============================================================================
+bool sca_export_sqlite(const std::vector<SCA::Package*> &pkgs, const std::string &path) {
+  fprintf(stderr, "sca: built without SQLite, rebuild with -DSCA_ENABLE_SQLITE to write %s\n",
+          path.c_str());
+  return false;
+}
+
+#endif /* SCA_ENABLE_SQLITE */
@@ -0,0 +1,63 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_sqlite.hh
+ *
+ *  \brief
+ *      Export of the analysis results to an SQLite database
+ *
+ *  \details
+ *      With --sca-sqlite=FILE the packages that are dumped are also loaded in
+ *      to a fresh SQLite database, so that dashboards can query the metrics
+ *      without reading the whole JSON. Everything is inserted in a single
+ *      transaction through prepared statements and the indices are built
+ *      once the rows are in.
+ *
+ *      package  : id, name, layer, cycle (0 if none), num_reach and
+ *                 num_dependents (packages it depends on and that depend on
+ *                 it, directly or not), see sca_packages.hh
+ *      package_dependency : package_id, depends_on_id, one row per direct
+ *                 dependency
+ *      file     : id, package_id, name, is_header, its bytes and lines,
+ *                 num_tus (TUs it is part of), build_bytes/build_lines
+ *                 (what it adds to all of them) and closure_bytes/
+ *                 closure_lines (its size with all it includes) and
+ *                 external_includes (#includes of files SCA does not track)
+ *      class    : id, package_id, file_id, name, line, width, depth and the
+ *                 is_* properties
+ *      function : id, package_id, file_id, class_id (NULL for a function
+ *                 that is not a method), name, line, the metrics, the
+ *                 is_* properties of a method, the fan_in, fan_out and
+ *                 scc (recursion cycle, 0 if none) of the call graph and the
+ *                 Halstead operators, operands, unique_operators,
+ *                 unique_operands, volume, difficulty and effort
+ *
+ *      Indexed: the package name, the package and file of every row, the
+ *      class of a method and every metric, alone and within its package
+ *      (i.e "top 50 most complex functions in package X"), the fan-in and
+ *      fan-out, the Halstead volume, difficulty and effort, the functions
+ *      that are in a cycle, the TU count, the build cost and the closure
+ *      size of the files and the layer, cycle and dependents of the
+ *      packages, with both ends of a dependency.
+ *
+ *      SQLite is an optional dependency. Build with -DSCA_ENABLE_SQLITE and
+ *      link with -lsqlite3 to get it.
+ *
+ *  \history
+ *      10/18/26 16:21:14 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_SQLITE_H
+#define SCA_SQLITE_H
+
+#include <string>
+#include <vector>
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+//--------------------------------------------------------------------------------------
+///      \brief Write the packages to a new database at "path". An existing
+///             file is replaced. Returns false on an error
+//--------------------------------------------------------------------------------------
+bool sca_export_sqlite(const std::vector<SCA::Package*> &pkgs, const std::string &path);
+
+#endif    /* SCA_SQLITE_H */
@@ -0,0 +1,322 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_stream.cc
+ *
+ *  \brief
+ *      Implementation of the streaming output
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 14:19:30 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include "sca_stream.hh"
+#include "sca_analyzer.hh"
+#include "sca_globals.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \brief Whether the records are streamed
+//==============================================================================
+bool sca_streaming(void) {
+  return SCA_GET_WRITER().format() == SCA::kFormatNdjson;
+}
+
+//==============================================================================
+///      \brief Append ,"key":"value"
+//==============================================================================
+static void field(Writer &w, const char *key, const char *val) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.str(val);
+}
+
+//==============================================================================
+///      \brief Append ,"key":value
+//==============================================================================
+static void field(Writer &w, const char *key, int val) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.num(val);
+}
+
+//==============================================================================
+///      \brief Append ,"key":value
+//==============================================================================
+static void field(Writer &w, const char *key, U val) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.num(val);
+}
+
+//==============================================================================
+///      \brief Append ,"key":value
+//==============================================================================
+static void field(Writer &w, const char *key, ULL val) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.num(val);
+}
+
+//==============================================================================
+///      \brief Append ,"key":value with two decimals
+//==============================================================================
+static void field(Writer &w, const char *key, double val) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.fixed(val);
+}
+
+//==============================================================================
+///      \brief Append ,"key":"file:line"
+//==============================================================================
+static void field(Writer &w, const char *key, const SourceId &id) {
+  w.put(',');
+  w.str(key);
+  w.put(':');
+  w.put('"');
+  w.esc(id.file_name());
+  w.put(':');
+  w.num(id.line_no());
+  w.put('"');
+}
+
+//==============================================================================
+///      \brief Start a record of the object defined in "file". Returns false
+//              if the package of the file is not of interest
+//==============================================================================
+static bool begin_record(Writer &w, const char *type, const File *file) {
+  const char *pkg_name = SCA_PKG(file->pkgId())->name();
+  if(!isPackageOfInterest(pkg_name)) {
+    return false;
+  }
+  w.put('{');
+  w.str(RecordType);
+  w.put(':');
+  w.str(type);
+  field(w, PackageName, pkg_name);
+  field(w, FileName, file->name());
+  return true;
+}
+
+//==============================================================================
+///      \brief End the record
+//==============================================================================
+static void end_record(Writer &w) {
+  w.put('}');
+  w.put('\n');
+}
+
+//==============================================================================
+///      \brief Append the metrics common to functions and methods
+//==============================================================================
+static void metrics(Writer &w, const Function *func) {
+  field(w, FunctionCyclomatic, func->cyclomatic());
+  field(w, FunctionComplexity, func->complexity());
+  field(w, FunctionMaxNesting, func->max_nesting());
+  field(w, FunctionNumLines, func->num_lines());
+  field(w, FunctionParamSize, func->param_size());
+  field(w, FunctionOperators, func->num_operators());
+  field(w, FunctionOperands, func->num_operands());
+  field(w, FunctionUniqueOperators, func->unique_operators());
+  field(w, FunctionUniqueOperands, func->unique_operands());
+  field(w, FunctionVolume, func->volume());
+  field(w, FunctionDifficulty, func->difficulty());
+  field(w, FunctionEffort, func->effort());
+  w.put(',');
+  w.str(FunctionUsr);
+  w.put(':');
+  w.put('"');
+  w.hex(func->usr());
+  w.put('"');
+  w.put(',');
+  w.str(FunctionCalls);
+  w.put(':');
+  w.put('"');
+  for(U i=0; i<func->num_callees(); i++) {
+    if(i) {
+      w.put(' ');
+    }
+    w.hex(func->callees()[i]);
+  }
+  w.put('"');
+}
+
+//==============================================================================
+///      \brief Write the record of a function
+//==============================================================================
+void sca_stream_function(const Function *func, const File *file) {
+  Writer &w = SCA_GET_WRITER();
+  if(!begin_record(w, "function", file)) {
+    return;
+  }
+  field(w, FunctionName, func->name());
+  field(w, FunctionId, func->id());
+  metrics(w, func);
+  end_record(w);
+}
+
+//==============================================================================
+///      \brief Write the record of a method. It is in the file of its class
+//==============================================================================
+void sca_stream_method(const Method *method, const Class *cls) {
+  Writer &w = SCA_GET_WRITER();
+  if(!begin_record(w, "method", static_cast<const File*>(cls->parent()))) {
+    return;
+  }
+  field(w, ClassName, cls->name());
+  field(w, MethodClassId, cls->id());
+  field(w, MethodName, method->name());
+  field(w, MethodId, method->id());
+  field(w, MethodisConstant, (int)method->isConst());
+  field(w, MethodisStatic, (int)method->isStatic());
+  field(w, MethodisVirtual, (int)method->isVirtual());
+  metrics(w, method);
+  end_record(w);
+}
+
+//==============================================================================
+///      \brief Write the record of a class
+//==============================================================================
+void sca_stream_class(const Class *cls) {
+  Writer &w = SCA_GET_WRITER();
+  if(!begin_record(w, "class", static_cast<const File*>(cls->parent()))) {
+    return;
+  }
+  field(w, ClassName, cls->name());
+  field(w, ClassIdentity, cls->id());
+  field(w, ClassisAggregate, (int)cls->isAggregate());
+  field(w, ClassisCLike, (int)cls->isCLike());
+  field(w, ClassisEmpty, (int)cls->isEmpty());
+  field(w, ClassisPolymorphic, (int)cls->isPolymorphic());
+  field(w, ClassisAbstract, (int)cls->isAbstract());
+  field(w, ClassisTrivial, (int)cls->isTrivial());
+  field(w, ClassisLiteral, (int)cls->isLiteral());
+  end_record(w);
+}
+
+//==============================================================================
+///      \brief Write the record of the size and the includes of a file
+//==============================================================================
+static void stream_file(Writer &w, const File *file) {
+  if(!begin_record(w, "file", file)) {
+    return;
+  }
+  field(w, FileBytes, file->num_bytes());
+  field(w, FileLines, file->num_lines());
+  field(w, FileNumTus, file->num_tus());
+  field(w, FileBuildBytes, file->build_bytes());
+  field(w, FileBuildLines, file->build_lines());
+  field(w, FileClosureBytes, file->closure_bytes());
+  field(w, FileClosureLines, file->closure_lines());
+  w.put(',');
+  w.str(FileIncludes);
+  w.put(':');
+  w.put('"');
+  const ArenaVector<FileId> &includes = file->direct_includes();
+  for(size_t i=0; i<includes.size(); i++) {
+    if(i) {
+      w.put(':');
+    }
+    std::string path = SCA_FILE(includes[i])->get_full_name();
+    w.esc(path.c_str(), path.size());
+  }
+  w.put('"');
+  field(w, FileExternalIncludes, file->external_includes());
+  end_record(w);
+}
+
+//==============================================================================
+///      \brief Write the record of the dependencies and the layer of a
+//              package. It has no file
+//==============================================================================
+static void stream_package(Writer &w, const Package *pkg) {
+  w.put('{');
+  w.str(RecordType);
+  w.put(':');
+  w.str("package");
+  field(w, PackageName, pkg->name());
+  w.put(',');
+  w.str(PackageDepends);
+  w.put(':');
+  w.put('"');
+  const ArenaVector<PkgId> &deps = pkg->dependent_packages();
+  for(size_t i=0; i<deps.size(); i++) {
+    if(i) {
+      w.put(':');
+    }
+    w.esc(SCA_PKG(deps[i])->name());
+  }
+  w.put('"');
+  field(w, PackageLayer, pkg->layer());
+  field(w, PackageCycle, pkg->cycle());
+  field(w, PackageReach, pkg->num_reach());
+  field(w, PackageDependents, pkg->num_dependents());
+  end_record(w);
+}
+
+//==============================================================================
+///      \brief Write the merged objects, then the width/depth of every class,
+//              the include costs of every file and the layer of every
+//              package. The functions and methods of the TUs are not in the
+//              tree, so every function or method found here is a merged one
+//==============================================================================
+void sca_stream_tree(const std::vector<Package*> &pkgs) {
+  Writer &w = SCA_GET_WRITER();
+  std::vector<Class*> classes;
+  for(size_t p=0; p<pkgs.size(); p++) {
+    const ObjList &files = pkgs[p]->getChilds();
+    for(ObjList::const_iterator f=files.begin(); f!=files.end(); f++) {
+      const File *file = static_cast<const File*>(*f);
+      const ObjList &childs = file->getChilds();
+      for(ObjList::const_iterator it=childs.begin(); it!=childs.end(); it++) {
+        if((*it)->type() == Obj::kFunction) {
+          sca_stream_function(static_cast<Function*>(*it), file);
+          continue;
+        }
+        if((*it)->type() != Obj::kClass) {
+          continue;
+        }
+        Class *cls = static_cast<Class*>(*it);
+        classes.push_back(cls);
+        if(SCA_globals::getGlobals()->markStreamed(Obj::kClass, cls->id())) {
+          sca_stream_class(cls);
+        }
+        const ObjList &methods = cls->getChilds();
+        for(ObjList::const_iterator m=methods.begin(); m!=methods.end(); m++) {
+          if((*m)->type() == Obj::kMethod) {
+            sca_stream_method(static_cast<Method*>(*m), cls);
+          }
+        }
+      }
+    }
+  }
+  for(size_t i=0; i<classes.size(); i++) {
+    const File *file = static_cast<const File*>(classes[i]->parent());
+    if(!begin_record(w, "inheritance", file)) {
+      continue;
+    }
+    field(w, ClassName, classes[i]->name());
+    field(w, ClassIdentity, classes[i]->id());
+    field(w, ClassWidth, classes[i]->width());
+    field(w, ClassDepth, classes[i]->depth());
+    end_record(w);
+  }
+  for(size_t p=0; p<pkgs.size(); p++) {
+    const ObjList &files = pkgs[p]->getChilds();
+    for(ObjList::const_iterator f=files.begin(); f!=files.end(); f++) {
+      stream_file(w, static_cast<const File*>(*f));
+    }
+  }
+  for(size_t p=0; p<pkgs.size(); p++) {
+    stream_package(w, pkgs[p]);
+  }
+}
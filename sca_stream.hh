@@ -0,0 +1,79 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_stream.hh
+ *
+ *  \brief
+ *      Streaming output, one NDJSON record per object
+ *
+ *  \details
+ *      With --sca-format=ndjson every function and method is written out as
+ *      soon as its body is walked and is not kept in the tree. A class is
+ *      written once its body is walked. It stays in the tree as the methods
+ *      and the inheritance need it. Every record is a JSON object on a line
+ *      of its own that names its package and file, with the same keys as
+ *      the JSON output plus "ssca_rec" for the kind of record.
+ *
+ *      function    : A function with its metrics
+ *      method      : A method with its metrics and its class
+ *      class       : A class with its properties
+ *      inheritance : The width/depth of a class. Known only once all the TUs
+ *                    are walked, so these come last
+ *      file        : The size and the direct includes of a file, with the
+ *                    number of TUs it is part of and what it costs them.
+ *                    Also known only at the end, these come after the
+ *                    inheritance records
+ *      package     : The packages a package depends on directly, its layer,
+ *                    cycle and transitive counts (see sca_packages.hh). These
+ *                    come last. The calls of the streamed functions are not
+ *                    resolved, so only the includes and the calls of the
+ *                    merged objects count
+ *
+ *      Objects merged from the inputs (.o files) are written at the end.
+ *
+ *      The functions are gone by the time all the calls could be resolved,
+ *      so the records have the USR hash and the callees ("ssca_u" and
+ *      "ssca_calls") but no fan-in, fan-out or cycle. The consumer builds
+ *      the call graph from them if it needs one.
+ *
+ *  \history
+ *      10/18/26 14:05:52 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_STREAM_H
+#define SCA_STREAM_H
+
+#include "sca_int.hh"
+#include "sca_utils.hh"
+
+/// The kind of the record
+#define RecordType "ssca_rec"
+/// The class of a method record
+#define MethodClassId "ssca_ci"
+
+//--------------------------------------------------------------------------------------
+///      \brief Whether the records are streamed i.e --sca-format=ndjson
+//--------------------------------------------------------------------------------------
+bool sca_streaming(void);
+
+//--------------------------------------------------------------------------------------
+///      \brief Write the record of a function defined in "file"
+//--------------------------------------------------------------------------------------
+void sca_stream_function(const SCA::Function *func, const SCA::File *file);
+
+//--------------------------------------------------------------------------------------
+///      \brief Write the record of a method of "cls"
+//--------------------------------------------------------------------------------------
+void sca_stream_method(const SCA::Method *method, const SCA::Class *cls);
+
+//--------------------------------------------------------------------------------------
+///      \brief Write the record of a class
+//--------------------------------------------------------------------------------------
+void sca_stream_class(const SCA::Class *cls);
+
+//--------------------------------------------------------------------------------------
+///      \brief Write what is left in the tree once all the TUs are walked i.e
+///             the merged inputs, the inheritance, file and package records
+//--------------------------------------------------------------------------------------
+void sca_stream_tree(const std::vector<SCA::Package*> &pkgs);
+
+#endif    /* SCA_STREAM_H */
@@ -12,11 +12,25 @@
  *      06/06/14 03:08:27 PDT Created By Prakash S
  *
  *  ----------------------------------------------------------*/
+#include <math.h>
+#include <sys/time.h>
 #include "sca_utils.hh"
 #include "sca_globals.hh"
 
 using namespace SCA;
 
+//==============================================================================
+///      \class   SourceId
+///      \method  file_name
+///      \brief   Full path of the file of the id
+//==============================================================================
+const char* SourceId::file_name(void) const {
+  if(file_id() == INVALID_FILE_ID) {
+    return "";
+  }
+  return FileIdMgr::getFileIdMgr()->getFileName(file_id());
+}
+
 //==============================================================================
 ///      \brief Split the given path in fo dir and base names
 //==============================================================================
@@ -49,11 +63,150 @@ void split_path(const std::string &ip,
   } 
 }
 
+const unsigned char kBitIndex[64] = {
+   0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+  62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+  63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+  46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+};
+
+//==============================================================================
+///     \brief 64 bit FNV-1a hash of "len" bytes
+//==============================================================================
+ULL hash_bytes(const void *data, size_t len, ULL seed) {
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  ULL hash = seed;
+  for(size_t i=0; i<len; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//==============================================================================
+///      \class   Arena
+///      \method  alloc_slow
+///      \brief   Start a new block. Big allocations get a block of their own
+//                so that the current block is not wasted
+//==============================================================================
+void* Arena::alloc_slow(size_t size) {
+  if(size > kBlockSize / 4) {
+    char *block = static_cast<char*>(malloc(size));
+    blocks_.push_back(block);
+    return block;
+  }
+  char *block = static_cast<char*>(malloc(kBlockSize));
+  blocks_.push_back(block);
+  cur_ = block + size;
+  end_ = block + kBlockSize;
+  return block;
+}
+
+//==============================================================================
+///      \class   Arena
+///      \method  release
+///      \brief   Give back all the blocks
+//==============================================================================
+void Arena::release(void) {
+  for(size_t i=0; i<blocks_.size(); i++) {
+    free(blocks_[i]);
+  }
+  blocks_.clear();
+  cur_        = NULL;
+  end_        = NULL;
+  num_allocs_ = 0;
+  num_bytes_  = 0;
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method
+///      \brief   Constructor
+//==============================================================================
+StringTable::StringTable(void) {
+  slots_.resize(1024, 0);
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method  slot
+///      \brief   Linear probe for the string
+//==============================================================================
+size_t StringTable::slot(const char *str, size_t len) const {
+  size_t mask = slots_.size() - 1;
+  size_t slot = hash_bytes(str, len) & mask;
+  while(slots_[slot]) {
+    U id = slots_[slot] - 1;
+    if(lengths_[id] == len && !memcmp(names_[id], str, len)) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method  grow
+///      \brief   Double the slots and rehash all the strings
+//==============================================================================
+void StringTable::grow(void) {
+  std::vector<U> slots(2 * slots_.size(), 0);
+  slots_.swap(slots);
+  for(U id=0; id<names_.size(); id++) {
+    slots_[slot(names_[id], lengths_[id])] = id + 1;
+  }
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method  intern
+///      \brief   Id of the string, adding it if needed
+//==============================================================================
+U StringTable::intern(const char *str, size_t len) {
+  size_t cur = slot(str, len);
+  if(slots_[cur]) {
+    return slots_[cur] - 1;
+  }
+  U id = names_.size();
+  char *copy = static_cast<char*>(chars_.alloc(len + 1));
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  names_.push_back(copy);
+  lengths_.push_back(len);
+  slots_[cur] = id + 1;
+  if(2 * names_.size() > slots_.size()) {
+    grow();
+  }
+  return id;
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method  find
+///      \brief   Id of the string or (U)-1 if it is not in the table
+//==============================================================================
+U StringTable::find(const char *str, size_t len) const {
+  return slots_[slot(str, len)] - 1;
+}
+
+//==============================================================================
+///      \class   StringTable
+///      \method  clear
+///      \brief   Drop all the strings
+//==============================================================================
+void StringTable::clear(void) {
+  names_.clear();
+  lengths_.clear();
+  chars_.release();
+  slots_.assign(1024, 0);
+}
+
 //==============================================================================
 ///     \brief Tells if it is a header/source file
 //==============================================================================
-File::FileType getType(std::string &file_name) {
-  if(file_name[file_name.size() - 4] == '.') {
+File::FileType getType(const std::string &file_name) {
+  if(file_name.size() > 4 && file_name[file_name.size() - 4] == '.') {
     // Of the form .cxx, .hxx, .c++, .h++, .cpp, .hpp
     if(file_name[file_name.size() - 3] == 'c') {
       return SCA::File::kSource;
@@ -62,7 +215,7 @@ File::FileType getType(std::string &file_name) {
     } else {
       return SCA::File::kUnknown;
     }
-  } else if(file_name[file_name.size() - 3] == '.') {
+  } else if(file_name.size() > 3 && file_name[file_name.size() - 3] == '.') {
     // Of the form .cc, .hh
     if(file_name[file_name.size() - 2] == 'c') {
       return SCA::File::kSource;
@@ -71,7 +224,7 @@ File::FileType getType(std::string &file_name) {
     } else {
       return SCA::File::kUnknown;
     }
-  } else if(file_name[file_name.size() - 2] == '.') {
+  } else if(file_name.size() > 2 && file_name[file_name.size() - 2] == '.') {
     // Of the form .c, .h
     if(file_name[file_name.size() - 1] == 'c') {
       return SCA::File::kSource;
@@ -89,6 +242,15 @@ File::FileType getType(std::string &file_name) {
   }
 }
 
+//--------------------------------------------------------------------------------------
+///      \brief Wall clock time in seconds
+//--------------------------------------------------------------------------------------
+double sca_time_now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
 //--------------------------------------------------------------------------------------
 ///      \brief Get absoulte path from relative path
 //--------------------------------------------------------------------------------------
@@ -99,44 +261,218 @@ void getAbsolutePathFromRelativePath(const char* relative, char* absolute){
 }
 
 //--------------------------------------------------------------------------------------
-///      \brief Get SCA::File from CXCursor
+///      \brief What the TU knows about the file. The path is resolved once per
+///             TU here and once per process in SCA_globals::realPath
 //--------------------------------------------------------------------------------------
-SCA::File* getFileFromCursor(CXCursor cursor) {
-  CXSourceLocation sl = clang_getCursorLocation(cursor);
-  CXFile file;
-  unsigned line_num, col_num, offset;
-  clang_getFileLocation(sl, &file, &line_num, &col_num, &offset);
-  const char* c_file = clang_getCString(clang_getFileName(file));    
-  if(c_file) {
-    char real_path[1024];
-    getAbsolutePathFromRelativePath(c_file, real_path);
-    FileId file_id = FileIdMgr::getFileIdMgr()->insertFile(std::string(real_path)); 
-    if(file_id != INVALID_FILE_ID) {
-      return SCA_FILE(file_id);
-    } else {
-      return NULL;
-    }
+SCA::FileVisit* resolveFile(CXFile file, SCA::Context *cntxt) {
+  if(NULL == file) {
+    return NULL;
+  }
+  cntxt->file_lookups_++;
+  std::map<CXFile, SCA::FileVisit>::iterator it = cntxt->files_.find(file);
+  if(it != cntxt->files_.end()) {
+    return &it->second;
+  }
+  SCA::FileVisit &visit = cntxt->files_[file];
+  visit.path_ = SCA_globals::getGlobals()->realPath(file);
+  visit.type_ = getType(visit.path_);
+  if(visit.type_ != SCA::File::kSource && visit.type_ != SCA::File::kHeader) {
+    // SCA does not track it (i.e <vector>) and would drop its definitions
+    visit.pruned_ = true;
   } else {
+    // Walked by an earlier TU of the session
+    FileId id = FileIdMgr::getFileIdMgr()->getFileId(visit.path_);
+    visit.pruned_ = (id != INVALID_FILE_ID) && 
+                    SCA_globals::getGlobals()->isFileAnalyzed(id);
+  }
+  return &visit;
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Get SCA::File from CXFile, inserting it in the tree if needed
+//--------------------------------------------------------------------------------------
+SCA::File* getFileFromCXFile(CXFile file, SCA::Context *cntxt) {
+  SCA::FileVisit *visit = resolveFile(file, cntxt);
+  if(NULL == visit) {
     return NULL;
   }
+  if(NULL == visit->file_ &&
+     (visit->type_ == SCA::File::kSource || visit->type_ == SCA::File::kHeader)) {
+    FileId file_id = FileIdMgr::getFileIdMgr()->insertFile(visit->path_); 
+    if(file_id != INVALID_FILE_ID) {
+      visit->file_ = SCA_FILE(file_id);
+    }
+  }
+  return visit->file_;
 }
 
 //--------------------------------------------------------------------------------------
-///      \brief Geti SourceId from the SourceLocation
+///      \brief Tokenize the contents of the file in the TU. Lexing the file
+///             once is much cheaper than a clang_tokenize per function,
+///             which would lex a header again for every inline function in
+///             it. The spellings are read from the contents, without a
+///             CXString per token. A closing bracket is part of the operator
+///             opened by its pair and is left out, so are the comments
 //--------------------------------------------------------------------------------------
-SourceId getSourceIdFromSourceLocation(CXSourceLocation sl) {
+static size_t tokenizeContents(CXTranslationUnit tu, CXFile file,
+                               const char *data, size_t size,
+                               SCA::FileVisit *visit) {
+  CXSourceRange range = clang_getRange(clang_getLocationForOffset(tu, file, 0),
+                                       clang_getLocationForOffset(tu, file, size));
+  CXToken *tokens = NULL;
+  unsigned num_tokens = 0;
+  clang_tokenize(tu, range, &tokens, &num_tokens);
+  visit->lexemes_.reserve(num_tokens);
+  for(unsigned i=0; i<num_tokens; i++) {
+    CXTokenKind kind = clang_getTokenKind(tokens[i]);
+    if(CXToken_Comment == kind) {
+      continue;
+    }
+    CXSourceRange extent = clang_getTokenExtent(tu, tokens[i]);
+    unsigned start, end;
+    clang_getFileLocation(clang_getRangeStart(extent), NULL, NULL, NULL, &start);
+    clang_getFileLocation(clang_getRangeEnd(extent), NULL, NULL, NULL, &end);
+    if(start >= end || end > size) {
+      continue;
+    }
+    if(CXToken_Punctuation == kind && end - start == 1 &&
+       (data[start] == ')' || data[start] == ']' || data[start] == '}')) {
+      continue;
+    }
+    SCA::Lexeme lexeme;
+    lexeme.hash_   = hash_bytes(data + start, end - start);
+    lexeme.offset_ = start;
+    lexeme.kind_   = (CXToken_Punctuation == kind || CXToken_Keyword == kind) ?
+                     SCA::Lexeme::kOperator : SCA::Lexeme::kOperand;
+    visit->lexemes_.push_back(lexeme);
+  }
+  clang_disposeTokens(tu, tokens, num_tokens);
+  return visit->lexemes_.size();
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Tokenize the file in a TU of its own. The includes are not
+///             followed and nothing is reported, only the tokens are needed
+//--------------------------------------------------------------------------------------
+static size_t tokenizeFileAlone(CXFile file, SCA::FileVisit *visit,
+                                const std::vector<std::string> &lex_args) {
+  CXString cx_name = clang_getFileName(file);
+  std::string name(clang_getCString(cx_name) ? clang_getCString(cx_name) : "");
+  clang_disposeString(cx_name);
+  std::vector<const char*> c_args;
+  for(size_t i=0; i<lex_args.size(); i++) {
+    c_args.push_back(lex_args[i].c_str());
+  }
+  CXIndex idx = clang_createIndex(0, 0);
+  CXTranslationUnit tu = clang_parseTranslationUnit(idx, name.c_str(),
+                                                    c_args.empty() ? NULL : &c_args[0],
+                                                    c_args.size(),
+                                                    NULL, 0,
+                                                    CXTranslationUnit_SingleFileParse |
+                                                    CXTranslationUnit_Incomplete);
+  size_t num_lexemes = 0;
+  if(tu) {
+    CXFile alone = clang_getFile(tu, name.c_str());
+    size_t size = 0;
+    const char *data = alone ? clang_getFileContents(tu, alone, &size) : NULL;
+    if(data) {
+      num_lexemes = tokenizeContents(tu, alone, data, size, visit);
+    }
+    clang_disposeTranslationUnit(tu);
+  }
+  clang_disposeIndex(idx);
+  return num_lexemes;
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Tokenize the whole file. A PCH keeps no buffer for the files
+///             in it, so those are read again from the disk
+//--------------------------------------------------------------------------------------
+size_t tokenizeFile(CXTranslationUnit tu, CXFile file, SCA::FileVisit *visit,
+                    const std::vector<std::string> &lex_args) {
+  visit->lexed_ = true;
+  size_t size = 0;
+  const char *data = clang_getFileContents(tu, file, &size);
+  if(NULL == data) {
+    return tokenizeFileAlone(file, visit, lex_args);
+  }
+  return tokenizeContents(tu, file, data, size, visit);
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Only the language and the standard change the tokens. A
+///             header is lexed as the language of the source
+//--------------------------------------------------------------------------------------
+void getLexArgs(const std::string &source, const std::vector<std::string> &args,
+                std::vector<std::string> &lex_args) {
+  lex_args.clear();
+  for(size_t i=0; i<args.size(); i++) {
+    if(!args[i].compare(0, 5, "-std=")) {
+      lex_args.push_back(args[i]);
+    }
+  }
+  size_t len = source.size();
+  bool c_source = (len > 2 && source[len-2] == '.' && source[len-1] == 'c');
+  lex_args.push_back("-x");
+  lex_args.push_back(c_source ? "c" : "c++");
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Get SCA::File from CXCursor
+//--------------------------------------------------------------------------------------
+SCA::File* getFileFromCursor(CXCursor cursor, SCA::Context *cntxt) {
+  CXSourceLocation sl = clang_getCursorLocation(cursor);
   CXFile file;
-  unsigned line_num, col_num, offset;
-  clang_getFileLocation(sl, &file, &line_num, &col_num, &offset);
-  return SourceId(clang_getCString(clang_getFileName(file)), line_num);
+  clang_getFileLocation(sl, &file, NULL, NULL, NULL);
+  return getFileFromCXFile(file, cntxt);
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Geti SourceId from the SourceLocation. The id of a file SCA
+///             does not track has no FileId and matches nothing in the tree
+//--------------------------------------------------------------------------------------
+SourceId getSourceIdFromSourceLocation(CXSourceLocation sl, SCA::Context *cntxt) {
+  CXFile file;
+  unsigned line_num;
+  clang_getFileLocation(sl, &file, &line_num, NULL, NULL);
+  SCA::File *sca_file = getFileFromCXFile(file, cntxt);
+  return SourceId(sca_file ? sca_file->id() : INVALID_FILE_ID, line_num);
 }
 
 //--------------------------------------------------------------------------------------
 ///      \brief Geti SourceId from the CXCursor
 //--------------------------------------------------------------------------------------
-SourceId getSourceIdFromCursor(CXCursor cursor) {
+SourceId getSourceIdFromCursor(CXCursor cursor, SCA::Context *cntxt) {
   CXSourceLocation sl = clang_getCursorLocation(cursor);
-  return getSourceIdFromSourceLocation(sl);
+  return getSourceIdFromSourceLocation(sl, cntxt);
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Spelling of the cursor. The CXString is disposed
+//--------------------------------------------------------------------------------------
+std::string getCursorSpelling(CXCursor cursor) {
+  CXString spelling = clang_getCursorSpelling(cursor);
+  const char *c_spelling = clang_getCString(spelling);
+  std::string str(c_spelling ? c_spelling : "");
+  clang_disposeString(spelling);
+  return str;
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Number of lines of the text, one memchr per line
+//--------------------------------------------------------------------------------------
+U countLines(const char *data, size_t size) {
+  const char *end = data + size;
+  U num_lines = 0;
+  while(data < end) {
+    const char *nl = static_cast<const char*>(memchr(data, '\n', end - data));
+    num_lines++;
+    if(NULL == nl) {
+      break;
+    }
+    data = nl + 1;
+  }
+  return num_lines;
 }
 
 //--------------------------------------------------------------------------------------
@@ -144,15 +480,44 @@ SourceId getSourceIdFromCursor(CXCursor cursor) {
 //--------------------------------------------------------------------------------------
 U getLineScopeFromCursor(CXCursor cursor) {
   CXSourceRange sr = clang_getCursorExtent(cursor);
-  SourceId start_id = getSourceIdFromSourceLocation(clang_getRangeStart(sr));
-  SourceId end_id = getSourceIdFromSourceLocation(clang_getRangeEnd(sr));
-  return (end_id.line_no() - start_id.line_no() + 1);
+  unsigned start_line, end_line;
+  // Only the lines are needed, the file name need not be interned
+  clang_getFileLocation(clang_getRangeStart(sr), NULL, &start_line, NULL, NULL);
+  clang_getFileLocation(clang_getRangeEnd(sr), NULL, &end_line, NULL, NULL);
+  return (end_line - start_line + 1);
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Hash of the USR of the cursor, 0 if it has none
+//--------------------------------------------------------------------------------------
+ULL getUsrHashFromCursor(CXCursor cursor) {
+  CXString usr = clang_getCursorUSR(cursor);
+  const char *c_usr = clang_getCString(usr);
+  ULL hash = (c_usr && *c_usr) ? hash_bytes(c_usr, strlen(c_usr)) : 0;
+  clang_disposeString(usr);
+  return hash;
+}
+
+//--------------------------------------------------------------------------------------
+///      \brief Whether the TU has any diagnostic at or above "severity"
+//--------------------------------------------------------------------------------------
+bool hasDiagnostics(CXTranslationUnit TU, CXDiagnosticSeverity severity) {
+  unsigned num_diags = clang_getNumDiagnostics(TU);
+  for(unsigned i=0; i<num_diags; i++) {
+    CXDiagnostic diag = clang_getDiagnostic(TU, i);
+    bool found = (clang_getDiagnosticSeverity(diag) >= severity);
+    clang_disposeDiagnostic(diag);
+    if(found) {
+      return true;
+    }
+  }
+  return false;
 }
 
 //==============================================================================
 ///      \brief Tells if the file is a header file/source file/object file
 //==============================================================================
-bool isFileOfInterest(std::string &file_name) {
+bool isFileOfInterest(const std::string &file_name) {
   return (getType(file_name) != SCA::File::kUnknown);
 }
  
@@ -194,6 +559,13 @@ Class::Class(FileId &id, const std::string &a_name, ClassId &cid) :
   id_    = cid;
   width_ = -1;
   depth_ = -1;
+  isAggregate_   = 0;
+  isCLike_       = 0;
+  isEmpty_       = 0;
+  isPolymorphic_ = 0;
+  isAbstract_    = 0;
+  isTrivial_     = 0;
+  isLiteral_     = 0;
   inherited_to_.clear();
 }
 
@@ -207,6 +579,13 @@ Class::Class(File *file, const std::string &a_name, ClassId &cid) :
   id_    = cid;
   width_ = -1;
   depth_ = -1;
+  isAggregate_   = 0;
+  isCLike_       = 0;
+  isEmpty_       = 0;
+  isPolymorphic_ = 0;
+  isAbstract_    = 0;
+  isTrivial_     = 0;
+  isLiteral_     = 0;
   inherited_to_.clear();
 }
 
@@ -233,6 +612,13 @@ File::File(PkgId &pkg_id,
       Obj(SCA_PKG(pkg_id), a_type, a_file_name), 
           fileId_(a_id), 
           type_(a_type) { 
+  external_includes_ = 0;
+  num_bytes_     = 0;
+  num_lines_     = 0;
+  measured_      = false;
+  num_tus_       = 0;
+  closure_bytes_ = 0;
+  closure_lines_ = 0;
 }
 
 //==============================================================================
@@ -247,6 +633,13 @@ File::File(Package *pkg,
       Obj(pkg, a_type, a_file_name), 
       fileId_(a_id), 
       type_(a_type) { 
+  external_includes_ = 0;
+  num_bytes_     = 0;
+  num_lines_     = 0;
+  measured_      = false;
+  num_tus_       = 0;
+  closure_bytes_ = 0;
+  closure_lines_ = 0;
 }
 
 //==============================================================================
@@ -266,7 +659,9 @@ PkgId File::pkgId(void) const {
 ///      \brief   Inserts the file "id" as dircet include of current file
 //==============================================================================
 void File::insert_direct_include(FileId id) {
-  direct_includes_.insert(id); 
+  if(!direct_includes_.contains(id)) {
+    direct_includes_.push_back(id); 
+  }
 }
 
 //==============================================================================
@@ -279,10 +674,28 @@ std::string File::get_full_name(void) {
   if(full_name.size()) {
     full_name += "/";
   }
-  full_name += name_.c_str();
+  full_name += name_;
   return full_name;
 }
 
+//==============================================================================
+///      \class   File
+///      \method  isDumped
+///      \brief   See SCA_globals::set_dump_filter
+//==============================================================================
+bool File::isDumped(void) const {
+  return SCA_globals::getGlobals()->isDumped(fileId_);
+}
+
+//==============================================================================
+///      \class   Method
+///      \method  isDumped
+///      \brief   A method can be defined in another file than its class
+//==============================================================================
+bool Method::isDumped(void) const {
+  return SCA_globals::getGlobals()->isDumped(id().file_id());
+}
+
 //#############################################################################
 //ALL DUMP ROUTINES FOLLOW THIS LINE 
 //#############################################################################
@@ -294,15 +707,43 @@ std::string File::get_full_name(void) {
 //==============================================================================
 
 void Package::dump(bool isLast) {
-  fprintf(SCA_GET_WRITE_PTR(), "    {\n");
-  fprintf(SCA_GET_WRITE_PTR(), "       \"%s\" : \"%s\",\n", PackageName, name_.c_str());
-  fprintf(SCA_GET_WRITE_PTR(), "       \"%s\" : [\n", PackageSourceFile);
+  SCA::Writer &w = SCA_GET_WRITER();
+  w.line("    ", "{");
+  w.key("       ", PackageName, " : ");
+  w.str(name_);
+  w.end(",");
+  // The full names, as the ids are not the same in another run
+  w.key("       ", PackageDepends, " : ");
+  w.put('"');
+  for(size_t i=0; i<dependent_packages_.size(); i++) {
+    if(i) {
+      w.put(':');
+    }
+    w.esc(SCA_PKG(dependent_packages_[i])->name());
+  }
+  w.put('"');
+  w.end(",");
+  w.key("       ", PackageLayer, "    : ");
+  w.num(layer_);
+  w.end(",");
+  w.key("       ", PackageCycle, "    : ");
+  w.num(cycle_);
+  w.end(",");
+  w.key("       ", PackageReach, "    : ");
+  w.num(num_reach_);
+  w.end(",");
+  w.key("       ", PackageDependents, "   : ");
+  w.num(num_dependents_);
+  w.end(",");
+  w.key("       ", PackageSourceFile, " : ");
+  w.end("[");
   Obj::dump(Obj::kSourceFile); // Array of surce files
-  fprintf(SCA_GET_WRITE_PTR(), "               ],\n");
-  fprintf(SCA_GET_WRITE_PTR(), "       \"%s\" : [\n", PackageHeaderFile);
+  w.line("               ", "],");
+  w.key("       ", PackageHeaderFile, " : ");
+  w.end("[");
   Obj::dump(Obj::kHeaderFile); // Array of header files
-  fprintf(SCA_GET_WRITE_PTR(), "               ]\n");
-  fprintf(SCA_GET_WRITE_PTR(), "    }%s\n", (isLast ? "" : ","));
+  w.line("               ", "]");
+  w.line("    ", (isLast ? "}" : "},"));
 }
 
 //==============================================================================
@@ -311,15 +752,56 @@ void Package::dump(bool isLast) {
 ///      \brief  
 //==============================================================================
 void File::dump(bool isLast) {
-  fprintf(SCA_GET_WRITE_PTR(), "          {\n");
-  fprintf(SCA_GET_WRITE_PTR(), "            \"%s\": \"%s\",\n", FileName, name_.c_str());
-  fprintf(SCA_GET_WRITE_PTR(), "            \"%s\" : [\n", FileFunction);
+  SCA::Writer &w = SCA_GET_WRITER();
+  w.line("          ", "{");
+  w.key("            ", FileName, ": ");
+  w.str(name_);
+  w.end(",");
+  w.key("            ", FileBytes, "      : ");
+  w.num(num_bytes_);
+  w.end(",");
+  w.key("            ", FileLines, "      : ");
+  w.num(num_lines_);
+  w.end(",");
+  w.key("            ", FileNumTus, "    : ");
+  w.num(num_tus_);
+  w.end(",");
+  w.key("            ", FileBuildBytes, "      : ");
+  w.num(build_bytes());
+  w.end(",");
+  w.key("            ", FileBuildLines, "      : ");
+  w.num(build_lines());
+  w.end(",");
+  w.key("            ", FileClosureBytes, "      : ");
+  w.num(closure_bytes_);
+  w.end(",");
+  w.key("            ", FileClosureLines, "      : ");
+  w.num(closure_lines_);
+  w.end(",");
+  // The full paths, as the included file may be in another package
+  w.key("            ", FileIncludes, "     : ");
+  w.put('"');
+  for(size_t i=0; i<direct_includes_.size(); i++) {
+    if(i) {
+      w.put(':');
+    }
+    std::string path = SCA_FILE(direct_includes_[i])->get_full_name();
+    w.esc(path.c_str(), path.size());
+  }
+  w.put('"');
+  w.end(",");
+  w.key("            ", FileExternalIncludes, "     : ");
+  w.num(external_includes_);
+  w.end(",");
+  w.key("            ", FileFunction, " : ");
+  w.end("[");
   Obj::dump(Obj::kFunction); //Array of functions
-  fprintf(SCA_GET_WRITE_PTR(), "                       ],\n");
-  fprintf(SCA_GET_WRITE_PTR(), "            \"%s\" : [\n", FileClass);
+  w.line("                       ", "],");
+  w.key("            ", FileClass, " : ");
+  w.end("[");
   Obj::dump(Obj::kClass);  // Array of classes
-  fprintf(SCA_GET_WRITE_PTR(), "                    ]\n");
-  fprintf(SCA_GET_WRITE_PTR(), "          }%s\n", (isLast ? "" : ","));
+  w.line("                    ", "]");
+  w.line("          ", (isLast ? "}" : "},"));
 }
 
 //==============================================================================
@@ -340,28 +822,63 @@ void HeaderFile::dump(Obj::ObjType type, bool isLast) {
     File::dump(isLast);
 }
 
+//==============================================================================
+///      \brief Append the "file:line" of the id as a string
+//==============================================================================
+static void dump_source_id(SCA::Writer &w, const SourceId &id) {
+  w.put('"');
+  w.esc(id.file_name());
+  w.put(':');
+  w.num(id.line_no());
+  w.put('"');
+}
+
 //==============================================================================
 ///      \class   
 ///      \method  
 ///      \brief  
 //==============================================================================
 void Class::dump(Obj::ObjType type, bool isLast) {
-  fprintf(SCA_GET_WRITE_PTR(), "              {\n");
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\": \"%s\",\n", ClassName, name_.c_str());
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"   : \"%s:%lld\",\n", ClassIdentity, id_.file_name().c_str(), id_.line_no());
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"   : %d,\n", ClassWidth, width_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"   : %d,\n", ClassDepth, depth_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\": %d,\n", ClassisAggregate, isAggregate_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", ClassisCLike, isCLike_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", ClassisEmpty, isEmpty_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", ClassisPolymorphic, isPolymorphic_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\": %d,\n", ClassisAbstract, isAbstract_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", ClassisTrivial, isTrivial_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", ClassisLiteral, isLiteral_);
-  fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : [\n", ClassMethod);
+  SCA::Writer &w = SCA_GET_WRITER();
+  w.line("              ", "{");
+  w.key("                ", ClassName, ": ");
+  w.str(name_);
+  w.end(",");
+  w.key("                ", ClassIdentity, "   : ");
+  dump_source_id(w, id_);
+  w.end(",");
+  w.key("                ", ClassWidth, "   : ");
+  w.num(width_);
+  w.end(",");
+  w.key("                ", ClassDepth, "   : ");
+  w.num(depth_);
+  w.end(",");
+  w.key("                ", ClassisAggregate, ": ");
+  w.num(isAggregate_);
+  w.end(",");
+  w.key("                ", ClassisCLike, " : ");
+  w.num(isCLike_);
+  w.end(",");
+  w.key("                ", ClassisEmpty, " : ");
+  w.num(isEmpty_);
+  w.end(",");
+  w.key("                ", ClassisPolymorphic, " : ");
+  w.num(isPolymorphic_);
+  w.end(",");
+  w.key("                ", ClassisAbstract, ": ");
+  w.num(isAbstract_);
+  w.end(",");
+  w.key("                ", ClassisTrivial, " : ");
+  w.num(isTrivial_);
+  w.end(",");
+  w.key("                ", ClassisLiteral, " : ");
+  w.num(isLiteral_);
+  w.end(",");
+  w.key("                ", ClassMethod, " : ");
+  w.end("[");
   Obj::dump(Obj::kMethod);
-  fprintf(SCA_GET_WRITE_PTR(), "                         ]\n");
-  fprintf(SCA_GET_WRITE_PTR(), "              }%s\n", (isLast ? "" : ","));
+  w.line("                         ", "]");
+  w.line("              ", (isLast ? "}" : "},"));
 }
 
 //==============================================================================
@@ -370,23 +887,124 @@ void Class::dump(Obj::ObjType type, bool isLast) {
 ///      \brief  
 //==============================================================================
 void Function::dump(bool isLast) {
+  SCA::Writer &w = SCA_GET_WRITER();
+  // The metrics of a method are nested one level deeper
+  const char *indent = "                    ";
   if(this->type() == Obj::kFunction) {
-    fprintf(SCA_GET_WRITE_PTR(), "              {\n");
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\": \"%s\",\n", FunctionName, name_.c_str());
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"   : \"%s:%lld\",\n", FunctionId, id_.file_name().c_str(), id_.line_no());
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", FunctionCyclomatic, cyclomatic_);
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\" : %d,\n", FunctionComplexity, complexity_);
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"  : %d,\n", FunctionMaxNesting, max_nesting_);
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"  : %d,\n", FunctionNumLines, num_lines_);
-    fprintf(SCA_GET_WRITE_PTR(), "                \"%s\"  : %d\n", FunctionParamSize, param_size_);
-    fprintf(SCA_GET_WRITE_PTR(), "              }%s\n", (isLast ? "" : ","));
-  } else {
-    fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\" : %d,\n", FunctionCyclomatic, cyclomatic_);
-    fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\" : %d,\n", FunctionComplexity, complexity_);
-    fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\"  : %d,\n", FunctionMaxNesting, max_nesting_);
-    fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\"  : %d,\n", FunctionNumLines, num_lines_);
-    fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\"  : %d\n", FunctionParamSize, param_size_);
+    indent = "                ";
+    w.line("              ", "{");
+    w.key(indent, FunctionName, ": ");
+    w.str(name_);
+    w.end(",");
+    w.key(indent, FunctionId, "   : ");
+    dump_source_id(w, id_);
+    w.end(",");
+  }
+  w.key(indent, FunctionCyclomatic, " : ");
+  w.num(cyclomatic_);
+  w.end(",");
+  w.key(indent, FunctionComplexity, " : ");
+  w.num(complexity_);
+  w.end(",");
+  w.key(indent, FunctionMaxNesting, "  : ");
+  w.num(max_nesting_);
+  w.end(",");
+  w.key(indent, FunctionNumLines, "  : ");
+  w.num(num_lines_);
+  w.end(",");
+  w.key(indent, FunctionParamSize, "  : ");
+  w.num(param_size_);
+  w.end(",");
+  w.key(indent, FunctionFanIn, " : ");
+  w.num(fan_in_);
+  w.end(",");
+  w.key(indent, FunctionFanOut, ": ");
+  w.num(fan_out_);
+  w.end(",");
+  w.key(indent, FunctionScc, " : ");
+  w.num(scc_);
+  w.end(",");
+  w.key(indent, FunctionOperators, " : ");
+  w.num(num_operators_);
+  w.end(",");
+  w.key(indent, FunctionOperands, " : ");
+  w.num(num_operands_);
+  w.end(",");
+  w.key(indent, FunctionUniqueOperators, " : ");
+  w.num(unique_operators_);
+  w.end(",");
+  w.key(indent, FunctionUniqueOperands, " : ");
+  w.num(unique_operands_);
+  w.end(",");
+  w.key(indent, FunctionVolume, ": ");
+  w.fixed(volume());
+  w.end(",");
+  w.key(indent, FunctionDifficulty, ": ");
+  w.fixed(difficulty());
+  w.end(",");
+  w.key(indent, FunctionEffort, ": ");
+  w.fixed(effort());
+  w.end(",");
+  w.key(indent, FunctionUsr, "   : ");
+  w.put('"');
+  w.hex(usr_);
+  w.put('"');
+  w.end(",");
+  w.key(indent, FunctionCalls, ": ");
+  w.put('"');
+  for(U i=0; i<num_callees_; i++) {
+    if(i) {
+      w.put(' ');
+    }
+    w.hex(callees_[i]);
+  }
+  w.put('"');
+  w.end("");
+  if(this->type() == Obj::kFunction) {
+    w.line("              ", (isLast ? "}" : "},"));
+  }
+}
+
+//==============================================================================
+///      \class   Function
+///      \method  volume
+///      \brief   Bits to write the function down, (N1 + N2) * log2(n1 + n2)
+//==============================================================================
+double Function::volume(void) const {
+  U vocabulary = unique_operators_ + unique_operands_;
+  if(vocabulary < 2) {
+    return 0;
+  }
+  return (double)(num_operators_ + num_operands_) * log((double)vocabulary) / log(2.0);
+}
+
+//==============================================================================
+///      \class   Function
+///      \method  difficulty
+///      \brief   (n1 / 2) * (N2 / n2), how hard the function is to write or
+//                read
+//==============================================================================
+double Function::difficulty(void) const {
+  if(0 == unique_operands_) {
+    return 0;
+  }
+  return (unique_operators_ / 2.0) * ((double)num_operands_ / unique_operands_);
+}
+
+//==============================================================================
+///      \class   Function
+///      \method  set_callees
+///      \brief   The callees are copied once the function is walked, so they
+//                take no more room than they need
+//==============================================================================
+void Function::set_callees(const ULL *usrs, U count, Arena &arena) {
+  ULL *callees = NULL;
+  if(count) {
+    callees = static_cast<ULL*>(arena.alloc(count * sizeof(ULL)));
+    memcpy(callees, usrs, count * sizeof(ULL));
   }
+  callees_     = callees;
+  num_callees_ = count;
 }
 
 //==============================================================================
@@ -404,12 +1022,25 @@ void Function::dump(Obj::ObjType type, bool isLast) {
 ///      \brief  
 //==============================================================================
 void Method::dump(Obj::ObjType type, bool isLast) {
-  fprintf(SCA_GET_WRITE_PTR(), "                  { \n");
-  fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\": \"%s\",\n",MethodName, name_.c_str());
-  fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\"   : \"%s:%lld\",\n", MethodId, id_.file_name().c_str(), id_.line_no());
-  fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\": %d,\n", MethodisConstant, isConst_);
-  fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\": %d,\n", MethodisStatic, isStatic_);
-  fprintf(SCA_GET_WRITE_PTR(), "                    \"%s\": %d,\n", MethodisVirtual, isVirtual_);
+  SCA::Writer &w = SCA_GET_WRITER();
+  w.ws("                  ");
+  w.put('{');
+  w.ws(" \n");
+  w.key("                    ", MethodName, ": ");
+  w.str(name_);
+  w.end(",");
+  w.key("                    ", MethodId, "   : ");
+  dump_source_id(w, id_);
+  w.end(",");
+  w.key("                    ", MethodisConstant, ": ");
+  w.num(isConst_);
+  w.end(",");
+  w.key("                    ", MethodisStatic, ": ");
+  w.num(isStatic_);
+  w.end(",");
+  w.key("                    ", MethodisVirtual, ": ");
+  w.num(isVirtual_);
+  w.end(",");
   Function::dump(isLast);
-  fprintf(SCA_GET_WRITE_PTR(), "                  }%s\n", (isLast ? "" : ","));
+  w.line("                  ", (isLast ? "}" : "},"));
 }
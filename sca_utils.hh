@@ -29,58 +29,218 @@ void split_path(const std::string &ip,
 //--------------------------------------------------------------------------------------
 ///      \brief Tells if the file is a header file/source file/object file
 //--------------------------------------------------------------------------------------
-bool isFileOfInterest(std::string &file_name);
+bool isFileOfInterest(const std::string &file_name);
+
+#define SCA_HASH_SEED 14695981039346656037ULL
+
+//--------------------------------------------------------------------------------------
+///      \brief 64 bit FNV-1a hash of "len" bytes. Pass the previous hash as "seed"
+///             to hash data incrementally
+//--------------------------------------------------------------------------------------
+ULL hash_bytes(const void *data, size_t len, ULL seed=SCA_HASH_SEED);
+
+/// Position of the bit of a word with only that bit set, by its de Bruijn
+/// product
+extern const unsigned char kBitIndex[64];
+
+//--------------------------------------------------------------------------------------
+///      \brief Position of the lowest bit set in "word", which is not 0
+//--------------------------------------------------------------------------------------
+inline U lowest_bit(ULL word) {
+  return kBitIndex[((word & (0 - word)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
 
 /*--------------------------------------------------------------
  *
  *      Class Declarations
  */
 
+namespace SCA {
+
+// ============================================================================
+///        \class  Arena
+///        \brief  Bump allocator. Memory is handed out from big blocks and is
+//                 only given back all at once, by release(). Nothing allocated
+//                 here gets its destructor called
+// ============================================================================
+class Arena {
+  public:
+    /// Ctor
+    Arena(void) {
+      cur_        = NULL;
+      end_        = NULL;
+      num_allocs_ = 0;
+      num_bytes_  = 0;
+    }
+    /// Dtor
+    ~Arena() {
+      release();
+    }
+    /// Allocate "size" bytes aligned for any type
+    void* alloc(size_t size) {
+      size = (size + kAlign - 1) & ~(kAlign - 1);
+      num_allocs_++;
+      num_bytes_ += size;
+      if(size > (size_t)(end_ - cur_)) {
+        return alloc_slow(size);
+      }
+      void *ptr = cur_;
+      cur_ += size;
+      return ptr;
+    }
+    /// Give back all the memory
+    void release(void);
+    /// Number of alloc() calls since the last release()
+    ULL num_allocs(void) const { return num_allocs_; }
+    /// Bytes handed out since the last release()
+    ULL num_bytes(void) const { return num_bytes_; }
+    /// Number of blocks i.e calls to malloc()
+    size_t num_blocks(void) const { return blocks_.size(); }
+  private:
+    enum {
+      kAlign     = 16,
+      kBlockSize = 64 * 1024
+    };
+    /// Start a new block
+    void* alloc_slow(size_t size);
+    /// Not copyable
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+    /// Free space of the current block
+    char *cur_;
+    char *end_;
+    /// All the blocks
+    std::vector<char*> blocks_;
+    ULL num_allocs_;
+    ULL num_bytes_;
+};
+
+//--------------------------------------------------------------------------------------
+///      \brief The arena that owns the SCA tree. Released by clean_up()
+//--------------------------------------------------------------------------------------
+Arena& sca_obj_arena(void);
+
+// ============================================================================
+///        \class  ArenaVector
+///        \brief  Growable array of PODs living in the object arena. Growing
+//                 leaves the old storage to the arena, which is bounded by
+//                 the final size since the capacity doubles
+// ============================================================================
+template <typename T>
+class ArenaVector {
+  public:
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    ArenaVector(void) {
+      data_     = NULL;
+      size_     = 0;
+      capacity_ = 0;
+    }
+    void push_back(const T &val) {
+      if(size_ == capacity_) {
+        U capacity = capacity_ ? 2 * capacity_ : 4;
+        T *data = static_cast<T*>(sca_obj_arena().alloc(capacity * sizeof(T)));
+        if(size_) {
+          memcpy(data, data_, size_ * sizeof(T));
+        }
+        data_     = data;
+        capacity_ = capacity;
+      }
+      data_[size_++] = val;
+    }
+    bool contains(const T &val) const {
+      for(U i=0; i<size_; i++) {
+        if(data_[i] == val) {
+          return true;
+        }
+      }
+      return false;
+    }
+    void clear(void) { size_ = 0; }
+    size_t size(void) const { return size_; }
+    bool empty(void) const { return size_ == 0; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    iterator begin(void) { return data_; }
+    iterator end(void) { return data_ + size_; }
+    const_iterator begin(void) const { return data_; }
+    const_iterator end(void) const { return data_ + size_; }
+  private:
+    T *data_;
+    U size_;
+    U capacity_;
+};
+
+} // END SCA namespace
+
+// ============================================================================
+///        \class  StringTable
+///        \brief  Interns strings. Ids are handed out from 0 in the order the
+//                 strings are added. Not thread safe
+// ============================================================================
+class StringTable {
+  public:
+    /// Ctor
+    StringTable(void);
+    /// Id of the string, adding it if needed
+    U intern(const char *str, size_t len);
+    U intern(const std::string &str) { return intern(str.c_str(), str.size()); }
+    /// Id of the string or (U)-1 if it is not in the table
+    U find(const char *str, size_t len) const;
+    U find(const std::string &str) const { return find(str.c_str(), str.size()); }
+    /// The string of the id. Stays valid till clear()
+    const char* name(U id) const { return names_[id]; }
+    /// Length of the string of the id
+    U length(U id) const { return lengths_[id]; }
+    /// Number of strings
+    U size(void) const { return names_.size(); }
+    /// Drop all the strings
+    void clear(void);
+  private:
+    /// Slot of the string, or the empty slot where it would go
+    size_t slot(const char *str, size_t len) const;
+    /// Grow the slots when half full
+    void grow(void);
+    /// All the strings indexed with the id, NUL terminated
+    std::vector<const char*> names_;
+    std::vector<U> lengths_;
+    /// Holds the characters of the strings
+    SCA::Arena chars_;
+    /// Open addressing table of id+1, 0 is an empty slot
+    std::vector<U> slots_;
+};
+
 // ============================================================================
 ///        \class  SourceId
-///        \brief  A combination of file name + line number
+///        \brief  A combination of file + line number, packed in to one
+//                 integer as (FileId, line). The FileId is the one of the
+//                 full path, so a/util.h:10 and b/util.h:10 differ
 // ============================================================================
 class SourceId {
   public:
     SourceId() { 
-      file_name_.clear();
-      line_no_ = INVALID_LINE_ID; 
-    }
-    SourceId(std::string &file_name, LineId line_id) {
-      std::string dir_name, base_name;
-      split_path(file_name, dir_name, base_name);
-      file_name_ = base_name;
-      line_no_   = line_id;
-    }
-    SourceId(const char* c_file_name, LineId line_id) {
-      std::string file_name(c_file_name);
-      std::string dir_name, base_name;
-      split_path(file_name, dir_name, base_name);
-      file_name_ = base_name;
-      line_no_   = line_id;
+      key_ = INVALID_LINE_ID;
+    }
+    SourceId(FileId file_id, LineId line_id) {
+      key_ = ((ULL)file_id << 32) | line_id;
     }
     SourceId(const SourceId& rhs) {
-      file_name_ = rhs.file_name_;
-      line_no_   = rhs.line_no_;
+      key_ = rhs.key_;
     }
     bool operator<(const SourceId& rhs) const {
-      if(file_name_ < rhs.file_name_) {
-        return true;
-      } else if(file_name_ > rhs.file_name_) {
-        return false;
-      } else {
-        if(line_no_ < rhs.line_no_) {
-          return true;
-        } else {
-          return false;
-        }
-      }
+      return key_ < rhs.key_;
     }
-    std::string file_name(void) const { return file_name_; }
-    LineId line_no(void) const { return line_no_; }
+    bool operator==(const SourceId& rhs) const {
+      return key_ == rhs.key_;
+    }
+    /// The packed key. Unique for the file and line
+    ULL key(void) const { return key_; }
+    FileId file_id(void) const { return (FileId)(key_ >> 32); }
+    /// Full path of the file, empty if SCA does not track it
+    const char* file_name(void) const;
+    LineId line_no(void) const { return (LineId)key_; }
   private:
-    std::string file_name_;
-    LineId line_no_;
+    ULL key_;
 };
 
 typedef SourceId FuncId;
@@ -92,10 +252,24 @@ namespace SCA {
 #define PackageName "ssca_PkgName"
 #define PackageSourceFile  "ssca_sFile"
 #define PackageHeaderFile "ssca_hFile"
+#define PackageDepends "ssca_pdeps"
+#define PackageLayer "ssca_pl"
+#define PackageCycle "ssca_pc"
+#define PackageReach "ssca_pr"
+#define PackageDependents "ssca_prd"
 
 #define FileName "ssca_FileName"
 #define FileFunction  "ssca_funct"
 #define FileClass  "ssca_cls"
+#define FileBytes "ssca_sz"
+#define FileLines "ssca_fl"
+#define FileIncludes "ssca_inc"
+#define FileExternalIncludes "ssca_ext"
+#define FileNumTus "ssca_ntus"
+#define FileBuildBytes "ssca_tb"
+#define FileBuildLines "ssca_tl"
+#define FileClosureBytes "ssca_cb"
+#define FileClosureLines "ssca_cl"
 
 #define ClassName "ssca_ClassName"
 #define ClassIdentity   "ssca_i"
@@ -119,6 +293,18 @@ namespace SCA {
 #define FunctionMaxNesting "ssca_mn"
 #define FunctionNumLines "ssca_nl"
 #define FunctionParamSize "ssca_ps"
+#define FunctionUsr "ssca_u"
+#define FunctionCalls "ssca_calls"
+#define FunctionFanIn "ssca_fin"
+#define FunctionFanOut "ssca_fout"
+#define FunctionScc "ssca_scc"
+#define FunctionOperators "ssca_opr"
+#define FunctionOperands "ssca_opn"
+#define FunctionUniqueOperators "ssca_hn1"
+#define FunctionUniqueOperands "ssca_hn2"
+#define FunctionVolume "ssca_hvol"
+#define FunctionDifficulty "ssca_hdiff"
+#define FunctionEffort "ssca_heff"
 
 #define MethodName "ssca_MethodName"
 #define MethodId  "ssca_i"
@@ -131,9 +317,15 @@ class Package;
 class File; 
 class Class;
 
-typedef std::list<Obj*> ObjList;
+typedef ArenaVector<Obj*> ObjList;
 typedef std::vector<Obj*> ObjVector;
-typedef std::list<Class*> ClassList;
+typedef ArenaVector<Class*> ClassList;
+
+//--------------------------------------------------------------------------------------
+///      \brief The pool the names of the objects are interned in. Cleared by
+///             clean_up()
+//--------------------------------------------------------------------------------------
+StringTable& sca_name_pool(void);
 //
 //=============================================================================
 ///       \class  Obj
@@ -155,11 +347,26 @@ class Obj {
     };
     ///Ctor
     Obj(Obj* a_parent, Obj::ObjType type, const std::string &name)
-      : parent_(a_parent), type_(type), name_(name) {
+      : parent_(a_parent), type_(type) {
+        StringTable &pool = sca_name_pool();
+        name_ = pool.name(pool.intern(name));
         if(parent_) {
           parent_->addChild(this);
         }
     }
+    /// All the objects live in the object arena
+    static void* operator new(size_t size) {
+      return sca_obj_arena().alloc(size);
+    }
+    /// The arena is released as a whole
+    static void operator delete(void *ptr) {
+    }
+    /// Objects kept out of the tree live in an arena of their own
+    static void* operator new(size_t size, Arena &arena) {
+      return arena.alloc(size);
+    }
+    static void operator delete(void *ptr, Arena &arena) {
+    }
     /// Gets the parent of current node
     Obj* parent(void) const { return parent_; }
     /// Gets the type of the current nodes
@@ -169,27 +376,38 @@ class Obj {
     /// Add a child to the current node
     void addChild(Obj* child);
     /// Get the name of the class
-    std::string name(void) const { return name_; }
+    const char* name(void) const { return name_; }
+    /// Whether the object is written by the dump. Only a part of the tree
+    ///  is, for the entries of the result cache
+    virtual bool isDumped(void) const { return true; }
     /// DUmp the file info
     virtual void dump(bool isLast=false) {
       ObjList::iterator it;
-      int tot_size = childs_.size();
+      int tot_size = 0;
+      for(it=childs_.begin(); it!= childs_.end(); it++) {
+        if((*it)->isDumped()) {
+          tot_size++;
+        }
+      }
       int i=1;
-      for(it=childs_.begin(); it!= childs_.end(); it++, i++) {
-        (*it)->dump((i == tot_size));
+      for(it=childs_.begin(); it!= childs_.end(); it++) {
+        if((*it)->isDumped()) {
+          (*it)->dump((i == tot_size));
+          i++;
+        }
       }
     }
     virtual void dump(ObjType a_type, bool isLast=false) {
       ObjList::iterator it;
       int tot_size = 0;
       for(it=childs_.begin(); it!= childs_.end(); it++) {
-        if((*it)->type() == a_type) {
+        if((*it)->type() == a_type && (*it)->isDumped()) {
           tot_size++;
         }
       }
       int i=1;
       for(it=childs_.begin(); it!= childs_.end(); it++) {
-        if((*it)->type() == a_type) {
+        if((*it)->type() == a_type && (*it)->isDumped()) {
           (*it)->dump(a_type, (i == tot_size));
           i++;
         }
@@ -197,8 +415,8 @@ class Obj {
     }
     /// Gets the child that matches "name" and "type"
     virtual Obj* getChildOfType(Obj::ObjType type, const std::string &name);
-    /// The name of the file
-    std::string name_;
+    /// The name of the file, interned in sca_name_pool()
+    const char *name_;
   private:
     /// Type of object
     ObjType type_;
@@ -482,8 +700,34 @@ class File : public Obj {
     PkgId pkgId(void) const;
     /// Insert the file as direct include of current file
     void insert_direct_include(FileId id);
+    /// The files the file includes directly
+    const ArenaVector<FileId>& direct_includes(void) const { return direct_includes_; }
+    /// Number of #includes of files SCA does not track (i.e <vector>). They
+    ///  are not in the include graph
+    U external_includes(void) const { return external_includes_; }
+    void set_external_includes(U num) { external_includes_ = num; }
+    /// Size of the file in bytes and lines, set once by the first TU that
+    ///  sees the file or by the input it comes from
+    U num_bytes(void) const { return num_bytes_; }
+    U num_lines(void) const { return num_lines_; }
+    bool isMeasured(void) const { return measured_; }
+    void set_size(U bytes, U lines) { num_bytes_ = bytes; num_lines_ = lines; measured_ = true; }
+    /// Number of TUs the file is part of, i.e that include it directly or
+    ///  not. Set by the include graph
+    U num_tus(void) const { return num_tus_; }
+    void set_num_tus(U num_tus) { num_tus_ = num_tus; }
+    /// What the file adds to the preprocessed sources of the whole build
+    ULL build_bytes(void) const { return (ULL)num_tus_ * num_bytes_; }
+    ULL build_lines(void) const { return (ULL)num_tus_ * num_lines_; }
+    /// Size of the file along with everything it includes, i.e what one
+    ///  #include of it costs. For a source it is the size of its TU
+    ULL closure_bytes(void) const { return closure_bytes_; }
+    ULL closure_lines(void) const { return closure_lines_; }
+    void set_closure(ULL bytes, ULL lines) { closure_bytes_ = bytes; closure_lines_ = lines; }
     /// Get the full name of the file
     std::string get_full_name(void);
+    /// Whether the file is in the part of the tree being dumped
+    virtual bool isDumped(void) const;
     /// DUmp the file info
     virtual void dump(bool isLast=false);
   protected:
@@ -492,7 +736,14 @@ class File : public Obj {
     /// Type of the file header/source
     ObjType type_;
     /// List of direct includes
-    std::set<FileId> direct_includes_;
+    ArenaVector<FileId> direct_includes_;
+    U external_includes_;
+    U num_bytes_;
+    U num_lines_;
+    bool measured_;
+    U num_tus_;
+    ULL closure_bytes_;
+    ULL closure_lines_;
 };
  
 // =============================================================================
@@ -550,17 +801,44 @@ class Package  : public Obj {
     Package(const std::string &a_name, 
             const PkgId &a_id) 
        : Obj(NULL, Obj::kPackage, a_name) {
-      pkgId_ = a_id;
+      pkgId_          = a_id;
+      layer_          = 0;
+      cycle_          = 0;
+      num_reach_      = 0;
+      num_dependents_ = 0;
     }
     /// Id of the package
     PkgId id(void) const { return pkgId_; }
+    /// The packages this one depends on directly in the order of their
+    ///  names, set by the package graph
+    const ArenaVector<PkgId>& dependent_packages(void) const { return dependent_packages_; }
+    void clear_dependent_packages(void) { dependent_packages_.clear(); }
+    void insert_dependent_package(PkgId id) { dependent_packages_.push_back(id); }
+    /// Layer of the package, 0 if it depends on no other package
+    U layer(void) const { return layer_; }
+    void set_layer(U layer) { layer_ = layer; }
+    /// Dependency cycle the package is part of, 0 if none
+    U cycle(void) const { return cycle_; }
+    void set_cycle(U cycle) { cycle_ = cycle; }
+    /// Number of packages it depends on and that depend on it, directly or
+    ///  not
+    U num_reach(void) const { return num_reach_; }
+    U num_dependents(void) const { return num_dependents_; }
+    void set_reach(U num_reach, U num_dependents) {
+      num_reach_      = num_reach;
+      num_dependents_ = num_dependents;
+    }
     /// DUmp the pkg info
     virtual void dump(bool isLast=false);
   private:
     /// Id of the package
     PkgId pkgId_;
     /// All direct dependent packages
-    std::set<PkgId> dependent_packages_;
+    ArenaVector<PkgId> dependent_packages_;
+    U layer_;
+    U cycle_;
+    U num_reach_;
+    U num_dependents_;
 };
 
 // ============================================================================
@@ -578,10 +856,23 @@ class Function : public Obj {
      complexity_ = 0;
      max_nesting_= 0;
      num_lines_  = 0; 
+     param_size_ = 0;
+     usr_        = 0;
+     callees_    = NULL;
+     num_callees_= 0;
+     fan_in_     = 0;
+     fan_out_    = 0;
+     scc_        = 0;
+     num_operators_    = 0;
+     num_operands_     = 0;
+     unique_operators_ = 0;
+     unique_operands_  = 0;
    }
    void set_id(FuncId& id) {
      id_ = id;
    }
+   /// Get the id of the function
+   FuncId id(void) const { return id_; }
    /// Get the cyclomatic complexity of the function
    U cyclomatic(void) const { return cyclomatic_; }
    /// Get the complexity of the function
@@ -592,6 +883,26 @@ class Function : public Obj {
    U num_lines(void) const { return num_lines_; }
    /// Get the number of parameter to the function
    U param_size() const { return param_size_; }
+   /// Hash of the USR of the function, the same in every TU. 0 if unknown
+   ULL usr(void) const { return usr_; }
+   /// USR hashes of the functions called, sorted and unique
+   const ULL* callees(void) const { return callees_; }
+   U num_callees(void) const { return num_callees_; }
+   /// Number of functions of the call graph calling/called by the function
+   U fan_in(void) const { return fan_in_; }
+   U fan_out(void) const { return fan_out_; }
+   /// Recursion cycle (1..N) the function is part of, 0 if none
+   U scc(void) const { return scc_; }
+   /// Halstead counts: the operators and operands of the function, all of
+   ///  them (N1, N2) and the distinct ones (n1, n2)
+   U num_operators(void) const { return num_operators_; }
+   U num_operands(void) const { return num_operands_; }
+   U unique_operators(void) const { return unique_operators_; }
+   U unique_operands(void) const { return unique_operands_; }
+   /// Halstead volume, difficulty and effort, from the counts
+   double volume(void) const;
+   double difficulty(void) const;
+   double effort(void) const { return difficulty() * volume(); }
    /// Set the cyclomatic complexity of the function
    void set_cyclomatic(U cyclomatic) { 
      cyclomatic_ = cyclomatic; 
@@ -611,6 +922,29 @@ class Function : public Obj {
    void set_param_size(U param_size) {
      param_size_ = param_size;
    }
+   void set_usr(ULL usr) {
+     usr_ = usr;
+   }
+   /// Copy the sorted and unique callees in to "arena"
+   void set_callees(const ULL *usrs, U count, Arena &arena);
+   /// Set by the call graph
+   void set_fan_in(U fan_in) {
+     fan_in_ = fan_in;
+   }
+   void set_fan_out(U fan_out) {
+     fan_out_ = fan_out;
+   }
+   void set_scc(U scc) {
+     scc_ = scc;
+   }
+   void set_operators(U num, U unique) {
+     num_operators_    = num;
+     unique_operators_ = unique;
+   }
+   void set_operands(U num, U unique) {
+     num_operands_    = num;
+     unique_operands_ = unique;
+   }
    void addArg(const char *type, const char *var) {
      
    }
@@ -633,6 +967,19 @@ class Function : public Obj {
    U num_lines_;
    /// Number of params to the method
    U param_size_;
+   /// USR hash and the callees
+   ULL usr_;
+   const ULL *callees_;
+   U num_callees_;
+   /// Call graph metrics
+   U fan_in_;
+   U fan_out_;
+   U scc_;
+   /// Halstead counts
+   U num_operators_;
+   U num_operands_;
+   U unique_operators_;
+   U unique_operands_;
 };
 
 // ============================================================================
@@ -681,6 +1028,8 @@ class Method : public Function {
     void set_isVirtual(int is_true) {
        isVirtual_ = is_true;
     }
+    /// Whether the file the method is defined in is being dumped
+    virtual bool isDumped(void) const;
     virtual void dump(Obj::ObjType type, bool isLast=false); 
   private:
     /// Flags for the class
@@ -691,20 +1040,253 @@ class Method : public Function {
         isVirtual_:1;
 };
 
+// ============================================================================
+///        \class  Lexeme
+///        \brief  A token of a file, as far as the Halstead counts need it
+// ============================================================================
+class Lexeme {
+  public:
+    /// Operators are the punctuators and keywords, operands the
+    ///  identifiers and literals
+    enum LexemeKind {
+      kOperator=0,
+      kOperand
+    };
+    /// Hash of the spelling, which tells two tokens apart
+    ULL hash_;
+    /// Offset of the token in the file
+    U offset_;
+    LexemeKind kind_;
+};
+
+// ============================================================================
+///        \class  HalsteadCounts
+///        \brief  The Halstead counts of a function, made before the lock
+// ============================================================================
+class HalsteadCounts {
+  public:
+    HalsteadCounts() {
+      operators_        = 0;
+      unique_operators_ = 0;
+      operands_         = 0;
+      unique_operands_  = 0;
+    }
+    U operators_;
+    U unique_operators_;
+    U operands_;
+    U unique_operands_;
+};
+
+// ============================================================================
+///        \class  FileVisit
+///        \brief  What the top level visitor knows about a file in a TU
+// ============================================================================
+class FileVisit {
+  public:
+    FileVisit() {
+      type_    = File::kUnknown;
+      file_    = NULL;
+      pruned_  = false;
+      lexed_   = false;
+      external_includes_ = 0;
+    }
+    /// Absolute path of the file
+    std::string path_;
+    /// Header, source or neither
+    File::FileType type_;
+    /// The file in the tree. Set once a definition or an include needs it
+    File *file_;
+    /// Whether the declarations in the file are skipped
+    bool pruned_;
+    /// #includes of the file that SCA does not track
+    U external_includes_;
+    /// The tokens of the whole file in the order of their offset. Made
+    ///  once, by the first function walked in the file
+    std::vector<Lexeme> lexemes_;
+    bool lexed_;
+};
+
+// ============================================================================
+///        \class  WalkFrame
+///        \brief  One ancestor of the cursor being walked in a function body
+// ============================================================================
+class WalkFrame {
+  public:
+    WalkFrame() {
+      nesting_    = 0;
+      complexity_ = 0;
+    }
+    /// The ancestor
+    CXCursor cursor_;
+    /// Number of branches enclosing (and including) the ancestor
+    int nesting_;
+    /// Number of loops enclosing (and including) the ancestor
+    int complexity_;
+};
+
+// ============================================================================
+///        \class  Stats
+///        \brief  Counters dumped on stderr when SCA_STATS is set
+// ============================================================================
+class Stats {
+  public:
+    Stats() {
+      body_cursors_   = 0;
+      body_walk_time_ = 0;
+      cache_hits_     = 0;
+      cache_misses_   = 0;
+      file_lookups_   = 0;
+      file_misses_    = 0;
+      path_lookups_   = 0;
+      path_misses_    = 0;
+      merged_inputs_  = 0;
+      merged_bytes_   = 0;
+      merged_tokens_  = 0;
+      merge_time_     = 0;
+      merge_read_time_   = 0;
+      merge_splice_time_ = 0;
+      sqlite_rows_       = 0;
+      sqlite_insert_time_ = 0;
+      sqlite_index_time_  = 0;
+      callgraph_nodes_      = 0;
+      callgraph_edges_      = 0;
+      callgraph_unresolved_ = 0;
+      callgraph_cycles_     = 0;
+      callgraph_bytes_      = 0;
+      callgraph_time_       = 0;
+      include_files_   = 0;
+      include_edges_   = 0;
+      include_headers_ = 0;
+      include_cycles_  = 0;
+      include_bytes_   = 0;
+      include_time_    = 0;
+      package_nodes_   = 0;
+      package_edges_   = 0;
+      package_cycles_  = 0;
+      package_layers_  = 0;
+      package_bytes_   = 0;
+      package_time_    = 0;
+      lexemes_         = 0;
+      lex_time_        = 0;
+      tus_             = 0;
+      tu_parallel_time_ = 0;
+      tu_locked_time_   = 0;
+      tu_wait_time_     = 0;
+    }
+    /// Cursors walked inside the function bodies
+    ULL body_cursors_;
+    /// Seconds spent walking the function bodies
+    double body_walk_time_;
+    /// TUs loaded from and stored in to the result cache
+    ULL cache_hits_;
+    ULL cache_misses_;
+    /// Location resolution. Files resolved per TU and canonical paths
+    ULL file_lookups_;
+    ULL file_misses_;
+    ULL path_lookups_;
+    ULL path_misses_;
+    /// Result files merged at the link step, their size, the JSON tokens
+    ///  read and the seconds it took
+    ULL merged_inputs_;
+    ULL merged_bytes_;
+    ULL merged_tokens_;
+    double merge_time_;
+    /// Seconds the merge workers spent reading and staging the files, and
+    ///  adding them to the tree one at a time
+    double merge_read_time_;
+    double merge_splice_time_;
+    /// Rows exported to SQLite and the seconds spent inserting them and
+    ///  building the indices
+    ULL sqlite_rows_;
+    double sqlite_insert_time_;
+    double sqlite_index_time_;
+    /// Functions and resolved calls of the call graph, the calls to
+    ///  functions SCA has not seen, the recursion cycles, the bytes of the
+    ///  graph and the seconds it took
+    ULL callgraph_nodes_;
+    ULL callgraph_edges_;
+    ULL callgraph_unresolved_;
+    ULL callgraph_cycles_;
+    ULL callgraph_bytes_;
+    double callgraph_time_;
+    /// Files and #include edges of the include graph, the files included
+    ///  by some file (the columns of the closures), the include cycles, the
+    ///  bytes of the closures and the seconds it took
+    ULL include_files_;
+    ULL include_edges_;
+    ULL include_headers_;
+    ULL include_cycles_;
+    ULL include_bytes_;
+    double include_time_;
+    /// Packages and dependencies of the package graph, its cycles and
+    ///  layers, the bytes of the matrices and the seconds it took
+    ULL package_nodes_;
+    ULL package_edges_;
+    ULL package_cycles_;
+    ULL package_layers_;
+    ULL package_bytes_;
+    double package_time_;
+    /// Tokens of the files with a function walked, and the seconds spent
+    ///  tokenizing them and counting the tokens of the functions. All of
+    ///  it is done before the lock
+    ULL lexemes_;
+    double lex_time_;
+    /// TUs parsed by the workers, the seconds spent on them without the
+    ///  lock (parsing, Halstead tokens, cache hashes) and holding it (the
+    ///  walk), and waiting for their turn and the lock. The walk is the
+    ///  serial part
+    ULL tus_;
+    double tu_parallel_time_;
+    double tu_locked_time_;
+    double tu_wait_time_;
+};
+
 class Context {
   public:
     Context() {
       max_nesting_      = 0;
       max_cyclomatic_   = 0;
       max_complexity_   = 0;
+      cur_func_         = NULL;
+      cur_class_        = NULL;
+      num_cursors_      = 0;
+      walk_time_        = 0;
+      file_lookups_     = 0;
+      num_lexemes_      = 0;
+      lex_time_         = 0;
     }
     int max_nesting_;
-    int cur_nesting_;
     int max_cyclomatic_;
     int max_complexity_;
-    int cur_complexity_;
+    /// Ancestors of the cursor being walked in the function body
+    std::vector<WalkFrame> walk_stack_;
+    /// USR hashes of the functions called by the function being walked
+    std::vector<ULL> callees_;
+    /// Cursors walked in the function bodies of the TU
+    ULL num_cursors_;
+    /// Seconds spent walking the function bodies of the TU
+    double walk_time_;
+    /// Hashes of the operators and operands of the function being counted
+    std::vector<ULL> operators_;
+    std::vector<ULL> operands_;
+    /// Tokens of the files of the TU and the seconds spent on them
+    ULL num_lexemes_;
+    double lex_time_;
+    /// Flags to tokenize a file of the TU on its own, see getLexArgs
+    std::vector<std::string> lex_args_;
+    /// Halstead counts of the functions of the TU on the file and the
+    ///  offset their extent starts at. See sca_lex_translation_unit
+    std::map<std::pair<CXFile, U>, HalsteadCounts> halstead_;
     SCA::Function* cur_func_;
     SCA::Class* cur_class_;
+    /// Files seen in the TU. CXFile is unique within a TU, so every file
+    /// is resolved once per TU
+    std::map<CXFile, FileVisit> files_;
+    /// Number of times files_ is looked up
+    ULL file_lookups_;
+    /// The functions of the TU in the streaming mode. They are written out
+    /// as soon as they are walked, so they need not outlive the TU
+    Arena scratch_;
 };
 
 } // END SCA namespace
@@ -712,29 +1294,100 @@ class Context {
 // ============================================================================
 ///        \class  DoubleHash
 ///        \brief  Template class to hash objects based on SourceId for quick 
-//                 lookup
+//                 lookup. Open addressing on the packed SourceId, one probe
+//                 sequence per lookup. Entries are never removed one by one
 // ============================================================================
 template <typename T>
 class DoubleHash {
   public:
-    DoubleHash(void) { }
-    void insert(SourceId &id, T* obj);
-    T* operator[](const SourceId &id);
+    DoubleHash(void) { 
+      count_ = 0;
+    }
+    void insert(const SourceId &id, T* obj);
+    T* operator[](const SourceId &id) const;
     void clear(void);
-    std::map<SourceId, T*>& container(void) { return container_; }
+    /// Number of objects
+    size_t size(void) const { return count_; }
+    /// All the objects, in no particular order
+    void values(std::vector<T*> &objs) const;
   private:
-    /// The actual container
-    std::map<SourceId, T*> container_;
+    /// Slot of the key, or the empty slot where it would go
+    size_t find(ULL key) const;
+    /// Double the slots
+    void grow(void);
+    /// Keys and objects. A NULL object is an empty slot
+    std::vector<ULL> keys_;
+    std::vector<T*> objs_;
+    /// Number of objects
+    size_t count_;
 };
 
+//==============================================================================
+///      \brief   Mix the bits of the key so that the line numbers of one file
+//                 do not land in one cluster
+//==============================================================================
+inline ULL mix_key(ULL key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return key;
+}
+
+//==============================================================================
+///      \class   DoubleHash
+///      \method  find
+///      \brief   Linear probe for the key
+//==============================================================================
+template <typename T>
+size_t DoubleHash<T>::find(ULL key) const {
+  size_t mask = keys_.size() - 1;
+  size_t slot = mix_key(key) & mask;
+  while(objs_[slot] && keys_[slot] != key) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+//==============================================================================
+///      \class   DoubleHash
+///      \method  grow
+///      \brief   Double the slots and rehash
+//==============================================================================
+template <typename T>
+void DoubleHash<T>::grow(void) {
+  std::vector<ULL> old_keys;
+  std::vector<T*> old_objs;
+  old_keys.swap(keys_);
+  old_objs.swap(objs_);
+  size_t size = old_keys.empty() ? 1024 : 2 * old_keys.size();
+  keys_.resize(size, 0);
+  objs_.resize(size, NULL);
+  for(size_t i=0; i<old_objs.size(); i++) {
+    if(old_objs[i]) {
+      size_t slot = find(old_keys[i]);
+      keys_[slot] = old_keys[i];
+      objs_[slot] = old_objs[i];
+    }
+  }
+}
+
 //==============================================================================
 ///      \class   DoubleHash
 ///      \method  insert
 ///      \brief   Inserts an element in to the double hash
 //==============================================================================
 template <typename T>
-void DoubleHash<T>::insert(SourceId &id, T* obj) {
-  container_[id] = obj;
+void DoubleHash<T>::insert(const SourceId &id, T* obj) {
+  assert(obj);
+  if(2 * (count_ + 1) > keys_.size()) {
+    grow();
+  }
+  size_t slot = find(id.key());
+  if(NULL == objs_[slot]) {
+    count_++;
+  }
+  keys_[slot] = id.key();
+  objs_[slot] = obj;
 }
 
 //==============================================================================
@@ -743,54 +1396,122 @@ void DoubleHash<T>::insert(SourceId &id, T* obj) {
 ///      \brief   Retrieves an elemnt from the double hash
 //==============================================================================
 template <typename T>
-T* DoubleHash<T>::operator[](const SourceId &id) {
-  if(container_.count(id) == 0) return NULL;
-  return container_[id];
+T* DoubleHash<T>::operator[](const SourceId &id) const {
+  if(count_ == 0) return NULL;
+  return objs_[find(id.key())];
+}
+
+//==============================================================================
+///      \class   DoubleHash 
+///      \method  values
+///      \brief   All the objects in the hash
+//==============================================================================
+template <typename T>
+void DoubleHash<T>::values(std::vector<T*> &objs) const {
+  objs.reserve(objs.size() + count_);
+  for(size_t i=0; i<objs_.size(); i++) {
+    if(objs_[i]) {
+      objs.push_back(objs_[i]);
+    }
+  }
 }
 
 //==============================================================================
 ///      \class   DoubleHash 
 ///      \method  clear
-///      \brief   Deletes all the elements in the hash
+///      \brief   Drops all the elements in the hash. The objects themselves
+//                are owned by the object arena
 //==============================================================================
 template <typename T>
 void DoubleHash<T>::clear(void) {
-  typename std::map<SourceId, T*>::iterator it;
-  for(it=container_.begin(); it!=container_.end(); it++) {
-    delete (it->second);
-  }
-  container_.clear();
+  keys_.clear();
+  objs_.clear();
+  count_ = 0;
 }
 
+//--------------------------------------------------------------------------------------
+///      \brief Wall clock time in seconds
+//--------------------------------------------------------------------------------------
+double sca_time_now(void);
+
 //--------------------------------------------------------------------------------------
 ///      \brief Get absoulte path from relative path
 //--------------------------------------------------------------------------------------
 void getAbsolutePathFromRelativePath(const char* relative, char* absolute);
 
+//--------------------------------------------------------------------------------------
+///      \brief What the TU knows about the file, resolving it on the first call.
+///             NULL for a NULL file
+//--------------------------------------------------------------------------------------
+SCA::FileVisit* resolveFile(CXFile file, SCA::Context *cntxt);
+
+//--------------------------------------------------------------------------------------
+///      \brief Get SCA::File from CXFile, inserting it in the tree if needed
+//--------------------------------------------------------------------------------------
+SCA::File* getFileFromCXFile(CXFile file, SCA::Context *cntxt);
+
+//--------------------------------------------------------------------------------------
+///      \brief Tokenize the whole file in to visit->lexemes_ with a single
+///             clang_tokenize. A file that came in a PCH is tokenized in a
+///             TU of its own with "lex_args". Returns the number of tokens
+///             kept
+//--------------------------------------------------------------------------------------
+size_t tokenizeFile(CXTranslationUnit tu, CXFile file, SCA::FileVisit *visit,
+                    const std::vector<std::string> &lex_args);
+
+//--------------------------------------------------------------------------------------
+///      \brief The flags of the TU of "source" that tell how a file of it is
+///             tokenized: its language and its standard
+//--------------------------------------------------------------------------------------
+void getLexArgs(const std::string &source, const std::vector<std::string> &args,
+                std::vector<std::string> &lex_args);
+
 //--------------------------------------------------------------------------------------
 ///      \brief Get SCA::File from CXCursor
 //--------------------------------------------------------------------------------------
-SCA::File* getFileFromCursor(CXCursor cursor);
+SCA::File* getFileFromCursor(CXCursor cursor, SCA::Context *cntxt);
 
 //--------------------------------------------------------------------------------------
-///      \brief Geti SourceId from the cursor
+///      \brief Geti SourceId from the source location
 //--------------------------------------------------------------------------------------
-SourceId getSourceIdFromSourceLocation(CXSourceLocation sl);
+SourceId getSourceIdFromSourceLocation(CXSourceLocation sl, SCA::Context *cntxt);
 
 //--------------------------------------------------------------------------------------
 ///      \brief Geti SourceId from the cursor
 //--------------------------------------------------------------------------------------
-SourceId getSourceIdFromCursor(CXCursor cursor);
+SourceId getSourceIdFromCursor(CXCursor cursor, SCA::Context *cntxt);
+
+//--------------------------------------------------------------------------------------
+///      \brief Spelling of the cursor. The CXString is disposed
+//--------------------------------------------------------------------------------------
+std::string getCursorSpelling(CXCursor cursor);
 
 //--------------------------------------------------------------------------------------
 ///      \brief Get number of lines defined by the cursor
 //--------------------------------------------------------------------------------------
 U getLineScopeFromCursor(CXCursor cursor);
 
+//--------------------------------------------------------------------------------------
+///      \brief Number of lines of the text. A last line without a newline
+///             counts
+//--------------------------------------------------------------------------------------
+U countLines(const char *data, size_t size);
+
+//--------------------------------------------------------------------------------------
+///      \brief Hash of the USR of the cursor, 0 if it has none. A function has
+///             the same USR in every TU it is declared in
+//--------------------------------------------------------------------------------------
+ULL getUsrHashFromCursor(CXCursor cursor);
+
+//--------------------------------------------------------------------------------------
+///      \brief Whether the TU has any diagnostic at or above "severity"
+//--------------------------------------------------------------------------------------
+bool hasDiagnostics(CXTranslationUnit TU, CXDiagnosticSeverity severity);
+
 //--------------------------------------------------------------------------------------
 ///      \brief Get whether the given file is source or header 
 //--------------------------------------------------------------------------------------
-SCA::File::FileType getType(std::string &file_name);
+SCA::File::FileType getType(const std::string &file_name);
 
 #endif    /* SCA_UTILS_H */
 
@@ -0,0 +1,40 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_visitor.hh
+ *
+ *  \brief
+ *      Entry point to the AST visitors
+ *
+ *  \details
+ *      The visitors themselves live in sca.cc. Callers must hold the
+ *      SCA_globals lock while visiting since the visitors update the
+ *      global SCA tree. The tokens are counted before, without the lock.
+ *
+ *  \history
+ *      10/18/26 07:02:37 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_VISITOR_H
+#define SCA_VISITOR_H
+
+#include <clang-c/Index.h>
+#include "sca_utils.hh"
+
+//--------------------------------------------------------------------------------------
+///      \brief Count the Halstead tokens of the functions of the translation
+///             unit in to the context. The caller must not hold the lock
+//--------------------------------------------------------------------------------------
+void sca_lex_translation_unit(CXTranslationUnit TU, SCA::Context *cntxt);
+
+//--------------------------------------------------------------------------------------
+///      \brief Visit the whole translation unit and fill the SCA tree
+//--------------------------------------------------------------------------------------
+void sca_visit_translation_unit(CXTranslationUnit TU, SCA::Context *cntxt);
+
+//--------------------------------------------------------------------------------------
+///      \brief Drop the SCA tree and close the output so that a new tree can be
+///             built
+//--------------------------------------------------------------------------------------
+void clean_up(void);
+
+#endif    /* SCA_VISITOR_H */
@@ -0,0 +1,111 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_workqueue.cc
+ *
+ *  \brief
+ *      Implementation of the work queue
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 06:44:51 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include "sca_workqueue.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method
+///      \brief   Constructor
+//==============================================================================
+WorkQueue::WorkQueue(size_t num_items, int num_workers) {
+  num_items_   = num_items;
+  next_item_   = 0;
+  num_workers_ = (num_workers < 1) ? 1 : num_workers;
+  // No point in spawning threads that would find the queue empty
+  if(num_items_ < (size_t)num_workers_) {
+    num_workers_ = (num_items_ == 0) ? 1 : (int)num_items_;
+  }
+  fn_        = NULL;
+  user_data_ = NULL;
+  pthread_mutex_init(&lock_, NULL);
+}
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method
+///      \brief   Destructor
+//==============================================================================
+WorkQueue::~WorkQueue() {
+  pthread_mutex_destroy(&lock_);
+}
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method  num_cpus
+///      \brief   Number of online CPUs
+//==============================================================================
+int WorkQueue::num_cpus(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n < 1) ? 1 : (int)n;
+}
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method  next_item
+///      \brief   Fetch the next item. Returns false when the queue is drained
+//==============================================================================
+bool WorkQueue::next_item(size_t &item) {
+  bool found = false;
+  pthread_mutex_lock(&lock_);
+  if(next_item_ < num_items_) {
+    item  = next_item_++;
+    found = true;
+  }
+  pthread_mutex_unlock(&lock_);
+  return found;
+}
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method  worker_main
+///      \brief   Thread entry point. Keeps pulling items until drained
+//==============================================================================
+void* WorkQueue::worker_main(void *arg) {
+  WorkerArg *warg = static_cast<WorkerArg*>(arg);
+  WorkQueue *queue = warg->queue_;
+  size_t item;
+  while(queue->next_item(item)) {
+    queue->fn_(queue->user_data_, item, warg->worker_);
+  }
+  return NULL;
+}
+
+//==============================================================================
+///      \class   WorkQueue
+///      \method  run
+///      \brief   Run "fn" for all the items. The calling thread is worker 0
+//==============================================================================
+void WorkQueue::run(WorkFn fn, void *user_data) {
+  fn_        = fn;
+  user_data_ = user_data;
+  std::vector<pthread_t> threads(num_workers_);
+  std::vector<WorkerArg> args(num_workers_);
+  std::vector<bool> started(num_workers_, false);
+  for(int i=0; i<num_workers_; i++) {
+    args[i].queue_  = this;
+    args[i].worker_ = i;
+  }
+  for(int i=1; i<num_workers_; i++) {
+    started[i] = (0 == pthread_create(&threads[i], NULL, worker_main, &args[i]));
+  }
+  worker_main(&args[0]);
+  for(int i=1; i<num_workers_; i++) {
+    if(started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+}
@@ -0,0 +1,69 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_workqueue.hh
+ *
+ *  \brief
+ *      A minimal pthread based work queue
+ *
+ *  \details
+ *      Hands out item indices [0, num_items) to a fixed number of worker
+ *      threads. The calling thread acts as worker 0.
+ *
+ *  \history
+ *      10/18/26 06:40:12 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_WORKQUEUE_H
+#define SCA_WORKQUEUE_H
+
+#include "sca_int.hh"
+#include <pthread.h>
+
+namespace SCA {
+
+/// Work function called for every item. "worker" is in [0, num_workers)
+typedef void (*WorkFn)(void *user_data, size_t item, int worker);
+
+// ============================================================================
+///        \class  WorkQueue
+///        \brief  Runs a work function over N items on M threads
+// ============================================================================
+class WorkQueue {
+  public:
+    /// Ctor
+    WorkQueue(size_t num_items, int num_workers);
+    /// Dtor
+    ~WorkQueue();
+    /// Run "fn" for all the items. Returns once every item is processed
+    void run(WorkFn fn, void *user_data);
+    /// Number of workers actually used
+    int num_workers(void) const { return num_workers_; }
+    /// Number of online CPUs
+    static int num_cpus(void);
+
+  private:
+    /// Thread entry point
+    static void* worker_main(void *arg);
+    /// Fetch the next item. Returns false when the queue is drained
+    bool next_item(size_t &item);
+    /// Per thread argument
+    struct WorkerArg {
+      WorkQueue *queue_;
+      int worker_;
+    };
+    /// Total number of items
+    size_t num_items_;
+    /// Next item to be handed out
+    size_t next_item_;
+    /// Number of workers
+    int num_workers_;
+    /// The work function and its data
+    WorkFn fn_;
+    void *user_data_;
+    /// Protects next_item_
+    pthread_mutex_t lock_;
+};
+
+} // END SCA namespace
+
+#endif    /* SCA_WORKQUEUE_H */
@@ -0,0 +1,194 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_writer.cc
+ *
+ *  \brief
+ *      Implementation of the buffered writer
+ *
+ *  \details
+ *      Detailed description of file
+ *
+ *  \history
+ *      10/18/26 12:30:02 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#include "sca_writer.hh"
+
+using namespace SCA;
+
+//==============================================================================
+///      \class   Writer
+///      \method
+///      \brief   Constructor
+//==============================================================================
+Writer::Writer(void) {
+  fp_      = NULL;
+  str_     = NULL;
+  buf_     = static_cast<char*>(malloc(kBufSize));
+  len_     = 0;
+  compact_ = false;
+  format_  = kFormatJson;
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method
+///      \brief   Destructor
+//==============================================================================
+Writer::~Writer() {
+  flush();
+  free(buf_);
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  set_file
+///      \brief   What is buffered belongs to the current file
+//==============================================================================
+void Writer::set_file(FILE *fp) {
+  flush();
+  fp_  = fp;
+  str_ = NULL;
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  set_string
+///      \brief   Same as set_file() for a string
+//==============================================================================
+void Writer::set_string(std::string *out) {
+  flush();
+  fp_  = NULL;
+  str_ = out;
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  flush
+///      \brief   A single fwrite() of the whole buffer. stdio passes chunks
+//                this big straight to write()
+//==============================================================================
+void Writer::flush(void) {
+  if(len_ && str_) {
+    str_->append(buf_, len_);
+  } else if(len_ && fp_) {
+    if(fwrite(buf_, 1, len_, fp_) != len_) {
+      fprintf(stderr, "sca: error writing the output\n");
+    }
+  }
+  len_ = 0;
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  esc
+///      \brief   The runs that need no escape are copied as is
+//==============================================================================
+void Writer::esc(const char *str, size_t len) {
+  static const char hex_digits[] = "0123456789abcdef";
+  size_t start = 0;
+  for(size_t i=0; i<len; i++) {
+    unsigned char c = (unsigned char)str[i];
+    if(c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    put(str + start, i - start);
+    start = i + 1;
+    put('\\');
+    switch(c) {
+      case '"':  put('"'); break;
+      case '\\': put('\\'); break;
+      case '\n': put('n'); break;
+      case '\t': put('t'); break;
+      case '\r': put('r'); break;
+      default:
+        put("u00", 3);
+        put(hex_digits[c >> 4]);
+        put(hex_digits[c & 0xf]);
+        break;
+    }
+  }
+  put(str + start, len - start);
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  put_slow
+///      \brief   Fill the buffer, flush it and go on with the rest
+//==============================================================================
+void Writer::put_slow(const char *str, size_t len) {
+  while(len) {
+    size_t room = kBufSize - len_;
+    if(room == 0) {
+      flush();
+      room = kBufSize;
+    }
+    size_t chunk = (len < room) ? len : room;
+    memcpy(buf_ + len_, str, chunk);
+    len_ += chunk;
+    str  += chunk;
+    len  -= chunk;
+  }
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  num
+///      \brief   Digits are produced right to left in a scratch buffer
+//==============================================================================
+void Writer::num(ULL val) {
+  char digits[24];
+  char *end = digits + sizeof(digits);
+  char *cur = end;
+  do {
+    *--cur = (char)('0' + (val % 10));
+    val /= 10;
+  } while(val);
+  put(cur, end - cur);
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  fixed
+///      \brief   Rounded to the hundredth, the digits as num() does them
+//==============================================================================
+void Writer::fixed(double val) {
+  ULL hundredths = (ULL)(val * 100 + 0.5);
+  num(hundredths / 100);
+  put('.');
+  put((char)('0' + (hundredths / 10) % 10));
+  put((char)('0' + hundredths % 10));
+}
+
+//==============================================================================
+///      \class   Writer
+///      \method  hex
+///      \brief   Fixed width, so the values line up and read back the same
+//==============================================================================
+void Writer::hex(ULL val) {
+  static const char kDigits[] = "0123456789abcdef";
+  char digits[16];
+  for(int i=15; i>=0; i--) {
+    digits[i] = kDigits[val & 15];
+    val >>= 4;
+  }
+  put(digits, sizeof(digits));
+}
+
+//==============================================================================
+///      \brief Get the format from its name
+//==============================================================================
+bool parseOutputFormat(const char *name, SCA::OutputFormat &format) {
+  if(!strcmp(name, "json")) {
+    format = SCA::kFormatJson;
+  } else if(!strcmp(name, "bin")) {
+    format = SCA::kFormatBinary;
+  } else if(!strcmp(name, "ndjson")) {
+    format = SCA::kFormatNdjson;
+  } else if(!strcmp(name, "shards")) {
+    format = SCA::kFormatShards;
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,169 @@
+/*! ----------------------------------------------------------
+ *
+ *  \file       sca_writer.hh
+ *
+ *  \brief
+ *      Buffered writer used by the dump routines
+ *
+ *  \details
+ *      The output is collected in a large buffer that is handed to the
+ *      FILE in big chunks. Strings are copied and integers are formatted
+ *      by hand, printf is not involved at all. Strings are escaped the JSON
+ *      way. In compact mode the
+ *      whitespace that makes the output readable (indentation, spaces
+ *      around ':' and newlines) is left out. The output can also go to a
+ *      string, i.e the entries of the result cache.
+ *
+ *  \history
+ *      10/18/26 12:21:40 PDT Created
+ *
+ *  ----------------------------------------------------------*/
+#ifndef SCA_WRITER_H
+#define SCA_WRITER_H
+
+#include "sca_int.hh"
+
+namespace SCA {
+
+/// Encoding of the output
+enum OutputFormat {
+  kFormatJson,
+  kFormatBinary,
+  kFormatNdjson,
+  kFormatShards
+};
+
+// ============================================================================
+///        \class  Writer
+///        \brief  Buffers the output and formats it without printf
+// ============================================================================
+class Writer {
+  public:
+    /// Size of the buffer
+    static const size_t kBufSize = 1 << 20;
+    /// Ctor
+    Writer(void);
+    /// Dtor. Flushes what is left
+    ~Writer();
+    /// Flush to the current file and write to "fp" from now on
+    void set_file(FILE *fp);
+    /// Flush to the current file and append to "out" from now on, until
+    ///  the next set_file()
+    void set_string(std::string *out);
+    /// The file written to
+    FILE* file(void) const { return fp_; }
+    /// Whether the whitespace is left out
+    bool compact(void) const { return compact_; }
+    void set_compact(bool compact) {
+      compact_ = compact;
+    }
+    /// Encoding of the output
+    OutputFormat format(void) const { return format_; }
+    void set_format(OutputFormat format) {
+      format_ = format;
+    }
+    /// Hand the buffer over to the file
+    void flush(void);
+    /// Append a character
+    void put(char c) {
+      if(len_ == kBufSize) {
+        flush();
+      }
+      buf_[len_++] = c;
+    }
+    /// Append "len" bytes
+    void put(const char *str, size_t len) {
+      if(len > kBufSize - len_) {
+        put_slow(str, len);
+        return;
+      }
+      memcpy(buf_ + len_, str, len);
+      len_ += len;
+    }
+    /// Append a C string
+    void put(const char *str) {
+      put(str, strlen(str));
+    }
+    /// Append an integer in decimal
+    void num(int val) {
+      if(val < 0) {
+        put('-');
+        num((ULL)(-(long long)val));
+      } else {
+        num((ULL)val);
+      }
+    }
+    void num(U val) {
+      num((ULL)val);
+    }
+    void num(ULL val);
+    /// Append a number that is not negative with two decimals
+    void fixed(double val);
+    /// Append 16 hex digits
+    void hex(ULL val);
+    /// Append a quoted string
+    void str(const char *val) {
+      put('"');
+      esc(val, strlen(val));
+      put('"');
+    }
+    /// Append the inside of a JSON string i.e a name or a path. Only
+    ///  names like operator""s need an escape
+    void esc(const char *str, size_t len);
+    void esc(const char *str) {
+      esc(str, strlen(str));
+    }
+    /// Append whitespace, only in pretty mode
+    void ws(const char *spaces) {
+      if(!compact_) {
+        put(spaces);
+      }
+    }
+    /// Append "text" on a line of its own, indented by "indent"
+    void line(const char *indent, const char *text) {
+      ws(indent);
+      put(text);
+      ws("\n");
+    }
+    /// Start a field i.e <indent>"key"<sep>. "sep" is the pretty
+    ///  separator, compact mode always uses ':'
+    void key(const char *indent, const char *name, const char *sep) {
+      ws(indent);
+      str(name);
+      if(compact_) {
+        put(':');
+      } else {
+        put(sep);
+      }
+    }
+    /// End the line of a field with "text" i.e "," or "["
+    void end(const char *text) {
+      put(text);
+      ws("\n");
+    }
+
+  private:
+    /// Append a chunk bigger than the room left in the buffer
+    void put_slow(const char *str, size_t len);
+    /// The file written to
+    FILE *fp_;
+    /// The string appended to instead of the file, if any
+    std::string *str_;
+    /// The buffer and the bytes used in it
+    char *buf_;
+    size_t len_;
+    /// Whitespace is left out
+    bool compact_;
+    /// Encoding of the output
+    OutputFormat format_;
+};
+
+} // END SCA namespace
+
+//--------------------------------------------------------------------------------------
+///      \brief Get the format from its name i.e "json", "bin", "ndjson" or
+///             "shards". Returns false if the name is not known
+//--------------------------------------------------------------------------------------
+bool parseOutputFormat(const char *name, SCA::OutputFormat &format);
+
+#endif    /* SCA_WRITER_H */